@@ -1,7 +1,8 @@
 /*
  * This module is used to interface with the dial controls. Allows the user to
  * change the volume, octave, waveform, and distortion of the sound using the joystick
- * and rotary encoder.
+ * and rotary encoder. Clicking the rotary button while the distortion dial is open
+ * steps through the settings of the effects chain.
  */
 
 #ifndef _DIAL_CONTROLS_H_
@@ -23,6 +24,8 @@ typedef enum
     DISTORTION,
 } Control;
 
+#define EFFECT_SELECTION_DISTORTION -1 // The distortion dial adjusts the frequency distortion
+
 
 /*
  * This function initializes the dial controls module and starts the control thread.
@@ -78,6 +81,20 @@ enum SineMixerWaveform get_waveform();
 double get_distortion();
 
 
+/**
+ * This function retrieves the setting the distortion dial adjusts.
+ * @return The selected AudioEffectParam, or EFFECT_SELECTION_DISTORTION.
+ */
+int get_effect_selection();
+
+
+/*
+ * This function selects the next setting for the distortion dial, wrapping
+ * around from the last effect parameter to the frequency distortion.
+ */
+void select_next_effect();
+
+
 /**
  * This function gets the dial value of volume for syncing between mutes.
  * @param vol Pointer to hold the previous volume save.
@@ -0,0 +1,39 @@
+/*
+ * This module classifies finger-touch gestures from the hand landmarks.
+ * Each finger touching the thumb sets one bit of the gesture, using a
+ * press and a release threshold per finger so a touch held near the edge
+ * does not flicker. Timing and flicker counts are kept so the thresholds
+ * can be tuned on the board.
+ */
+
+#ifndef _GESTURE_CLASSIFIER_H_
+#define _GESTURE_CLASSIFIER_H_
+
+#define GESTURE_NUM_LANDMARK_VALUES 42 // x, y pairs of the 21 hand landmarks
+
+// Bits set in a gesture for each finger touching the thumb
+#define GESTURE_INDEX_BIT 0x8
+#define GESTURE_MIDDLE_BIT 0x4
+#define GESTURE_RING_BIT 0x2
+#define GESTURE_PINKY_BIT 0x1
+
+
+/**
+ * Classifies the gesture shown by a frame of landmarks, taking the fingers
+ * that were touching in the hand's previous frame into account.
+ *
+ * @param hand The hand the landmarks belong to, from 0 to LANDMARK_MAX_HANDS - 1.
+ * @param landmarks The x, y pairs of the 21 landmarks, in a 240x240 frame.
+ * @param size The number of values in the array.
+ * @return The gesture bits, or -1 if the frame cannot be classified.
+ */
+int gesture_classifier_update(int hand, const int landmarks[], int size);
+
+
+/**
+ * Prints how many frames were classified, how long classifying took and
+ * how often the gesture flickered.
+ */
+void gesture_classifier_print_stats(void);
+
+#endif
@@ -2,7 +2,9 @@
  * This module handles the translation of hand commands into 
  * corresponding actions for the sine mixer. It takes input from
  * the MediaPipe hand tracking system and translates it into alterations to
- * the currently playing wave.
+ * the currently playing wave. Pitch either follows the finger-touch
+ * gestures, or follows the hand landmarks continuously like a real theremin.
+ * Every tracked hand plays its own voice.
  */
 
 #ifndef _HAND_COMMANDS_H_
@@ -10,6 +12,21 @@
 
 #include <unistd.h>         
 #include <stdio.h>
+
+// Enumeration of the ways hand input sets the pitch
+typedef enum {
+    HAND_PITCH_GESTURE,   // Each finger-touch gesture plays a fixed note
+    HAND_PITCH_FREE,      // Pitch follows the hand continuously
+    HAND_PITCH_QUANTIZED, // Pitch follows the hand, rounded to the nearest scale note
+    HAND_PITCH_SOFT_SNAP, // Pitch follows the hand, pulled towards the nearest scale note
+} HandPitchMode;
+
+// Enumeration of the hand measurements a continuous pitch can follow
+typedef enum {
+    HAND_PITCH_FROM_X,     // Horizontal palm position, higher to the right
+    HAND_PITCH_FROM_Y,     // Vertical palm position, higher towards the top
+    HAND_PITCH_FROM_PINCH, // Distance between the thumb and index tips
+} HandPitchSource;
   
 
 /*
@@ -19,10 +36,27 @@ void command_handler_init();
 
 
 /**
- * This function updates the current hand command to be processed.
+ * This function updates the current command of a hand, played on that hand's voice.
+ * @param hand The hand that made the gesture.
  * @param cmd The command to be processed.
  */
-void command_handler_update_current_command(int cmd);
+void command_handler_update_current_command(int hand, int cmd);
+
+
+/**
+ * This function sets how hand input sets the pitch.
+ * @param mode The pitch mode to use.
+ * @param source The hand measurement followed by the continuous modes.
+ */
+void command_handler_set_pitch_mode(HandPitchMode mode, HandPitchSource source);
+
+
+/**
+ * This function sets how far ahead of the latest tracking frame the continuous
+ * pitch modes predict the hand, to hide part of the tracking latency.
+ * @param lead_ms The prediction lead in milliseconds, 0 to only fill the gaps between frames.
+ */
+void command_handler_set_prediction_lead(int lead_ms);
 
 
 /**
@@ -0,0 +1,59 @@
+/*
+ * This module predicts where the hand landmarks are between tracking frames.
+ * Each landmark coordinate is followed by an alpha-beta filter, which keeps a
+ * position and velocity that are corrected by every new frame. Extrapolating
+ * them lets the controls move smoothly between frames and slightly ahead of
+ * the tracking, hiding part of its latency.
+ */
+
+#ifndef _LANDMARK_PREDICTOR_H_
+#define _LANDMARK_PREDICTOR_H_
+
+#include "landmark_ring.h"
+#include <stdbool.h>
+
+// Struct representing the filter state of one hand
+struct LandmarkPredictor {
+    double position[LANDMARK_RING_NUM_VALUES]; // Filtered position at the last frame
+    double velocity[LANDMARK_RING_NUM_VALUES]; // Pixels per second
+    int last_values[LANDMARK_RING_NUM_VALUES]; // Last frame as received
+    long long last_frame_us;
+    bool has_frame;
+
+    // How far each frame landed from the prediction, and from the previous frame
+    double predicted_error_total;
+    double held_error_total;
+    long long frames_compared;
+};
+
+
+/**
+ * Resets a predictor, so the next frame starts the filter over.
+ *
+ * @param predictor The predictor to reset.
+ */
+void landmark_predictor_init(struct LandmarkPredictor *predictor);
+
+
+/**
+ * Corrects the filter with a new frame.
+ *
+ * @param predictor The predictor to update.
+ * @param frame The frame received.
+ */
+void landmark_predictor_update(struct LandmarkPredictor *predictor, const struct LandmarkFrame *frame);
+
+
+/**
+ * Extrapolates the landmarks to a point in time, no further than a short
+ * horizon past the last frame so a lost hand does not drift away.
+ *
+ * @param predictor The predictor to read.
+ * @param time_us The time to predict for, on the same clock as the frames.
+ * @param landmarks The predicted x, y pairs of the 21 landmarks.
+ * @return True if the landmarks were predicted, false if no frame was received yet.
+ */
+bool landmark_predictor_predict(const struct LandmarkPredictor *predictor, long long time_us,
+                                double landmarks[]);
+
+#endif
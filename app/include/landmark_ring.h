@@ -0,0 +1,74 @@
+/*
+ * This module shares the hand landmarks received over UDP with the modules
+ * that use them. Frames of each tracked hand are published by the UDP
+ * listener into a lock-free ring of their own, and each consumer reads at
+ * its own rate, either the latest frame or every frame in order, without
+ * ever blocking the listener. A consumer that falls too far behind skips
+ * ahead and counts the frames it missed.
+ */
+
+#ifndef _LANDMARK_RING_H_
+#define _LANDMARK_RING_H_
+
+#include <stdbool.h>
+
+#define LANDMARK_RING_NUM_VALUES 42 // x, y pairs of the 21 hand landmarks
+#define LANDMARK_RING_SIZE 16       // Frames kept in the ring, a power of two
+#define LANDMARK_MAX_HANDS 4        // Hands tracked at once, each with its own ring
+
+// Struct representing one frame of landmarks
+struct LandmarkFrame {
+    int hand;                    // Hand the frame belongs to
+    unsigned long long sequence; // Frame number of the hand, starting at 1
+    long long timestamp_us;      // Time the frame was received
+    int values[LANDMARK_RING_NUM_VALUES];
+};
+
+// Struct representing the position of a consumer reading every frame
+struct LandmarkReader {
+    int hand;
+    unsigned long long next_sequence;
+    long long dropped_frames;
+};
+
+
+/**
+ * Publishes a frame of landmarks. Must only be called from one thread.
+ *
+ * @param hand The hand the landmarks belong to, from 0 to LANDMARK_MAX_HANDS - 1.
+ * @param landmarks The x, y pairs of the 21 landmarks, in a 240x240 frame.
+ * @param size The number of values in the array.
+ */
+void landmark_ring_publish(int hand, const int landmarks[], int size);
+
+
+/**
+ * Copies the most recently published frame of a hand.
+ *
+ * @param hand The hand to read.
+ * @param frame The frame to copy into.
+ * @return True if a frame was copied, false if none has been published.
+ */
+bool landmark_ring_read_latest(int hand, struct LandmarkFrame *frame);
+
+
+/**
+ * Starts a reader at the next frame to be published for a hand.
+ *
+ * @param reader The reader to start.
+ * @param hand The hand to read.
+ */
+void landmark_reader_init(struct LandmarkReader *reader, int hand);
+
+
+/**
+ * Copies the next frame a reader has not seen yet. Frames overwritten before
+ * the reader got to them are skipped and added to its dropped count.
+ *
+ * @param reader The reader to advance.
+ * @param frame The frame to copy into.
+ * @return True if a frame was copied, false if the reader is up to date.
+ */
+bool landmark_reader_next(struct LandmarkReader *reader, struct LandmarkFrame *frame);
+
+#endif
@@ -14,14 +14,6 @@
 void lcd_menu_init();
 
 
-/**
- * This function sets the keypoint buffer to the new keypoints.
- * @param new_keypoints The new keypoints to set.
- * @param size The size of the new keypoints array.
- */
-void set_keypoint_buff(int new_keypoints[], int size);
-
-
 /* 
  * This function cleans up the LCD menus module and stops the menu thread.
  */
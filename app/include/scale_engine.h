@@ -0,0 +1,96 @@
+/*
+ * This module works out the notes the Digital Theremin plays. A tuning
+ * (equal temperament, just intonation, or a Scala file) sets the pitch of
+ * each step of the octave, and a root and scale choose which steps are
+ * played. Whenever a setting changes, the note frequencies of every
+ * octave and gesture are precomputed into a new table which replaces the
+ * old one in a single atomic store, so looking a note up is an index into
+ * the table and never waits on a change.
+ */
+
+#ifndef _SCALE_ENGINE_H_
+#define _SCALE_ENGINE_H_
+
+#define SCALE_MAX_STEPS 128    // Most steps a tuning can divide its octave into
+#define SCALE_NUM_GESTURES 16  // Every combination of the four finger bits
+#define SCALE_MIN_OCTAVE -4    // Lowest octave of the octave dial
+#define SCALE_MAX_OCTAVE 4     // Highest octave of the octave dial
+#define SCALE_DEFAULT_ROOT -9  // C below A4, in semitones from A4
+
+
+/*
+ * Initializes the scale engine with the settings made so far, equal
+ * temperament and chromatic from C unless others were set.
+ * Must be called before looking up notes.
+ */
+void scale_engine_init(void);
+
+
+/*
+ * Tunes the steps of the octave to twelve-tone equal temperament.
+ */
+void scale_engine_set_equal_temperament(void);
+
+
+/*
+ * Tunes the steps of the octave to five-limit just intonation from the root.
+ */
+void scale_engine_set_just_intonation(void);
+
+
+/**
+ * Tunes the steps of the octave from a Scala (.scl) file. The last pitch
+ * of the file is the period that repeats, usually 2/1 for an octave.
+ * @param path The path of the file.
+ * @return 0 on success, or -1 if the file cannot be read or parsed.
+ */
+int scale_engine_load_scala(const char *path);
+
+
+/**
+ * Sets the note the scale starts from.
+ * @param semitones The root, in semitones from A4.
+ */
+void scale_engine_set_root(int semitones);
+
+
+/**
+ * Gets the note the scale starts from.
+ * @return The root, in semitones from A4.
+ */
+int scale_engine_get_root(void);
+
+
+/**
+ * Sets the scale played, by name: chromatic, major, minor, pentatonic or blues.
+ * The degrees of a scale are given in semitones, so with a tuning of more
+ * or fewer than twelve steps each degree plays the closest step.
+ * @param name The name of the scale.
+ * @return 0 on success, or -1 if there is no scale with the name.
+ */
+int scale_engine_set_scale(const char *name);
+
+
+/**
+ * Looks up the note a finger-touch gesture plays.
+ * @param gesture The gesture bits, from 0 to SCALE_NUM_GESTURES - 1.
+ * @param octave The octave dial setting, from SCALE_MIN_OCTAVE to SCALE_MAX_OCTAVE.
+ * @return The frequency of the note in Hz.
+ */
+double scale_engine_gesture_frequency(int gesture, int octave);
+
+
+/**
+ * Finds the note of the scale closest to a pitch.
+ * @param semitones The pitch, in semitones from A4.
+ * @return The closest note, in semitones from A4.
+ */
+double scale_engine_nearest_note(double semitones);
+
+
+/*
+ * Frees the tables of the scale engine.
+ */
+void scale_engine_cleanup(void);
+
+#endif
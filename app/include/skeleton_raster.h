@@ -0,0 +1,52 @@
+/*
+ * This module draws the hand skeleton straight into the memory of an
+ * RGB565 image. Lines are stepped with integer Bresenham, or with Wu's
+ * algorithm to blend their edges, and discs are filled a span of a row at
+ * a time. It leaves out the rotation, mirroring and dot sizes the paint
+ * library handles for every pixel, which were most of the cost of drawing
+ * a skeleton.
+ */
+
+#ifndef _SKELETON_RASTER_H_
+#define _SKELETON_RASTER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Struct representing an image to draw into, with its pixels in the panel's byte order
+struct RasterImage {
+    uint16_t *pixels; // Row after row, from the top left
+    int width;
+    int height;
+};
+
+
+/**
+ * Draws a line one pixel wide. Lines with an end outside the image are not drawn.
+ *
+ * @param image The image to draw into.
+ * @param x0 The column of the start.
+ * @param y0 The row of the start.
+ * @param x1 The column of the end.
+ * @param y1 The row of the end.
+ * @param color The colour, in the panel's byte order like the colours of GUI_Paint.h.
+ * @param dotted True to leave out every third pixel.
+ * @param antialiased True to share each pixel of a sloped line between the two
+ *                    pixels it falls across, blended into the image.
+ */
+void skeleton_raster_line(const struct RasterImage *image, int x0, int y0, int x1, int y1,
+                          uint16_t color, bool dotted, bool antialiased);
+
+
+/**
+ * Draws a filled disc, clipped to the image.
+ *
+ * @param image The image to draw into.
+ * @param x The column of the centre.
+ * @param y The row of the centre.
+ * @param radius The radius in pixels.
+ * @param color The colour, in the panel's byte order like the colours of GUI_Paint.h.
+ */
+void skeleton_raster_disc(const struct RasterImage *image, int x, int y, int radius, uint16_t color);
+
+#endif
@@ -19,7 +19,7 @@
 
 
 /*
- * Initializes the UDP communication and starts the thread.
+ * Initializes the UDP communication and registers its socket with the event loop.
  */
 void udp_init();
 
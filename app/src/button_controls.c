@@ -1,12 +1,14 @@
 /*
  * This file implements the button controls module, handling the rotary encoder button. 
- * It allows users to mute and unmute the theremin by clicking the rotary button.
+ * It allows users to mute and unmute the theremin by clicking the rotary button, or to
+ * step through the effect settings while the distortion dial is open.
  */
 
 #include "button_controls.h"
 #include "joystick_button.h"
 #include "rotary_button.h"
 #include "dial_controls.h"
+#include "event_loop.h"
 #include "utils.h"
 #include <stdatomic.h>
 #include <stdbool.h>
@@ -18,69 +20,61 @@ RotaryButton rot_button;
 
 // Mute state variables
 static int prev_volume;  
-bool button_pressed = false;
+static bool is_muted = false;
 
-// Thread control variables
-static bool exit_thread = false;
-static pthread_t button_thread = 0;
+// Button value at the last check. Each press flips it, so every change is one press.
+static int last_button_value = 0;
+
+#define BUTTON_POLL_MS 50 // Time between two checks of the rotary button
+
+// Timer checking the rotary button on the event loop
+static int button_timer_fd = -1;
 
 // Helper function prototypes
-static void read_rotary_button();
-static void* button_thread_func(void* arg);
+static void read_rotary_button(void *arg);
 
 void button_controls_init()
 {
     joystick_button_init(&joy_button);
     rotary_button_init(&rot_button);
     get_dial_volume(&prev_volume);
+    last_button_value = get_rotary_button_value(&rot_button);
 
-    if (pthread_create(&button_thread, NULL, button_thread_func, NULL) != 0){
-        perror("Failed to create button thread");
-    }
+    button_timer_fd = event_loop_add_timer(BUTTON_POLL_MS, read_rotary_button, NULL);
 }
 
 void button_controls_cleanup()
 {
-    exit_thread = true;
-
-    int res = pthread_join(button_thread, NULL);
-    if (res != 0){
-        perror("Failed to join button thread");
-    }
+    event_loop_remove_timer(button_timer_fd);
+    button_timer_fd = -1;
 
     clean_joystick_button(&joy_button);
     clean_rotary_button(&rot_button);
 }
 
-// Function to read the rotary button state and mute/unmute
-static void read_rotary_button()
+// Timer handler acting on each press of the rotary button, to mute/unmute or select the next effect
+static void read_rotary_button(void *arg)
 {
+    (void)arg;
     int button = get_rotary_button_value(&rot_button);
-    
-    if (button == 1){
-        if (!button_pressed){
-            button_pressed = true;
-            toggle_mute();
-            get_dial_volume(&prev_volume);
-            set_dial_volume(0);
-        }
-    }
-    if (button == 0){
-        if (button_pressed){
-            button_pressed = false;
-            set_dial_volume(prev_volume);
-            toggle_mute();
-        }
+    if (button == last_button_value){
+        return;
     }
-}
+    last_button_value = button;
 
-// Function to read the state of the rotary button
-static void* button_thread_func(void* arg)
-{
-    (void)arg;
-    while (!exit_thread){
-        read_rotary_button();
-        sleep_for_ms(50);
+    if (get_current_control() == DISTORTION){
+        select_next_effect();
+    }
+    else if (!is_muted){
+        is_muted = true;
+        toggle_mute();
+        get_dial_volume(&prev_volume);
+        set_dial_volume(0);
+    }
+    else {
+        is_muted = false;
+        set_dial_volume(prev_volume);
+        toggle_mute();
     }
-    return NULL;
 }
+
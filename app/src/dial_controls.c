@@ -1,19 +1,26 @@
 /*
  * This file implements the dial controls module, handling the rotary encoder and joystick
  * for controlling the volume, octave, waveform, and distortion of the sine mixer. It also
- * handles the muting and unmuting states of the device.
+ * handles the muting and unmuting states of the device. The distortion dial also adjusts
+ * the effects chain, one setting at a time.
  */
 
 #include "distance_articulator.h"
 #include "rotary_encoder.h"
 #include "hand_commands.h"
 #include "dial_controls.h"
+#include "audio_effects.h"
 #include "sine_mixer.h"
 #include "joystick.h"
 #include "utils.h"
 #include <pthread.h>
+#include <errno.h>
 #include <stdio.h>
 #include <math.h>
+#include <time.h>
+
+#define JOYSTICK_SAMPLE_RATE_HZ 25 // Rate the joystick direction is sampled at
+#define ENCODER_POLL_MS 10         // Time between encoder reads while a dial is open
 
 // The joystick and rotary encoder handles
 Joystick joystick;
@@ -25,21 +32,27 @@ static int octave = 0;
 static int waveform = 0;
 static double distortion = 0.00;
 
+// Setting adjusted by the distortion dial, an effect parameter or the frequency distortion
+static int effect_selection = EFFECT_SELECTION_DISTORTION;
+
 // Printing variables to avoid printing the same values
 static int last_volume = -1;
 static int last_octave = -1;
 static int last_waveform = -1;
 static int last_distortion = -1;
 static int last_mute = -1;
+static int last_effect_selection = EFFECT_SELECTION_DISTORTION;
+static int last_effect_value = -1;
 
 // The current state of the control
 static Control current_control = REST;
 
 // Thread control variables
-static bool exit_thread = false;
+static volatile bool exit_thread = false;
 static pthread_t control_thread;
 static pthread_t value_thread;
 static pthread_mutex_t control_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t control_changed = PTHREAD_COND_INITIALIZER;
 
 // Flag to track if the device is muted
 static bool mute = false;
@@ -48,11 +61,13 @@ static bool mute = false;
 static void *value_thread_func(void *arg);
 static void *control_thread_func(void *arg);
 static void set_value();
-static void set_direction();
+static void set_direction(JoystickPosition position);
+static void wait_for_control_change(Control control, int timeout_ms);
 
 void dial_controls_init()
 {
     joystick_init(&joystick);
+    joystick_start_sampling(&joystick, JOYSTICK_SAMPLE_RATE_HZ);
     rotary_encoder_init(&encoder);
 
     if (pthread_create(&control_thread, NULL, control_thread_func, NULL) != 0){
@@ -130,6 +145,29 @@ double get_distortion()
     return dist;
 }
 
+int get_effect_selection()
+{
+    int selection;
+    pthread_mutex_lock(&control_mutex);
+    {
+        selection = effect_selection;
+    }
+    pthread_mutex_unlock(&control_mutex);
+    return selection;
+}
+
+void select_next_effect()
+{
+    pthread_mutex_lock(&control_mutex);
+    {
+        effect_selection++;
+        if (effect_selection >= AUDIO_EFFECT_PARAM_COUNT){
+            effect_selection = EFFECT_SELECTION_DISTORTION;
+        }
+    }
+    pthread_mutex_unlock(&control_mutex);
+}
+
 void get_dial_volume(int *vol)
 {
     pthread_mutex_lock(&control_mutex);
@@ -160,32 +198,35 @@ void toggle_mute()
 
 void dial_controls_cleanup()
 {
-    exit_thread = true;
+    pthread_mutex_lock(&control_mutex);
+    {
+        exit_thread = true;
+        pthread_cond_broadcast(&control_changed);
+    }
+    pthread_mutex_unlock(&control_mutex);
+
+    joystick_stop_sampling(&joystick);
     pthread_join(control_thread, NULL);
     pthread_join(value_thread, NULL);
     joystick_cleanup(&joystick);
     rotary_encoder_cleanup(&encoder);
 }
 
-// Function to set the direction based on joystick input
-static void set_direction()
+// Function to set the control based on the direction the joystick is held
+static void set_direction(JoystickPosition position)
 {
-    int x = joystick_read_input(&joystick, JOYSTICK_X);
-    sleep_for_ms(3);
-    int y = joystick_read_input(&joystick, JOYSTICK_Y);
-
-    int direction_change;
+    Control direction_change;
 
-    if (y < -65 && (x < 40 && x > -40)){
+    if (position == JOYSTICK_DOWN){
         direction_change = VOLUME;
     }
-    else if (y > 65 && (x < 40 && x > -40)){
+    else if (position == JOYSTICK_UP){
         direction_change = OCTAVE;
     }
-    else if (x > 65 && (y < 40 && y > -40)){
+    else if (position == JOYSTICK_RIGHT){
         direction_change = WAVEFORM;
     }
-    else if (x < -65 && (y < 40 && y > -40)){
+    else if (position == JOYSTICK_LEFT){
         direction_change = DISTORTION;
     }
     else{
@@ -195,6 +236,35 @@ static void set_direction()
     pthread_mutex_lock(&control_mutex);
     {
         current_control = direction_change;
+        pthread_cond_broadcast(&control_changed);
+    }
+    pthread_mutex_unlock(&control_mutex);
+}
+
+// Blocks until the control changes or the program exits, or until timeout_ms
+// passes when it is not negative
+static void wait_for_control_change(Control control, int timeout_ms)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L){
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&control_mutex);
+    {
+        int result = 0;
+        while (current_control == control && !exit_thread && result != ETIMEDOUT){
+            if (timeout_ms < 0){
+                pthread_cond_wait(&control_changed, &control_mutex);
+            }
+            else{
+                result = pthread_cond_timedwait(&control_changed, &control_mutex, &deadline);
+            }
+        }
     }
     pthread_mutex_unlock(&control_mutex);
 }
@@ -202,11 +272,18 @@ static void set_direction()
 // Helper function to print the current stats to terminal
 static void print_stats()
 {
+    int selection = get_effect_selection();
+    int effect_value = selection >= 0 ? audio_effects_get_param(selection) : -1;
+
     if (volume != last_volume || octave != last_octave || waveform != last_waveform ||
-        distortion != last_distortion || mute != last_mute){
+        distortion != last_distortion || mute != last_mute ||
+        selection != last_effect_selection || effect_value != last_effect_value){
 
         printf("\r\033[KVolume: %d | Octave: %d | Waveform: %d | Distortion: %.3f | Mute: %s",
             get_volume(), octave, waveform, distortion, mute ? "ON" : "OFF");
+        if (selection >= 0){
+            printf(" | %s: %d", audio_effects_get_param_name(selection), effect_value);
+        }
         fflush(stdout);
 
         last_volume = volume;
@@ -214,6 +291,8 @@ static void print_stats()
         last_waveform = waveform;
         last_distortion = distortion;
         last_mute = mute;
+        last_effect_selection = selection;
+        last_effect_value = effect_value;
     }
 }
 
@@ -229,8 +308,9 @@ static void set_value()
 
     if (current_state == VOLUME){
         rotary_encoder_set_value(volume);
+        rotary_encoder_set_acceleration(true);
 
-        while (current_control == VOLUME){
+        while (current_control == VOLUME && !exit_thread){
             bool is_muted;
             pthread_mutex_lock(&control_mutex);
             {
@@ -241,7 +321,7 @@ static void set_value()
             if (is_muted){
                 volume = 0;
                 print_stats();
-                sleep_for_ms(10);
+                wait_for_control_change(VOLUME, ENCODER_POLL_MS);
                 continue;
             }
             int new_vol = rotary_encoder_get_value(&encoder);
@@ -257,16 +337,17 @@ static void set_value()
 
             if (new_vol != volume){
                 volume = new_vol;
-                sleep_for_ms(10);
             }
             print_stats();
+            wait_for_control_change(VOLUME, ENCODER_POLL_MS);
         }
     }
 
     else if (current_state == OCTAVE){
         rotary_encoder_set_value(octave);
+        rotary_encoder_set_acceleration(false);
 
-        while (current_control == OCTAVE){
+        while (current_control == OCTAVE && !exit_thread){
             int new_octave = rotary_encoder_get_value(&encoder);
 
             if (new_octave > 4){
@@ -281,16 +362,17 @@ static void set_value()
             if (new_octave != octave){
                 octave = new_octave;
                 command_handler_setOctave(octave);
-                sleep_for_ms(10);
             }
             print_stats();
+            wait_for_control_change(OCTAVE, ENCODER_POLL_MS);
         }
     }
 
     else if (current_state == WAVEFORM){
         rotary_encoder_set_value(waveform);
+        rotary_encoder_set_acceleration(false);
 
-        while (current_control == WAVEFORM){
+        while (current_control == WAVEFORM && !exit_thread){
             int new_waveform = rotary_encoder_get_value(&encoder);
             new_waveform = (new_waveform % SINEMIXER_WAVE_COUNT);
 
@@ -301,46 +383,78 @@ static void set_value()
             if (new_waveform != waveform){
                 waveform = new_waveform;
                 sine_mixer_set_waveform(waveform);
-                sleep_for_ms(10);
             }
             print_stats();
+            wait_for_control_change(WAVEFORM, ENCODER_POLL_MS);
         }
     }
 
     else if (current_state == DISTORTION){
-        int distortion_int = (int)(distortion * 100);
-        rotary_encoder_set_value(distortion_int);
-
-        while (current_control == DISTORTION){
-            int new_distortion_int = rotary_encoder_get_value(&encoder);
+        rotary_encoder_set_acceleration(true);
+        int shown_selection = -2;
+
+        while (current_control == DISTORTION && !exit_thread){
+            // Load the selected setting into the encoder whenever the selection changes
+            int selection = get_effect_selection();
+            if (selection != shown_selection){
+                shown_selection = selection;
+                if (selection == EFFECT_SELECTION_DISTORTION){
+                    rotary_encoder_set_value((int)lround(distortion * 100));
+                }
+                else{
+                    rotary_encoder_set_value(audio_effects_get_param(selection));
+                }
+            }
 
-            if (new_distortion_int > 10){
-                new_distortion_int = 10;
-                rotary_encoder_set_value(new_distortion_int);
+            if (selection == EFFECT_SELECTION_DISTORTION){
+                int new_distortion_int = rotary_encoder_get_value(&encoder);
+
+                if (new_distortion_int > 10){
+                    new_distortion_int = 10;
+                    rotary_encoder_set_value(new_distortion_int);
+                }
+                else if (new_distortion_int < 0){
+                    new_distortion_int = 0;
+                    rotary_encoder_set_value(new_distortion_int);
+                }
+
+                double new_distortion_scaled = new_distortion_int / 100.0;
+                distortion = new_distortion_scaled;
+                sine_mixer_set_distortion(distortion);
             }
-            else if (new_distortion_int < 0){
-                new_distortion_int = 0;
-                rotary_encoder_set_value(new_distortion_int);
+            else{
+                int new_value = rotary_encoder_get_value(&encoder);
+
+                if (new_value > AUDIO_EFFECTS_PARAM_MAX){
+                    new_value = AUDIO_EFFECTS_PARAM_MAX;
+                    rotary_encoder_set_value(new_value);
+                }
+                else if (new_value < 0){
+                    new_value = 0;
+                    rotary_encoder_set_value(new_value);
+                }
+                audio_effects_set_param(selection, new_value);
             }
 
-            double new_distortion_scaled = new_distortion_int / 100.0;
-            distortion = new_distortion_scaled;
-            sine_mixer_set_distortion(distortion);
-
-            sleep_for_ms(10);
             print_stats();
+            wait_for_control_change(DISTORTION, ENCODER_POLL_MS);
         }
     }
-    print_stats();
-    sleep_for_ms(50);
+    else{
+        // Nothing to adjust until the joystick is pushed in a direction
+        print_stats();
+        wait_for_control_change(REST, -1);
+    }
 }
 
 // Thread function to handle the controller logic
 static void *control_thread_func(void *arg)
 {
     (void)arg;
+    JoystickPosition position = JOYSTICK_CENTER;
     while (!exit_thread){
-        set_direction();
+        position = joystick_wait_for_position_change(&joystick, position);
+        set_direction(position);
     }
     return NULL;
 }
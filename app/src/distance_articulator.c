@@ -1,12 +1,14 @@
 /*
  * This file implements the distance articulator module, which is responsible for
- * converting the distance sensor data into a volume level for the sine mixer.
+ * converting the distance sensor data into a volume level for the sine mixer. The
+ * closeness of the hand is also given to the modulation as one of its sources.
  */
 
 #include "distance_articulator.h"
 #include "distance_sensor.h"
 #include "dial_controls.h"
 #include "sine_mixer.h"
+#include "modulation.h"
 #include "utils.h"
 #include <stdbool.h>
 #include <assert.h>
@@ -35,6 +37,7 @@ static bool is_initialized = false;
 static pthread_t articulator_runner;
 
 // Helper function prototypes
+static double closeness(int distance);
 static int dist_to_vol(int distance);
 static int averageSample(void);
 static void *articulator_runnerFn(void *args);
@@ -68,17 +71,23 @@ void distance_articulator_set_mute(bool isMuted)
     muted = isMuted;
 }
 
-// Function to set the volume based on distance using linear scaling.
-static int dist_to_vol(int distance)
+// Function to get how close the hand is, from 0 (out of range) to 1 (closest).
+static double closeness(int distance)
 {
     if (distance < MIN_DISTANCE){
-        return max_volume;
+        return 1;
     }
     if (distance > MAX_DISTANCE){
         return 0;
     }
     double normalized_distance = (distance - MIN_DISTANCE) / (double)(MAX_DISTANCE - MIN_DISTANCE);
-    double volume = max_volume * (1 - normalized_distance);
+    return 1 - normalized_distance;
+}
+
+// Function to set the volume based on distance using linear scaling.
+static int dist_to_vol(int distance)
+{
+    double volume = max_volume * closeness(distance);
     return (int)volume;
 }
 
@@ -111,6 +120,7 @@ static void *articulator_runnerFn(void *args)
             int distance = averageSample();
             int vol = dist_to_vol(distance);
             sine_mixer_set_volume(vol);
+            modulation_set_source(MODULATION_SOURCE_DISTANCE, closeness(distance));
         }
         sleep_for_ms(5);
     }
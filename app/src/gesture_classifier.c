@@ -0,0 +1,118 @@
+/*
+ * This file implements the gesture classifier module, comparing the distance
+ * from the thumb tip to each fingertip against per-finger thresholds. The
+ * distances are measured relative to the palm length, so the thresholds hold
+ * whether the hand is near or far from the camera.
+ */
+
+#include "gesture_classifier.h"
+#include "landmark_ring.h"
+#include "utils.h"
+#include <stdbool.h>
+#include <assert.h>
+#include <stdio.h>
+
+#define NUM_FINGERS 4
+
+// Landmark indices used by the classifier
+#define LANDMARK_WRIST 0
+#define LANDMARK_THUMB_TIP 4
+#define LANDMARK_MIDDLE_MCP 9
+
+// Gestures lasting fewer frames than this count as flicker
+#define FLICKER_FRAMES 3
+
+// Struct representing the thresholds of one finger, as ratios of the palm length
+struct FingerThresholds {
+    int tip;              // Landmark of the fingertip
+    int bit;              // Gesture bit set while the finger touches the thumb
+    double press_ratio;   // A touch starts once the tip is closer than this
+    double release_ratio; // A touch ends once the tip is further than this
+};
+
+// Thresholds for each finger; the host used 0.15 of the frame, which is about
+// 0.6 of a typical palm length. The ring and pinky sit further from the thumb
+// when touching, so they are given a little more room.
+static const struct FingerThresholds fingers[NUM_FINGERS] = {
+    {8, GESTURE_INDEX_BIT, 0.55, 0.65},
+    {12, GESTURE_MIDDLE_BIT, 0.55, 0.65},
+    {16, GESTURE_RING_BIT, 0.60, 0.72},
+    {20, GESTURE_PINKY_BIT, 0.60, 0.72},
+};
+
+// Gesture of each hand's previous frame, which decides the threshold each finger uses
+static int current_gesture[LANDMARK_MAX_HANDS];
+static int frames_in_gesture[LANDMARK_MAX_HANDS];
+
+// Classification statistics
+static long long frames_classified = 0;
+static long long total_classify_ns = 0;
+static long long max_classify_ns = 0;
+static long long gesture_changes = 0;
+static long long flicker_changes = 0;
+
+// Helper function prototypes
+static long long squared_distance(const int landmarks[], int from, int to);
+
+int gesture_classifier_update(int hand, const int landmarks[], int size)
+{
+    assert(hand >= 0 && hand < LANDMARK_MAX_HANDS);
+    if (size != GESTURE_NUM_LANDMARK_VALUES){
+        return -1;
+    }
+    long long start_ns = get_monotonic_time_in_ns();
+
+    long long palm = squared_distance(landmarks, LANDMARK_WRIST, LANDMARK_MIDDLE_MCP);
+    if (palm == 0){
+        return -1;
+    }
+
+    // Compare squared distances, so no square roots are needed per finger
+    int gesture = 0;
+    for (int i = 0; i < NUM_FINGERS; i++){
+        bool was_touching = (current_gesture[hand] & fingers[i].bit) != 0;
+        double ratio = was_touching ? fingers[i].release_ratio : fingers[i].press_ratio;
+        long long tip = squared_distance(landmarks, LANDMARK_THUMB_TIP, fingers[i].tip);
+
+        if (tip < ratio * ratio * palm){
+            gesture |= fingers[i].bit;
+        }
+    }
+
+    if (gesture != current_gesture[hand]){
+        gesture_changes++;
+        if (frames_in_gesture[hand] > 0 && frames_in_gesture[hand] < FLICKER_FRAMES){
+            flicker_changes++;
+        }
+        current_gesture[hand] = gesture;
+        frames_in_gesture[hand] = 0;
+    }
+    frames_in_gesture[hand]++;
+
+    long long elapsed_ns = get_monotonic_time_in_ns() - start_ns;
+    frames_classified++;
+    total_classify_ns += elapsed_ns;
+    if (elapsed_ns > max_classify_ns){
+        max_classify_ns = elapsed_ns;
+    }
+    return gesture;
+}
+
+void gesture_classifier_print_stats(void)
+{
+    if (frames_classified == 0){
+        return;
+    }
+    printf("\nGestures over %lld frames: classify avg %lld ns (max %lld ns), "
+           "%lld changes, %lld lasting under %d frames\n",
+           frames_classified, total_classify_ns / frames_classified, max_classify_ns,
+           gesture_changes, flicker_changes, FLICKER_FRAMES);
+}
+
+// Function to get the squared distance between two landmarks
+static long long squared_distance(const int landmarks[], int from, int to)
+{
+    long long dx = landmarks[2 * from] - landmarks[2 * to];
+    long long dy = landmarks[2 * from + 1] - landmarks[2 * to + 1];
+    return dx * dx + dy * dy;
+}
@@ -2,93 +2,137 @@
  * This file implements the hand commands module, handling the processing of hand commands
  * and translating them into corresponding actions for the sine mixer. It takes input from
  * the MediaPipe hand tracking system and translates it into alterations to the currently
- * playing wave.
+ * playing wave. In the continuous pitch modes the command thread runs at a fixed control
+ * rate, predicting the landmarks between tracking frames and smoothing the pitch read
+ * from them before queueing it. Each tracked hand plays its own voice of the mixer,
+ * and the palm of the first hand is also a source of the modulation.
  */
 
 #include "hand_commands.h"
+#include "landmark_predictor.h"
+#include "scale_engine.h"
 #include "sine_mixer.h"
+#include "modulation.h"
+#include "utils.h"
 #include <stdbool.h>
 #include <pthread.h>
 #include <unistd.h>
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
 #include <stdio.h>
 #include <math.h>
+#include <time.h>
 
-#define NUM_COMMANDS 14  // Number of commands in the array
 #define NOTE_A4_BASE 440 // Base frequency for A4 note
 
-// Binary representations of the hand commands
-#define B0000 0
-#define B1000 8
-#define B0100 4
-#define B0010 2
-#define B0001 1
-#define B1100 12
-#define B0110 6
-#define B0011 3
-#define B1110 14
-#define B0111 7
-#define B1111 15
-#define B1001 9
-#define B0101 5
-#define B1101 13
+#define CONTROL_RATE_HZ 100          // Rate the continuous pitch is updated at
+#define PITCH_SMOOTHING_MS 40.0      // Time constant of the continuous pitch smoothing
+#define PITCH_RANGE_SEMITONES 24     // Span of the continuous pitch across the hand's travel
+#define SOFT_SNAP_STRENGTH 0.6       // Share of the distance to the nearest scale note removed
+#define PINCH_MAX_RATIO 1.2          // Pinch over palm length that reaches the top of the range
+#define DEFAULT_PREDICTION_LEAD_MS 50 // How far ahead of the latest frame the landmarks are predicted
+#define HAND_LOST_MS 1000            // Time without frames after which a hand is gone
+#define HAND_CHECK_MS 100            // Period lost hands are checked at in gesture mode
+
+// Landmark layout, as x, y pairs in a 240x240 frame
+#define LANDMARK_FRAME_SIZE 240
+#define LANDMARK_WRIST 0
+#define LANDMARK_THUMB_TIP 4
+#define LANDMARK_INDEX_MCP 5
+#define LANDMARK_INDEX_TIP 8
+#define LANDMARK_MIDDLE_MCP 9
+#define LANDMARK_RING_MCP 13
+#define LANDMARK_PINKY_MCP 17
 
 // Current octave level based on open hand
 static int currentOctave = 0;
 
-// Track the last played note to avoid reprocessing
-static double last_note = 0.0;
+// Struct representing a tracked hand and the voice it plays
+struct HandState {
+    int command;                         // Latest gesture, or -1 before the first
+    struct LandmarkPredictor predictor;  // Used by the command thread only
+    unsigned long long last_sequence;    // Last frame given to the predictor
+    long long last_seen_us;              // Time the last frame was received, 0 if never
+    double smoothed_semitones;           // Smoothed continuous pitch, in semitones from A4
+    bool is_smoothing;
+    double last_note;                    // Last frequency queued, to avoid requeueing it
+};
 
-// Track previous command to avoid reprocessing
-static volatile int command = -1;
+// Each hand plays the mixer voice with its own index
+_Static_assert(LANDMARK_MAX_HANDS <= SINEMIXER_MAX_VOICES, "every hand needs a voice");
+static struct HandState hands[LANDMARK_MAX_HANDS];
 
 // Thread control variables
-static pthread_mutex_t lock;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t input_changed = PTHREAD_COND_INITIALIZER;
 static pthread_t thread;
-static bool end_thread = false;
+static volatile bool end_thread = false;
 
-// Structure to map binary command to note frequency
-struct digit_to_play_freq{
-    int binary;
-    int note_offset;
-};
+// Pitch mode and the hand measurement it follows
+static HandPitchMode pitch_mode = HAND_PITCH_GESTURE;
+static HandPitchSource pitch_source = HAND_PITCH_FROM_Y;
 
-// Commands mapping each hand gesture to a note
-static struct digit_to_play_freq commands[] = {
-    {B0000, -9}, // C
-    {B0001, -8}, // C sharp
-    {B1000, -7}, // D
-    {B1001, -6}, // D sharp
-    {B0100, -5}, // E
-    {B0101, -4}, // E sharp (F)
-    {B0010, -4}, // F
-    {B0011, -3}, // F sharp
-    {B1100, -2}, // G
-    {B1101, -1}, // G sharp
-    {B0110, 0},  // A
-    {B0111, 1},  // A sharp
-    {B1110, 2},  // B
-    {B1111, 3}   // B sharp (C)
-};
+// How far ahead the continuous pitch modes predict the hands
+static int prediction_lead_ms = DEFAULT_PREDICTION_LEAD_MS;
+
+// Time from landmarks arriving to their pitch being queued for the mixer
+static long long latency_total_us = 0;
+static long long latency_max_us = 0;
+static long long latency_frames = 0;
 
 // Helper function prototypes
-static void process_command(int cmd);
+static void process_command(int hand);
+static void process_landmarks(int hand, const double points[], long long received_us);
 static void *command_thread(void *arg);
-static double note_to_freq(int offset);
-static void play_note(double freq);
+static void follow_hand(int hand, long long now_us);
+static bool is_sounding(int hand, long long now_us);
+static void play_note(int hand, double freq, bool is_new_note);
+static double hand_position(const double points[]);
+static double palm_centre(const double points[], int axis);
+static void wait_for_input(struct timespec *deadline);
 
 void command_handler_init()
 {
-    pthread_mutex_init(&lock, NULL);
+    for (int i = 0; i < LANDMARK_MAX_HANDS; i++){
+        hands[i].command = -1;
+        landmark_predictor_init(&hands[i].predictor);
+    }
     if (pthread_create(&thread, NULL, command_thread, NULL) != 0){
         perror("Failed to create command thread");
     }
 }
 
-void command_handler_update_current_command(int cmd)
+void command_handler_update_current_command(int hand, int cmd)
 {
+    assert(hand >= 0 && hand < LANDMARK_MAX_HANDS);
     pthread_mutex_lock(&lock);
     {
-        command = cmd;
+        hands[hand].command = cmd;
+        pthread_cond_signal(&input_changed);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void command_handler_set_pitch_mode(HandPitchMode mode, HandPitchSource source)
+{
+    pthread_mutex_lock(&lock);
+    {
+        pitch_mode = mode;
+        pitch_source = source;
+        for (int i = 0; i < LANDMARK_MAX_HANDS; i++){
+            hands[i].is_smoothing = false;
+        }
+        pthread_cond_signal(&input_changed);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void command_handler_set_prediction_lead(int lead_ms)
+{
+    pthread_mutex_lock(&lock);
+    {
+        prediction_lead_ms = lead_ms;
     }
     pthread_mutex_unlock(&lock);
 }
@@ -100,54 +144,260 @@ int command_handler_getOctave()
 
 void command_handler_setOctave(int octave)
 {
-    currentOctave = octave;
+    pthread_mutex_lock(&lock);
+    {
+        currentOctave = octave;
+        pthread_cond_signal(&input_changed);
+    }
+    pthread_mutex_unlock(&lock);
 }
 
 void command_handler_cleanup()
 {
-    end_thread = true;
+    pthread_mutex_lock(&lock);
+    {
+        end_thread = true;
+        pthread_cond_signal(&input_changed);
+    }
+    pthread_mutex_unlock(&lock);
     pthread_join(thread, NULL);
     pthread_mutex_destroy(&lock);
+
+    if (latency_frames > 0){
+        long long pickup_avg_us, pickup_max_us;
+        sine_mixer_get_pickup_latency(&pickup_avg_us, &pickup_max_us);
+        printf("\nPitch latency over %lld frames: landmarks to mixer avg %lld us (max %lld us), "
+               "mixer pickup avg %lld us (max %lld us)\n",
+               latency_frames, latency_total_us / latency_frames, latency_max_us,
+               pickup_avg_us, pickup_max_us);
+    }
+
+    double predicted_error_total = 0;
+    double held_error_total = 0;
+    long long frames_compared = 0;
+    for (int i = 0; i < LANDMARK_MAX_HANDS; i++){
+        predicted_error_total += hands[i].predictor.predicted_error_total;
+        held_error_total += hands[i].predictor.held_error_total;
+        frames_compared += hands[i].predictor.frames_compared;
+    }
+    if (frames_compared > 0){
+        printf("Prediction %d ms ahead: frames landed avg %.1f px from the prediction, "
+               "%.1f px from the previous frame\n", prediction_lead_ms,
+               predicted_error_total / frames_compared, held_error_total / frames_compared);
+    }
 }
 
-// Function to process the command and play the corresponding note
-static void process_command(int cmd)
+// Function to process a hand's command and play the corresponding note
+static void process_command(int hand)
 {
-    for (int i = 0; i < NUM_COMMANDS; i++){
-        if (cmd == commands[i].binary){
-            double frequency = note_to_freq((12 * currentOctave) + commands[i].note_offset);
-            play_note(frequency);
+    int gesture = hands[hand].command;
+    if (gesture >= 0 && gesture < SCALE_NUM_GESTURES){
+        play_note(hand, scale_engine_gesture_frequency(gesture, currentOctave), true);
+    }
+}
+
+// Function to move a hand's smoothed pitch towards it and queue it for the mixer
+static void process_landmarks(int hand, const double points[], long long received_us)
+{
+    struct HandState *state = &hands[hand];
+    double target = scale_engine_get_root() + 12 * currentOctave
+                  + hand_position(points) * PITCH_RANGE_SEMITONES;
+
+    // One-pole low-pass at the control rate, so tracking jitter does not warble
+    if (!state->is_smoothing){
+        state->smoothed_semitones = target;
+        state->is_smoothing = true;
+    }
+    double alpha = 1.0 - exp(-(1000.0 / CONTROL_RATE_HZ) / PITCH_SMOOTHING_MS);
+    state->smoothed_semitones += alpha * (target - state->smoothed_semitones);
+
+    double semitones = state->smoothed_semitones;
+    if (pitch_mode == HAND_PITCH_QUANTIZED){
+        semitones = scale_engine_nearest_note(semitones);
+    }
+    else if (pitch_mode == HAND_PITCH_SOFT_SNAP){
+        double note = scale_engine_nearest_note(semitones);
+        semitones += (note - semitones) * SOFT_SNAP_STRENGTH;
+    }
+    play_note(hand, pow(2, semitones / 12) * NOTE_A4_BASE, false);
+
+    // Count each frame once, the first time it reaches the mixer
+    if (received_us != 0){
+        long long latency_us = get_time_in_us() - received_us;
+        latency_total_us += latency_us;
+        latency_frames++;
+        if (latency_us > latency_max_us){
+            latency_max_us = latency_us;
         }
     }
 }
 
-// Thread function that continuously processes commands
+// Thread function that processes commands as they arrive, or landmarks at the control rate
 static void *command_thread(void *arg)
 {
     (void)arg;
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+
+    pthread_mutex_lock(&lock);
     while (!end_thread){
-        if (command != -1){
-            pthread_mutex_lock(&lock);
-            {
-                process_command(command);
-            }
-            pthread_mutex_unlock(&lock);
+        long long now_us = get_time_in_us();
+        for (int i = 0; i < LANDMARK_MAX_HANDS; i++){
+            follow_hand(i, now_us);
         }
+
+        if (pitch_mode == HAND_PITCH_GESTURE){
+            // Wait for the next gesture or octave, checking now and then for lost hands
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += HAND_CHECK_MS * 1000000L;
+        }
+        else{
+            deadline.tv_nsec += 1000000000L / CONTROL_RATE_HZ;
+        }
+        if (deadline.tv_nsec >= 1000000000L){
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        wait_for_input(&deadline);
     }
+    pthread_mutex_unlock(&lock);
     return NULL;
 }
 
-// Function to convert note offset to frequency
-static double note_to_freq(int offset)
+// Function to play a hand's voice from its gesture or landmarks, or stop it once the hand is gone
+static void follow_hand(int hand, long long now_us)
 {
-    return pow(2, (double)offset / 12) * NOTE_A4_BASE;
+    struct HandState *state = &hands[hand];
+    struct LandmarkFrame frame;
+    bool is_new = false;
+    if (landmark_ring_read_latest(hand, &frame) && frame.sequence != state->last_sequence){
+        is_new = true;
+        state->last_sequence = frame.sequence;
+        state->last_seen_us = frame.timestamp_us;
+        landmark_predictor_update(&state->predictor, &frame);
+    }
+
+    // The first hand also moves the modulation, from where its palm is
+    if (is_new && hand == 0){
+        double points[LANDMARK_RING_NUM_VALUES];
+        for (int i = 0; i < LANDMARK_RING_NUM_VALUES; i++){
+            points[i] = frame.values[i];
+        }
+        modulation_set_source(MODULATION_SOURCE_HAND_X, palm_centre(points, 0));
+        modulation_set_source(MODULATION_SOURCE_HAND_Y, 1.0 - palm_centre(points, 1));
+    }
+
+    if (!is_sounding(hand, now_us)){
+        if (state->last_note != 0){
+            sine_mixer_stop_voice(hand);
+            state->last_note = 0;
+            state->is_smoothing = false;
+        }
+        return;
+    }
+
+    if (pitch_mode == HAND_PITCH_GESTURE){
+        if (state->command != -1){
+            process_command(hand);
+        }
+        return;
+    }
+
+    // Follow where the hand is predicted to be slightly ahead of now
+    double predicted[LANDMARK_RING_NUM_VALUES];
+    long long predict_us = now_us + prediction_lead_ms * 1000LL;
+    if (landmark_predictor_predict(&state->predictor, predict_us, predicted)){
+        process_landmarks(hand, predicted, is_new ? frame.timestamp_us : 0);
+    }
 }
 
-// Function to play the note at the given frequency
-static void play_note(double frequency)
+// Function to check if a hand's voice should play. A hand that is gone keeps
+// playing while no other hand is tracked, like the single-hand theremin did.
+static bool is_sounding(int hand, long long now_us)
 {
-    if (frequency != last_note){
-        sine_mixer_queue_frequency(frequency);
-        last_note = frequency;
+    if (hands[hand].last_seen_us == 0){
+        // Gestures may still arrive without landmarks being tracked yet
+        return hand == 0;
+    }
+    if (now_us - hands[hand].last_seen_us < HAND_LOST_MS * 1000LL){
+        return true;
+    }
+    for (int i = 0; i < LANDMARK_MAX_HANDS; i++){
+        if (hands[i].last_seen_us != 0 && now_us - hands[i].last_seen_us < HAND_LOST_MS * 1000LL){
+            return false;
+        }
+    }
+    return true;
+}
+
+// Waits on the input condition with the lock held, until the deadline. In gesture
+// mode any input ends the wait; otherwise only a new mode or shutdown ends a control
+// period early.
+static void wait_for_input(struct timespec *deadline)
+{
+    HandPitchMode mode = pitch_mode;
+    while (!end_thread){
+        if (pthread_cond_timedwait(&input_changed, &lock, deadline) == ETIMEDOUT){
+            break;
+        }
+        if (mode == HAND_PITCH_GESTURE || pitch_mode != mode){
+            break;
+        }
+    }
+}
+
+// Function to get where the hand is along the pitch source, from 0 (lowest) to 1 (highest)
+static double hand_position(const double points[])
+{
+    double position;
+    if (pitch_source == HAND_PITCH_FROM_PINCH){
+        // Normalize by the palm length so the distance from the camera does not matter
+        double pinch = hypot(points[2 * LANDMARK_THUMB_TIP] - points[2 * LANDMARK_INDEX_TIP],
+                             points[2 * LANDMARK_THUMB_TIP + 1] - points[2 * LANDMARK_INDEX_TIP + 1]);
+        double palm = hypot(points[2 * LANDMARK_WRIST] - points[2 * LANDMARK_MIDDLE_MCP],
+                            points[2 * LANDMARK_WRIST + 1] - points[2 * LANDMARK_MIDDLE_MCP + 1]);
+        position = palm > 0 ? pinch / (palm * PINCH_MAX_RATIO) : 0;
+    }
+    else{
+        int axis = pitch_source == HAND_PITCH_FROM_X ? 0 : 1;
+        position = palm_centre(points, axis);
+        if (pitch_source == HAND_PITCH_FROM_Y){
+            position = 1.0 - position;
+        }
+    }
+
+    if (position < 0){
+        return 0;
+    }
+    return position > 1 ? 1 : position;
+}
+
+// Function to get the palm centre along an axis (0 for x, 1 for y), from 0 to 1 across the frame
+static double palm_centre(const double points[], int axis)
+{
+    // From the wrist and the knuckle of each finger
+    static const int palm_points[] = {
+        LANDMARK_WRIST, LANDMARK_INDEX_MCP, LANDMARK_MIDDLE_MCP,
+        LANDMARK_RING_MCP, LANDMARK_PINKY_MCP,
+    };
+    double sum = 0;
+    for (int i = 0; i < 5; i++){
+        sum += points[2 * palm_points[i] + axis];
+    }
+    return sum / 5 / (LANDMARK_FRAME_SIZE - 1);
+}
+
+// Function to play the note at the given frequency on a hand's voice. A new note
+// from a gesture is articulated, while the continuous pitch glides the held note.
+static void play_note(int hand, double frequency, bool is_new_note)
+{
+    if (frequency != hands[hand].last_note){
+        if (is_new_note){
+            sine_mixer_note_on(hand, frequency);
+        }
+        else{
+            sine_mixer_queue_voice_frequency(hand, frequency);
+        }
+        hands[hand].last_note = frequency;
     }
 }
\ No newline at end of file
@@ -0,0 +1,93 @@
+/*
+ * This file implements the landmark predictor module. On each frame the
+ * filter extrapolates its state to the frame time, then moves the position
+ * by alpha and the velocity by beta of the difference to the measurement.
+ */
+
+#include "landmark_predictor.h"
+#include <string.h>
+#include <math.h>
+
+#define PREDICTOR_ALPHA 0.5        // Share of the error corrected in the position
+#define PREDICTOR_BETA 0.2         // Share of the error corrected in the velocity
+#define PREDICTOR_MAX_AHEAD_MS 150 // Furthest the landmarks are extrapolated past a frame
+#define PREDICTOR_RESET_MS 500     // Gap between frames after which the filter starts over
+
+// Helper function prototypes
+static double ahead_seconds(const struct LandmarkPredictor *predictor, long long time_us);
+
+void landmark_predictor_init(struct LandmarkPredictor *predictor)
+{
+    memset(predictor, 0, sizeof(*predictor));
+}
+
+void landmark_predictor_update(struct LandmarkPredictor *predictor, const struct LandmarkFrame *frame)
+{
+    long long gap_us = frame->timestamp_us - predictor->last_frame_us;
+
+    // Start over on the first frame, or once the hand has been lost for a while
+    if (!predictor->has_frame || gap_us <= 0 || gap_us > PREDICTOR_RESET_MS * 1000LL){
+        for (int i = 0; i < LANDMARK_RING_NUM_VALUES; i++){
+            predictor->position[i] = frame->values[i];
+            predictor->velocity[i] = 0;
+        }
+    }
+    else{
+        double dt = gap_us / 1e6;
+        double ahead = ahead_seconds(predictor, frame->timestamp_us);
+        double predicted_error = 0;
+        double held_error = 0;
+
+        for (int i = 0; i < LANDMARK_RING_NUM_VALUES; i += 2){
+            double predicted_x = predictor->position[i] + predictor->velocity[i] * ahead;
+            double predicted_y = predictor->position[i + 1] + predictor->velocity[i + 1] * ahead;
+            double residual_x = frame->values[i] - predicted_x;
+            double residual_y = frame->values[i + 1] - predicted_y;
+
+            predicted_error += hypot(residual_x, residual_y);
+            held_error += hypot(frame->values[i] - predictor->last_values[i],
+                                frame->values[i + 1] - predictor->last_values[i + 1]);
+
+            predictor->position[i] = predicted_x + PREDICTOR_ALPHA * residual_x;
+            predictor->position[i + 1] = predicted_y + PREDICTOR_ALPHA * residual_y;
+            predictor->velocity[i] += PREDICTOR_BETA * residual_x / dt;
+            predictor->velocity[i + 1] += PREDICTOR_BETA * residual_y / dt;
+        }
+
+        // Averaged over the landmarks, in pixels
+        predictor->predicted_error_total += predicted_error / (LANDMARK_RING_NUM_VALUES / 2);
+        predictor->held_error_total += held_error / (LANDMARK_RING_NUM_VALUES / 2);
+        predictor->frames_compared++;
+    }
+
+    memcpy(predictor->last_values, frame->values, sizeof(predictor->last_values));
+    predictor->last_frame_us = frame->timestamp_us;
+    predictor->has_frame = true;
+}
+
+bool landmark_predictor_predict(const struct LandmarkPredictor *predictor, long long time_us,
+                                double landmarks[])
+{
+    if (!predictor->has_frame){
+        return false;
+    }
+
+    double ahead = ahead_seconds(predictor, time_us);
+    for (int i = 0; i < LANDMARK_RING_NUM_VALUES; i++){
+        landmarks[i] = predictor->position[i] + predictor->velocity[i] * ahead;
+    }
+    return true;
+}
+
+// Function to get how far past the last frame to extrapolate, within the horizon
+static double ahead_seconds(const struct LandmarkPredictor *predictor, long long time_us)
+{
+    long long ahead_us = time_us - predictor->last_frame_us;
+    if (ahead_us < 0){
+        return 0;
+    }
+    if (ahead_us > PREDICTOR_MAX_AHEAD_MS * 1000LL){
+        ahead_us = PREDICTOR_MAX_AHEAD_MS * 1000LL;
+    }
+    return ahead_us / 1e6;
+}
@@ -0,0 +1,121 @@
+/*
+ * This file implements the landmark ring module. Each slot carries the number
+ * of the frame it holds, cleared while the frame is being written, so readers
+ * copy a slot and then check the number is unchanged instead of locking. The
+ * writer never waits on a reader; a reader whose slot was overwritten mid-copy
+ * retries, or skips the frame when reading history.
+ */
+
+#include "landmark_ring.h"
+#include "utils.h"
+#include <stdatomic.h>
+#include <string.h>
+#include <assert.h>
+
+#define LANDMARK_RING_MASK (LANDMARK_RING_SIZE - 1)
+
+// Struct representing a slot of the ring
+struct LandmarkSlot {
+    atomic_ullong sequence; // Frame number held, or 0 while being written
+    struct LandmarkFrame frame;
+};
+
+// Struct representing the ring of one hand
+struct LandmarkRing {
+    struct LandmarkSlot slots[LANDMARK_RING_SIZE];
+    atomic_ullong latest_sequence; // Number of the latest frame published, 0 before the first one
+};
+
+static struct LandmarkRing rings[LANDMARK_MAX_HANDS];
+
+// Helper function prototypes
+static bool copy_frame(struct LandmarkRing *ring, unsigned long long sequence, struct LandmarkFrame *frame);
+
+void landmark_ring_publish(int hand, const int landmarks[], int size)
+{
+    assert(hand >= 0 && hand < LANDMARK_MAX_HANDS);
+    assert(size == LANDMARK_RING_NUM_VALUES);
+    struct LandmarkRing *ring = &rings[hand];
+    unsigned long long sequence = atomic_load_explicit(&ring->latest_sequence, memory_order_relaxed) + 1;
+    struct LandmarkSlot *slot = &ring->slots[sequence & LANDMARK_RING_MASK];
+
+    // Mark the slot as being written before touching the frame
+    atomic_store_explicit(&slot->sequence, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot->frame.hand = hand;
+    slot->frame.sequence = sequence;
+    slot->frame.timestamp_us = get_time_in_us();
+    memcpy(slot->frame.values, landmarks, sizeof(slot->frame.values));
+
+    atomic_store_explicit(&slot->sequence, sequence, memory_order_release);
+    atomic_store_explicit(&ring->latest_sequence, sequence, memory_order_release);
+}
+
+bool landmark_ring_read_latest(int hand, struct LandmarkFrame *frame)
+{
+    assert(hand >= 0 && hand < LANDMARK_MAX_HANDS);
+    struct LandmarkRing *ring = &rings[hand];
+
+    while (true) {
+        unsigned long long sequence = atomic_load_explicit(&ring->latest_sequence, memory_order_acquire);
+        if (sequence == 0) {
+            return false;
+        }
+        // Only fails if the writer lapped the whole ring during the copy
+        if (copy_frame(ring, sequence, frame)) {
+            return true;
+        }
+    }
+}
+
+void landmark_reader_init(struct LandmarkReader *reader, int hand)
+{
+    assert(hand >= 0 && hand < LANDMARK_MAX_HANDS);
+    reader->hand = hand;
+    reader->next_sequence = atomic_load_explicit(&rings[hand].latest_sequence, memory_order_acquire) + 1;
+    reader->dropped_frames = 0;
+}
+
+bool landmark_reader_next(struct LandmarkReader *reader, struct LandmarkFrame *frame)
+{
+    struct LandmarkRing *ring = &rings[reader->hand];
+
+    while (true) {
+        unsigned long long latest = atomic_load_explicit(&ring->latest_sequence, memory_order_acquire);
+        if (reader->next_sequence > latest) {
+            return false;
+        }
+
+        // Skip the frames that have already been overwritten
+        if (latest - reader->next_sequence >= LANDMARK_RING_SIZE) {
+            unsigned long long oldest = latest - LANDMARK_RING_SIZE + 1;
+            reader->dropped_frames += oldest - reader->next_sequence;
+            reader->next_sequence = oldest;
+        }
+
+        bool is_copied = copy_frame(ring, reader->next_sequence, frame);
+        if (!is_copied) {
+            reader->dropped_frames++;
+        }
+        reader->next_sequence++;
+        if (is_copied) {
+            return true;
+        }
+    }
+}
+
+// Copies a frame out of its slot, returning false if the slot no longer holds it
+static bool copy_frame(struct LandmarkRing *ring, unsigned long long sequence, struct LandmarkFrame *frame)
+{
+    struct LandmarkSlot *slot = &ring->slots[sequence & LANDMARK_RING_MASK];
+
+    if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != sequence) {
+        return false;
+    }
+    memcpy(frame, &slot->frame, sizeof(*frame));
+
+    // The copy is only valid if the writer did not start on the slot meanwhile
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&slot->sequence, memory_order_relaxed) == sequence;
+}
@@ -3,13 +3,16 @@
  * and visualzing the hand tracking data on the LCD screen.
  */
 
-#include "DEV_Config.h"
 #include "LCD_1in54.h"
 #include "GUI_Paint.h"
 #include "GUI_BMP.h"
 #include "fonts.h"
+#include "audio_effects.h"
 #include "dial_controls.h"
+#include "landmark_ring.h"
 #include "lcd_menus.h"
+#include "skeleton_raster.h"
+#include "hal_backend.h"
 #include "utils.h"
 #include <pthread.h>
 #include <stdbool.h>
@@ -24,7 +27,23 @@
 #define LCD_MIDPOINT_X (LCD_1IN54_WIDTH / 2)
 #define LCD_MIDPOINT_Y (LCD_1IN54_HEIGHT / 2)
 
-#define NUM_HAND_KEYPOINTS 42 // Number of keypoints in the hand tracking data
+#define HAND_SHOWN_MS 1000 // Time a hand stays on screen after its last frame
+#define JOINT_RADIUS 3
+#define BONES_ANTIALIASED true // Blend the edges of sloped bones into the background
+
+// Skeleton colour of each hand
+static const UWORD hand_colors[LANDMARK_MAX_HANDS] = {WHITE, GREEN, YELLOW, MAGENTA};
+
+// Landmarks joined by each bone, REFER TO JOINT MAP
+static const int bones[][2] = {
+  {0, 1}, {1, 2}, {2, 3}, {3, 4},        // wrist to thumb
+  {0, 5}, {5, 6}, {6, 7}, {7, 8},        // wrist to index tip
+  {5, 9}, {9, 13}, {13, 17},             // upper palm
+  {9, 10}, {10, 11}, {11, 12},           // base middle to middle tip
+  {13, 14}, {14, 15}, {15, 16},          // base ring to ring tip
+  {0, 17}, {17, 18}, {18, 19}, {19, 20}, // wrist to pinky tip
+};
+#define NUM_BONES ((int)(sizeof(bones) / sizeof(bones[0])))
 
 // lcd menu initializer
 bool is_initialized = false;
@@ -32,16 +51,13 @@ bool is_initialized = false;
 // Screen buffer
 static UWORD *s_fb;
 
-// Hand Datapoint Buffer
-static int hand_keypoints[NUM_HAND_KEYPOINTS];
-
 // Thread data
 static pthread_t lcdMenuThreadID;
-static pthread_mutex_t lcd_menu_mutex = PTHREAD_MUTEX_INITIALIZER;
 static void *lcd_menu_thread();
 
 // Helper function for each popup screen
-static void draw_hand_screen(int arr[], int size);
+static void draw_hand_screen(const struct LandmarkFrame frames[], int num_hands);
+static void draw_skeleton(const struct RasterImage *image, const int points[], int size, UWORD color);
 static void draw_volume_popup();
 static void draw_octave_popup();
 static void draw_waveform_popup();
@@ -51,15 +67,10 @@ static void draw_wave(char *wave);
 void lcd_menu_init()
 {
   assert(!is_initialized);
-  if (DEV_ModuleInit() != 0){
-    DEV_ModuleExit();
+  if (hal_backend_get()->display_init() != 0){
     exit(0);
   }
 
-  DEV_Delay_ms(2000);
-  LCD_1IN54_Init(HORIZONTAL);
-  LCD_1IN54_Clear(BLACK);
-  LCD_SetBacklight(1023);
   UDOUBLE Imagesize = LCD_1IN54_HEIGHT * LCD_1IN54_WIDTH * 2;
 
   if ((s_fb = (UWORD *)malloc(Imagesize)) == NULL){
@@ -74,20 +85,12 @@ void lcd_menu_init()
   }
 }
 
-void set_keypoint_buff(int new_keyponts[], int size)
-{
-  assert(size == NUM_HAND_KEYPOINTS);
-  pthread_mutex_lock(&lcd_menu_mutex);
-  memcpy(hand_keypoints, new_keyponts, sizeof(int) * size);
-  pthread_mutex_unlock(&lcd_menu_mutex);
-}
-
 void lcd_menu_cleanup()
 {
   assert(is_initialized);
   free(s_fb);
   s_fb = NULL;
-  DEV_ModuleExit();
+  hal_backend_get()->display_exit();
   is_initialized = false;
   pthread_join(lcdMenuThreadID, NULL);
 }
@@ -96,75 +99,38 @@ void lcd_menu_cleanup()
 static void *lcd_menu_thread()
 {
   assert(is_initialized);
+
+  struct LandmarkFrame frames[LANDMARK_MAX_HANDS];
   while (is_initialized){
 
-    int keypoints[NUM_HAND_KEYPOINTS];
-    pthread_mutex_lock(&lcd_menu_mutex);
-    {
-      memcpy(keypoints, hand_keypoints, sizeof(int) * NUM_HAND_KEYPOINTS);
+    // Only the newest frame of each hand still tracked is drawn
+    int num_hands = 0;
+    long long now_us = get_time_in_us();
+    for (int hand = 0; hand < LANDMARK_MAX_HANDS; hand++){
+      if (landmark_ring_read_latest(hand, &frames[num_hands])
+          && now_us - frames[num_hands].timestamp_us < HAND_SHOWN_MS * 1000LL){
+        num_hands++;
+      }
     }
-    pthread_mutex_unlock(&lcd_menu_mutex);
-    draw_hand_screen(keypoints, NUM_HAND_KEYPOINTS);
+    draw_hand_screen(frames, num_hands);
     sleep_for_ms(100);
   }
   pthread_exit(NULL);
 }
 
-// Function to draw the volume popup
-static void draw_hand_screen(int points[], int size)
+// Function to draw the skeleton of every hand shown, with any popup on top
+static void draw_hand_screen(const struct LandmarkFrame frames[], int num_hands)
 {
   assert(is_initialized);
-  assert(size == NUM_HAND_KEYPOINTS);
-  const int joint_radius = 3;
 
   Paint_NewImage(s_fb, LCD_1IN54_WIDTH, LCD_1IN54_HEIGHT, 0, BLACK, 16);
   Paint_Clear(BLACK);
 
-  // draw joint points on scree
-  for (int i = 0; i < size - 1; i += 2){
-
-    int x = points[i];
-    int y = points[i + 1];
-
-    if (x > 0 && x < LCD_1IN54_WIDTH && y > 0 && y < LCD_1IN54_HEIGHT){
-      Paint_DrawCircle(x, y, joint_radius, WHITE, DOT_PIXEL_1X1, DRAW_FILL_FULL);
-    }
+  const struct RasterImage image = {s_fb, LCD_1IN54_WIDTH, LCD_1IN54_HEIGHT};
+  for (int i = 0; i < num_hands; i++){
+    draw_skeleton(&image, frames[i].values, LANDMARK_RING_NUM_VALUES, hand_colors[frames[i].hand]);
   }
 
-  // draw joint connections REFER TO JOINT MAP
-  // wrist to thumb
-  Paint_DrawLine(points[0], points[1], points[2], points[3], WHITE, DOT_PIXEL_1X1, LINE_STYLE_DOTTED); // 0-1
-  Paint_DrawLine(points[2], points[3], points[4], points[5], WHITE, DOT_PIXEL_1X1, LINE_STYLE_DOTTED); // 1-2
-  Paint_DrawLine(points[4], points[5], points[6], points[7], WHITE, DOT_PIXEL_1X1, LINE_STYLE_DOTTED); // 2-3
-  Paint_DrawLine(points[6], points[7], points[8], points[9], WHITE, DOT_PIXEL_1X1, LINE_STYLE_DOTTED); // 3-4
-
-  // wrist to index tip
-  Paint_DrawLine(points[0], points[1], points[10], points[11], WHITE, DOT_PIXEL_1X1, LINE_STYLE_DOTTED);   // 0-5
-  Paint_DrawLine(points[10], points[11], points[12], points[13], WHITE, DOT_PIXEL_1X1, LINE_STYLE_DOTTED); // 5-6
-  Paint_DrawLine(points[12], points[13], points[14], points[15], WHITE, DOT_PIXEL_1X1, LINE_STYLE_DOTTED); // 6-7
-  Paint_DrawLine(points[14], points[15], points[16], points[17], WHITE, DOT_PIXEL_1X1, LINE_STYLE_DOTTED); // 7-8
-
-  // upper palm
-  Paint_DrawLine(points[10], points[11], points[18], points[19], WHITE, DOT_PIXEL_1X1, LINE_STYLE_DOTTED); // 5-9
-  Paint_DrawLine(points[18], points[19], points[26], points[27], WHITE, DOT_PIXEL_1X1, LINE_STYLE_DOTTED); // 9-13
-  Paint_DrawLine(points[26], points[27], points[34], points[35], WHITE, DOT_PIXEL_1X1, LINE_STYLE_DOTTED); // 13-17
-
-  // base middle to middle tip
-  Paint_DrawLine(points[18], points[19], points[20], points[21], WHITE, DOT_PIXEL_1X1, LINE_STYLE_DOTTED); // 9-10
-  Paint_DrawLine(points[20], points[21], points[22], points[23], WHITE, DOT_PIXEL_1X1, LINE_STYLE_DOTTED); // 10-11
-  Paint_DrawLine(points[22], points[23], points[24], points[25], WHITE, DOT_PIXEL_1X1, LINE_STYLE_DOTTED); // 11-12
-
-  // base ring to ring tip
-  Paint_DrawLine(points[26], points[27], points[28], points[29], WHITE, DOT_PIXEL_1X1, LINE_STYLE_DOTTED); // 13-14
-  Paint_DrawLine(points[28], points[29], points[30], points[31], WHITE, DOT_PIXEL_1X1, LINE_STYLE_DOTTED); // 14-15
-  Paint_DrawLine(points[30], points[31], points[32], points[33], WHITE, DOT_PIXEL_1X1, LINE_STYLE_DOTTED); // 15-16
-
-  // wrist to pinky tip
-  Paint_DrawLine(points[0], points[1], points[34], points[35], WHITE, DOT_PIXEL_1X1, LINE_STYLE_DOTTED);   // 0-17
-  Paint_DrawLine(points[34], points[35], points[36], points[37], WHITE, DOT_PIXEL_1X1, LINE_STYLE_DOTTED); // 17-18
-  Paint_DrawLine(points[36], points[37], points[38], points[39], WHITE, DOT_PIXEL_1X1, LINE_STYLE_DOTTED); // 18-19
-  Paint_DrawLine(points[38], points[39], points[40], points[41], WHITE, DOT_PIXEL_1X1, LINE_STYLE_DOTTED); // 19-20
-
   // get current joystick state. If necessary we draw the corresponding popup ONTOP
   Control curr_control = get_current_control();
   switch (curr_control){
@@ -186,7 +152,31 @@ static void draw_hand_screen(int points[], int size)
       break;
   }
 
-  LCD_1IN54_Display(s_fb);
+  hal_backend_get()->display_show(s_fb);
+}
+
+// Function to draw the joints and bones of one hand, straight into the screen buffer
+static void draw_skeleton(const struct RasterImage *image, const int points[], int size, UWORD color)
+{
+  assert(size == LANDMARK_RING_NUM_VALUES);
+
+  // draw joint points on scree
+  for (int i = 0; i < size - 1; i += 2){
+
+    int x = points[i];
+    int y = points[i + 1];
+
+    if (x > 0 && x < LCD_1IN54_WIDTH && y > 0 && y < LCD_1IN54_HEIGHT){
+      skeleton_raster_disc(image, x, y, JOINT_RADIUS, color);
+    }
+  }
+
+  // draw joint connections
+  for (int i = 0; i < NUM_BONES; i++){
+    const int *from = &points[2 * bones[i][0]];
+    const int *to = &points[2 * bones[i][1]];
+    skeleton_raster_line(image, from[0], from[1], to[0], to[1], color, true, BONES_ANTIALIASED);
+  }
 }
 
 // Function to draw the volume popup
@@ -280,6 +270,10 @@ static void draw_waveform_popup()
       draw_wave("DECAYING SINE WAVE");
       break;
 
+    case SINEMIXER_WAVE_NOISE:
+      draw_wave("NOISE");
+      break;
+
     default:
       break;
   }
@@ -291,10 +285,18 @@ static void draw_distortion_popup()
   Paint_DrawRectangle(POPUP_MARGIN_X - POPUP_BORDER_WIDTH, POPUP_MARGIN_Y - POPUP_BORDER_WIDTH, LCD_1IN54_WIDTH - POPUP_MARGIN_X + POPUP_BORDER_WIDTH, LCD_1IN54_HEIGHT - POPUP_MARGIN_Y + POPUP_BORDER_WIDTH, WHITE, DOT_PIXEL_1X1, DRAW_FILL_FULL);
   Paint_DrawRectangle(POPUP_MARGIN_X, POPUP_MARGIN_Y, LCD_1IN54_WIDTH - POPUP_MARGIN_X, LCD_1IN54_HEIGHT - POPUP_MARGIN_Y, BLACK, DOT_PIXEL_1X1, DRAW_FILL_FULL);
 
-  double distortion = get_distortion();
-  char *msg = "Distortion: ";
+  // Show whichever setting the dial currently adjusts
+  int selection = get_effect_selection();
   char msg_buff[20];
-  snprintf(msg_buff, sizeof(msg_buff), "%s%.3f", msg, distortion);
+  if (selection == EFFECT_SELECTION_DISTORTION){
+    double distortion = get_distortion();
+    char *msg = "Distortion: ";
+    snprintf(msg_buff, sizeof(msg_buff), "%s%.3f", msg, distortion);
+  }
+  else{
+    snprintf(msg_buff, sizeof(msg_buff), "%s: %d", audio_effects_get_param_name(selection),
+             audio_effects_get_param(selection));
+  }
 
   sFONT font_choice = Font12;
   int x_offset = LCD_MIDPOINT_X - (strlen(msg_buff) * font_choice.Width / 2);
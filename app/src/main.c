@@ -5,11 +5,135 @@
  */
 
 #include "program_manager.h"
+#include "hand_commands.h"
+#include "hal_backend.h"
+#include "modulation.h"
+#include "scale_engine.h"
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 #include <stdio.h> 
 
-int main() 
+// Names accepted by "--pitch" and "--pitch-source"
+static const char *pitch_mode_names[] = {"gesture", "free", "quantized", "snap"};
+static const char *pitch_source_names[] = {"x", "y", "pinch"};
+
+// Names accepted by "--root", in rising order from C
+static const char *root_names[] = {"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"};
+
+// Names accepted by "--mod"
+static const char *modulation_source_names[] = {"lfo1", "lfo2", "lfo3", "noise", "distance", "hand-x", "hand-y"};
+static const char *modulation_dest_names[] = {"pitch", "gain", "cutoff", "morph"};
+#define NUM_NAMES(names) ((int)(sizeof(names) / sizeof(names[0])))
+
+// Finds a name in a list, returning its index or -1
+static int find_name(const char *name, const char *names[], int count)
 {
+    for (int i = 0; i < count; i++){
+        if (strcmp(name, names[i]) == 0){
+            return i;
+        }
+    }
+    return -1;
+}
+
+int main(int argc, char *argv[]) 
+{
+    HandPitchMode pitch_mode = HAND_PITCH_GESTURE;
+    HandPitchSource pitch_source = HAND_PITCH_FROM_Y;
+    int prediction_lead_ms = -1;
+
+    for (int i = 1; i < argc; i++){
+        // Run against simulated devices with "--sim [seconds]", e.g. for soak tests
+        if (strcmp(argv[i], "--sim") == 0){
+            if (i + 1 < argc && argv[i + 1][0] != '-'){
+                hal_backend_simulated_set_run_time(atoi(argv[++i]));
+            }
+            hal_backend_select(&hal_backend_simulated);
+        }
+        // Play continuously from the hand with "--pitch free|quantized|snap"
+        else if (strcmp(argv[i], "--pitch") == 0 && i + 1 < argc){
+            int mode = find_name(argv[++i], pitch_mode_names, NUM_NAMES(pitch_mode_names));
+            if (mode < 0){
+                fprintf(stderr, "Unknown pitch mode: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            pitch_mode = mode;
+        }
+        // Choose what the continuous pitch follows with "--pitch-source x|y|pinch"
+        else if (strcmp(argv[i], "--pitch-source") == 0 && i + 1 < argc){
+            int source = find_name(argv[++i], pitch_source_names, NUM_NAMES(pitch_source_names));
+            if (source < 0){
+                fprintf(stderr, "Unknown pitch source: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            pitch_source = source;
+        }
+        // Set how far ahead the continuous pitch predicts the hand with "--predict-lead ms"
+        else if (strcmp(argv[i], "--predict-lead") == 0 && i + 1 < argc){
+            prediction_lead_ms = atoi(argv[++i]);
+            if (prediction_lead_ms < 0){
+                fprintf(stderr, "Invalid prediction lead: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+        }
+        // Choose the notes played with "--scale chromatic|major|minor|pentatonic|blues"
+        else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc){
+            if (scale_engine_set_scale(argv[++i]) != 0){
+                fprintf(stderr, "Unknown scale: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+        }
+        // Choose the note the scale starts from with "--root C|C#|...|B"
+        else if (strcmp(argv[i], "--root") == 0 && i + 1 < argc){
+            int root = find_name(argv[++i], root_names, NUM_NAMES(root_names));
+            if (root < 0){
+                fprintf(stderr, "Unknown root: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            scale_engine_set_root(SCALE_DEFAULT_ROOT + root);
+        }
+        // Choose how the steps of the octave are tuned with "--tuning equal|just|file.scl"
+        else if (strcmp(argv[i], "--tuning") == 0 && i + 1 < argc){
+            i++;
+            if (strcmp(argv[i], "equal") == 0){
+                scale_engine_set_equal_temperament();
+            }
+            else if (strcmp(argv[i], "just") == 0){
+                scale_engine_set_just_intonation();
+            }
+            else if (scale_engine_load_scala(argv[i]) != 0){
+                fprintf(stderr, "Unable to read Scala tuning: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+        }
+        // Route a modulation source with "--mod source:destination:amount", e.g. "--mod lfo2:cutoff:50"
+        else if (strcmp(argv[i], "--mod") == 0 && i + 1 < argc){
+            char source_name[16];
+            char dest_name[16];
+            int amount;
+            if (sscanf(argv[++i], "%15[^:]:%15[^:]:%d", source_name, dest_name, &amount) != 3){
+                fprintf(stderr, "Invalid modulation route: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            int source = find_name(source_name, modulation_source_names, NUM_NAMES(modulation_source_names));
+            int dest = find_name(dest_name, modulation_dest_names, NUM_NAMES(modulation_dest_names));
+            if (source < 0 || dest < 0){
+                fprintf(stderr, "Unknown modulation route: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            modulation_set_route(source, dest, amount);
+        }
+        else{
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+    command_handler_set_pitch_mode(pitch_mode, pitch_source);
+    if (prediction_lead_ms >= 0){
+        command_handler_set_prediction_lead(prediction_lead_ms);
+    }
+
     program_manager_init();
 
     program_wait_to_end();
@@ -9,27 +9,83 @@
 #include "button_controls.h"
 #include "distance_sensor.h"
 #include "hand_commands.h"
+#include "scale_engine.h"
 #include "dial_controls.h"
 #include "udp_controls.h"
 #include "sine_mixer.h"
 #include "lcd_menus.h"
+#include "hal_backend.h"
+#include "event_loop.h"
 #include "utils.h"
-#include "gpio.h"
+#include <pthread.h>
+#include <stdlib.h>
 #include <stdio.h>
 
+// Bit of each subsystem, for naming the ones another waits on
+#define EVENT_LOOP (1u << 0)
+#define SINE_MIXER (1u << 1)
+#define SCALE_ENGINE (1u << 2)
+#define DIAL_CONTROLS (1u << 3)
+#define BUTTON_CONTROLS (1u << 4)
+#define UDP (1u << 5)
+#define DISTANCE_SENSOR (1u << 6)
+#define DISTANCE_ARTICULATOR (1u << 7)
+#define COMMAND_HANDLER (1u << 8)
+#define LCD_MENUS (1u << 9)
+
+// Struct representing a subsystem, started as soon as the ones it needs are up
+struct Subsystem {
+    const char *name;
+    unsigned bit;
+    unsigned needs;
+    void (*init)(void);
+    long long start_ns; // Times from the start of init, for the profile
+    long long ready_ns;
+};
+
+// Every subsystem, audio first, and the slow display last
+static struct Subsystem subsystems[] = {
+    {"sine mixer", SINE_MIXER, 0, sine_mixer_init, 0, 0},
+    {"event loop", EVENT_LOOP, 0, event_loop_init, 0, 0},
+    {"scale engine", SCALE_ENGINE, 0, scale_engine_init, 0, 0},
+    {"command handler", COMMAND_HANDLER, SCALE_ENGINE | SINE_MIXER, command_handler_init, 0, 0},
+    {"udp", UDP, EVENT_LOOP, udp_init, 0, 0},
+    {"distance sensor", DISTANCE_SENSOR, 0, distance_sensor_init, 0, 0},
+    {"distance articulator", DISTANCE_ARTICULATOR, DISTANCE_SENSOR | SINE_MIXER, distance_articulator_init, 0, 0},
+    {"dial controls", DIAL_CONTROLS, EVENT_LOOP, dial_controls_init, 0, 0},
+    {"button controls", BUTTON_CONTROLS, EVENT_LOOP | DIAL_CONTROLS, button_controls_init, 0, 0},
+    {"lcd menus", LCD_MENUS, DIAL_CONTROLS, lcd_menu_init, 0, 0},
+};
+#define NUM_SUBSYSTEMS ((int)(sizeof(subsystems) / sizeof(subsystems[0])))
+
+// Subsystems up so far, and the start of init the profile is timed from
+static unsigned started = 0;
+static long long init_start_ns = 0;
+static pthread_mutex_t started_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t started_cond = PTHREAD_COND_INITIALIZER;
+
 // Global variable to signal the end of the program
 volatile bool exit_theremin_program = false;
 
+// Helper function prototypes
+static void *start_subsystem(void *arg);
+static void print_startup_profile(void);
+
 void program_manager_init(void)
 {
-    sine_mixer_init();
-    lcd_menu_init();
-    udp_init();
-    distance_sensor_init();
-    distance_articulator_init();
-    command_handler_init();
-    dial_controls_init();
-    button_controls_init();
+    // Each subsystem starts on its own thread, so a slow one only holds up those that need it
+    pthread_t threads[NUM_SUBSYSTEMS];
+    init_start_ns = get_monotonic_time_in_ns();
+    for (int i = 0; i < NUM_SUBSYSTEMS; i++){
+        if (pthread_create(&threads[i], NULL, start_subsystem, &subsystems[i]) != 0){
+            perror("Failed to create startup thread");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int i = 0; i < NUM_SUBSYSTEMS; i++){
+        pthread_join(threads[i], NULL);
+    }
+    print_startup_profile();
 }
 
 void program_wait_to_end()
@@ -44,10 +100,53 @@ void program_manager_cleanup(void)
     udp_cleanup();
     button_controls_cleanup();
     dial_controls_cleanup();
-    gpio_cleanup();
+    event_loop_cleanup();
+    hal_backend_get()->gpio_cleanup();
     distance_articulator_cleanup();
     distance_sensor_cleanup();
     command_handler_cleanup();
+    scale_engine_cleanup();
     lcd_menu_cleanup();
     sine_mixer_cleanup();
-}
\ No newline at end of file
+}
+
+// Thread function that starts a subsystem once the ones it needs are up
+static void *start_subsystem(void *arg)
+{
+    struct Subsystem *subsystem = arg;
+
+    pthread_mutex_lock(&started_mutex);
+    {
+        while ((started & subsystem->needs) != subsystem->needs){
+            pthread_cond_wait(&started_cond, &started_mutex);
+        }
+    }
+    pthread_mutex_unlock(&started_mutex);
+
+    subsystem->start_ns = get_monotonic_time_in_ns() - init_start_ns;
+    subsystem->init();
+    subsystem->ready_ns = get_monotonic_time_in_ns() - init_start_ns;
+
+    pthread_mutex_lock(&started_mutex);
+    {
+        started |= subsystem->bit;
+        pthread_cond_broadcast(&started_cond);
+    }
+    pthread_mutex_unlock(&started_mutex);
+    return NULL;
+}
+
+// Function to print when each subsystem started and was ready
+static void print_startup_profile(void)
+{
+    printf("\nStartup profile (ms from start of init):\n");
+    long long all_ready_ns = 0;
+    for (int i = 0; i < NUM_SUBSYSTEMS; i++){
+        printf("  %-22s start %7.1f  ready %7.1f\n", subsystems[i].name,
+               subsystems[i].start_ns / 1e6, subsystems[i].ready_ns / 1e6);
+        if (subsystems[i].ready_ns > all_ready_ns){
+            all_ready_ns = subsystems[i].ready_ns;
+        }
+    }
+    printf("Audio live after %.1f ms, everything after %.1f ms\n", subsystems[0].ready_ns / 1e6, all_ready_ns / 1e6);
+}
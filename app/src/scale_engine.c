@@ -0,0 +1,380 @@
+/*
+ * This file implements the scale engine module. The settings are only
+ * touched by the setters, under a lock, and each change builds a complete
+ * new table of notes before publishing it. Readers load the table pointer
+ * and index into it. A table that has been replaced may still be in use
+ * by a reader, so it is kept until cleanup rather than freed; settings
+ * only change a handful of times per session.
+ */
+
+#include "scale_engine.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <math.h>
+
+#define NOTE_A4_BASE 440.0 // Base frequency for A4 note
+#define NUM_OCTAVES (SCALE_MAX_OCTAVE - SCALE_MIN_OCTAVE + 1)
+#define SCALA_LINE_LENGTH 256
+
+// Struct representing a tuning, the pitch of each step of the octave above the root
+struct Tuning {
+    int steps;
+    double cents[SCALE_MAX_STEPS]; // In rising order, the first being the root at 0
+    double period_cents;           // Interval the steps repeat at, 1200 for an octave
+};
+
+// Struct representing a scale, its degrees in semitones above the root
+struct Scale {
+    const char *name;
+    int degrees[12];
+    int size; // 0 plays every step of the tuning
+};
+
+static const struct Scale scales[] = {
+    {"chromatic", {0}, 0},
+    {"major", {0, 2, 4, 5, 7, 9, 11}, 7},
+    {"minor", {0, 2, 3, 5, 7, 8, 10}, 7},
+    {"pentatonic", {0, 2, 4, 7, 9}, 5},
+    {"blues", {0, 3, 5, 6, 7, 10}, 6},
+};
+#define NUM_SCALES ((int)(sizeof(scales) / sizeof(scales[0])))
+
+// Five-limit just intonation ratios of the twelve steps above the root
+static const double just_ratios[12] = {
+    1.0, 16.0 / 15, 9.0 / 8, 6.0 / 5, 5.0 / 4, 4.0 / 3, 45.0 / 32, 3.0 / 2, 8.0 / 5, 5.0 / 3, 9.0 / 5, 15.0 / 8,
+};
+
+// Place of each gesture in the climb up a scale, in the order of the original
+// chromatic layout, with the two gestures it left unused played last
+static const int scale_places[SCALE_NUM_GESTURES] = {
+    0, 1, 6, 7, 4, 5, 10, 11, 2, 3, 14, 15, 8, 9, 12, 13,
+};
+
+// Place of each gesture in the chromatic climb, the original layout exactly:
+// 0x5 and 0x2 both play F, so the top of the layout is the C above the root
+static const int chromatic_places[SCALE_NUM_GESTURES] = {
+    0, 1, 5, 6, 4, 5, 9, 10, 2, 3, 13, 14, 7, 8, 11, 12,
+};
+
+// Struct representing the precomputed notes, never changed once published
+struct ScaleTables {
+    int root;
+    int num_degrees;
+    double degree_semitones[SCALE_MAX_STEPS]; // Each note of the scale above the root
+    double period_semitones;
+    double gesture_frequencies[NUM_OCTAVES][SCALE_NUM_GESTURES];
+    struct ScaleTables *retired_next;         // Next older table, once replaced
+};
+
+// Settings, only used under the lock
+static struct Tuning tuning;
+static const struct Scale *scale = &scales[0];
+static int root = SCALE_DEFAULT_ROOT;
+static struct ScaleTables *retired_tables = NULL;
+static pthread_mutex_t settings_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Table read by the lookups
+static _Atomic(struct ScaleTables *) current_tables = NULL;
+
+// Module initialization status
+static bool is_initialized = false;
+
+// Helper function prototypes
+static void publish_tables(void);
+static struct ScaleTables *build_tables(void);
+static void set_equal_temperament(struct Tuning *new_tuning);
+static bool parse_pitch(const char *text, double *cents);
+static int compare_cents(const void *a, const void *b);
+
+void scale_engine_init(void)
+{
+    assert(!is_initialized);
+    pthread_mutex_lock(&settings_lock);
+    {
+        if (tuning.steps == 0){
+            set_equal_temperament(&tuning);
+        }
+        is_initialized = true;
+        publish_tables();
+    }
+    pthread_mutex_unlock(&settings_lock);
+}
+
+void scale_engine_set_equal_temperament(void)
+{
+    pthread_mutex_lock(&settings_lock);
+    {
+        set_equal_temperament(&tuning);
+        publish_tables();
+    }
+    pthread_mutex_unlock(&settings_lock);
+}
+
+void scale_engine_set_just_intonation(void)
+{
+    pthread_mutex_lock(&settings_lock);
+    {
+        tuning.steps = 12;
+        for (int i = 0; i < 12; i++){
+            tuning.cents[i] = 1200 * log2(just_ratios[i]);
+        }
+        tuning.period_cents = 1200;
+        publish_tables();
+    }
+    pthread_mutex_unlock(&settings_lock);
+}
+
+int scale_engine_load_scala(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL){
+        return -1;
+    }
+
+    // After comments starting with '!', a description line, the number of
+    // pitches, then each pitch with the period last
+    struct Tuning new_tuning = {.steps = 1, .cents = {0}, .period_cents = 0};
+    char line[SCALA_LINE_LENGTH];
+    bool has_description = false;
+    int num_pitches = -1;
+    int pitches_read = 0;
+    bool is_valid = true;
+
+    while (is_valid && pitches_read != num_pitches && fgets(line, sizeof(line), file) != NULL){
+        char *text = line;
+        while (isspace((unsigned char)*text)){
+            text++;
+        }
+        if (*text == '!'){
+            continue;
+        }
+        if (!has_description){
+            has_description = true;
+            continue;
+        }
+        if (*text == '\0'){
+            continue;
+        }
+
+        if (num_pitches < 0){
+            num_pitches = atoi(text);
+            is_valid = num_pitches >= 1 && num_pitches <= SCALE_MAX_STEPS;
+            continue;
+        }
+
+        double cents;
+        is_valid = parse_pitch(text, &cents);
+        pitches_read++;
+        if (is_valid && pitches_read == num_pitches){
+            new_tuning.period_cents = cents;
+        }
+        else if (is_valid){
+            new_tuning.cents[new_tuning.steps++] = cents;
+        }
+    }
+    fclose(file);
+
+    if (!is_valid || num_pitches < 0 || pitches_read != num_pitches || new_tuning.period_cents <= 0){
+        return -1;
+    }
+    qsort(new_tuning.cents, new_tuning.steps, sizeof(new_tuning.cents[0]), compare_cents);
+
+    pthread_mutex_lock(&settings_lock);
+    {
+        tuning = new_tuning;
+        publish_tables();
+    }
+    pthread_mutex_unlock(&settings_lock);
+    return 0;
+}
+
+void scale_engine_set_root(int semitones)
+{
+    pthread_mutex_lock(&settings_lock);
+    {
+        root = semitones;
+        publish_tables();
+    }
+    pthread_mutex_unlock(&settings_lock);
+}
+
+int scale_engine_get_root(void)
+{
+    const struct ScaleTables *tables = atomic_load_explicit(&current_tables, memory_order_acquire);
+    return tables != NULL ? tables->root : root;
+}
+
+int scale_engine_set_scale(const char *name)
+{
+    for (int i = 0; i < NUM_SCALES; i++){
+        if (strcmp(name, scales[i].name) == 0){
+            pthread_mutex_lock(&settings_lock);
+            {
+                scale = &scales[i];
+                publish_tables();
+            }
+            pthread_mutex_unlock(&settings_lock);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+double scale_engine_gesture_frequency(int gesture, int octave)
+{
+    assert(gesture >= 0 && gesture < SCALE_NUM_GESTURES);
+    assert(octave >= SCALE_MIN_OCTAVE && octave <= SCALE_MAX_OCTAVE);
+    const struct ScaleTables *tables = atomic_load_explicit(&current_tables, memory_order_acquire);
+    return tables->gesture_frequencies[octave - SCALE_MIN_OCTAVE][gesture];
+}
+
+double scale_engine_nearest_note(double semitones)
+{
+    const struct ScaleTables *tables = atomic_load_explicit(&current_tables, memory_order_acquire);
+
+    // Work from the root, where the scale degrees start
+    double from_root = semitones - tables->root;
+    double period = floor(from_root / tables->period_semitones);
+    double degree = from_root - period * tables->period_semitones;
+
+    // The root of the next period may be closer than any degree of this one
+    double nearest = tables->period_semitones;
+    for (int i = 0; i < tables->num_degrees; i++){
+        if (fabs(degree - tables->degree_semitones[i]) < fabs(degree - nearest)){
+            nearest = tables->degree_semitones[i];
+        }
+    }
+    return tables->root + period * tables->period_semitones + nearest;
+}
+
+void scale_engine_cleanup(void)
+{
+    assert(is_initialized);
+    pthread_mutex_lock(&settings_lock);
+    {
+        free(atomic_exchange(&current_tables, NULL));
+        while (retired_tables != NULL){
+            struct ScaleTables *next = retired_tables->retired_next;
+            free(retired_tables);
+            retired_tables = next;
+        }
+        is_initialized = false;
+    }
+    pthread_mutex_unlock(&settings_lock);
+}
+
+// Builds tables from the settings and makes them the current ones. Called with the lock held.
+static void publish_tables(void)
+{
+    if (!is_initialized){
+        return;
+    }
+    struct ScaleTables *old_tables = atomic_exchange_explicit(&current_tables, build_tables(),
+                                                              memory_order_acq_rel);
+    if (old_tables != NULL){
+        old_tables->retired_next = retired_tables;
+        retired_tables = old_tables;
+    }
+}
+
+// Works out every note of the scale from the settings. Called with the lock held.
+static struct ScaleTables *build_tables(void)
+{
+    struct ScaleTables *tables = malloc(sizeof(*tables));
+    if (tables == NULL){
+        perror("Unable to allocate scale tables");
+        exit(EXIT_FAILURE);
+    }
+    tables->root = root;
+    tables->period_semitones = tuning.period_cents / 100;
+    tables->retired_next = NULL;
+
+    // Each degree of the scale plays the step of the tuning closest to it
+    int num_degrees = 0;
+    int steps_of_degrees[SCALE_MAX_STEPS];
+    int scale_size = scale->size > 0 ? scale->size : tuning.steps;
+    for (int i = 0; i < scale_size; i++){
+        int step = i;
+        if (scale->size > 0){
+            step = 0;
+            for (int s = 1; s < tuning.steps; s++){
+                if (fabs(tuning.cents[s] - 100.0 * scale->degrees[i])
+                    < fabs(tuning.cents[step] - 100.0 * scale->degrees[i])){
+                    step = s;
+                }
+            }
+        }
+        if (num_degrees == 0 || steps_of_degrees[num_degrees - 1] != step){
+            steps_of_degrees[num_degrees] = step;
+            tables->degree_semitones[num_degrees] = tuning.cents[step] / 100;
+            num_degrees++;
+        }
+    }
+    tables->num_degrees = num_degrees;
+
+    // The gestures climb the scale from the root, into the next period once past its top
+    double root_hz = NOTE_A4_BASE * pow(2, root / 12.0);
+    const int *places = scale->size > 0 ? scale_places : chromatic_places;
+    for (int octave = SCALE_MIN_OCTAVE; octave <= SCALE_MAX_OCTAVE; octave++){
+        for (int gesture = 0; gesture < SCALE_NUM_GESTURES; gesture++){
+            int place = places[gesture];
+            double cents = (octave + place / num_degrees) * tuning.period_cents
+                           + tables->degree_semitones[place % num_degrees] * 100;
+            tables->gesture_frequencies[octave - SCALE_MIN_OCTAVE][gesture] = root_hz * pow(2, cents / 1200);
+        }
+    }
+    return tables;
+}
+
+// Fills in twelve-tone equal temperament
+static void set_equal_temperament(struct Tuning *new_tuning)
+{
+    new_tuning->steps = 12;
+    for (int i = 0; i < 12; i++){
+        new_tuning->cents[i] = 100.0 * i;
+    }
+    new_tuning->period_cents = 1200;
+}
+
+// Reads a Scala pitch, in cents if it has a decimal point, otherwise a ratio like 3/2 or 2.
+// Anything after the pitch is a comment.
+static bool parse_pitch(const char *text, double *cents)
+{
+    char *end;
+    size_t length = strcspn(text, " \t\r\n");
+    if (memchr(text, '.', length) != NULL){
+        *cents = strtod(text, &end);
+        return end != text;
+    }
+
+    long numerator = strtol(text, &end, 10);
+    long denominator = 1;
+    if (end == text){
+        return false;
+    }
+    if (*end == '/'){
+        const char *denominator_text = end + 1;
+        denominator = strtol(denominator_text, &end, 10);
+        if (end == denominator_text){
+            return false;
+        }
+    }
+    if (numerator <= 0 || denominator <= 0){
+        return false;
+    }
+    *cents = 1200 * log2((double)numerator / denominator);
+    return true;
+}
+
+// Function to order pitches in cents, for qsort
+static int compare_cents(const void *a, const void *b)
+{
+    double difference = *(const double *)a - *(const double *)b;
+    return (difference > 0) - (difference < 0);
+}
@@ -0,0 +1,166 @@
+/*
+ * This file implements the skeleton raster module. A line is walked with a
+ * pointer into the image that moves by one pixel along a row or by the
+ * width between rows, so its loop has no multiplications or bounds checks.
+ * Wu's algorithm keeps the position across the line as a 16 bit fraction,
+ * and its top bits look up how much of the colour each of the two pixels
+ * gets.
+ */
+
+#include "skeleton_raster.h"
+#include "GUI_Paint.h"
+#include <stddef.h>
+#include <stdlib.h>
+
+#define COVERAGE_BITS 4 // Bits of the fraction across the line that choose a blend weight
+#define BLEND_BITS 5    // Blend weights run from 0 to 1 << BLEND_BITS, all line colour
+
+// Blend weight of each coverage of a pixel. Gamma corrected, so the two pixels
+// of a step look as bright together as a single pixel does.
+static const uint8_t coverage_weights[1 << COVERAGE_BITS] = {
+    0, 9, 13, 15, 18, 19, 21, 23, 24, 25, 27, 28, 29, 30, 31, 32,
+};
+
+// Helper function prototypes
+static void draw_bresenham(uint16_t *pixel, int major, int minor, ptrdiff_t major_step,
+                           ptrdiff_t minor_step, uint16_t color, bool dotted);
+static void draw_wu(uint16_t *pixel, int major, int minor, ptrdiff_t major_step,
+                    ptrdiff_t minor_step, uint16_t color, bool dotted);
+static void blend_pixel(uint16_t *pixel, uint16_t color, int weight);
+static void fill_span(const struct RasterImage *image, int y, int left, int right, uint16_t color);
+static bool is_inside(const struct RasterImage *image, int x, int y);
+
+void skeleton_raster_line(const struct RasterImage *image, int x0, int y0, int x1, int y1,
+                          uint16_t color, bool dotted, bool antialiased)
+{
+    if (!is_inside(image, x0, y0) || !is_inside(image, x1, y1)) {
+        return;
+    }
+
+    // Each step moves a pixel along the longer axis, and some steps one across it too
+    int dx = abs(x1 - x0);
+    int dy = abs(y1 - y0);
+    ptrdiff_t step_x = x1 >= x0 ? 1 : -1;
+    ptrdiff_t step_y = y1 >= y0 ? image->width : -image->width;
+    uint16_t *pixel = image->pixels + (ptrdiff_t)y0 * image->width + x0;
+
+    // Straight and diagonal lines cover whole pixels, so have nothing to blend
+    if (antialiased && dy != 0 && dx != 0 && dx != dy) {
+        if (dx > dy) {
+            draw_wu(pixel, dx, dy, step_x, step_y, color, dotted);
+        }
+        else {
+            draw_wu(pixel, dy, dx, step_y, step_x, color, dotted);
+        }
+    }
+    else if (dx >= dy) {
+        draw_bresenham(pixel, dx, dy, step_x, step_y, color, dotted);
+    }
+    else {
+        draw_bresenham(pixel, dy, dx, step_y, step_x, color, dotted);
+    }
+}
+
+void skeleton_raster_disc(const struct RasterImage *image, int x, int y, int radius, uint16_t color)
+{
+    // Out from the centre the rows narrow, each reaching the pixels whose centres
+    // are within about half a pixel past the radius
+    int half_width = radius;
+    for (int row = 0; row <= radius; row++) {
+        while (half_width * half_width + row * row > radius * radius + radius) {
+            half_width--;
+        }
+        fill_span(image, y - row, x - half_width, x + half_width, color);
+        if (row != 0) {
+            fill_span(image, y + row, x - half_width, x + half_width, color);
+        }
+    }
+}
+
+// Function to step a line of whole pixels, from its start to its end
+static void draw_bresenham(uint16_t *pixel, int major, int minor, ptrdiff_t major_step,
+                           ptrdiff_t minor_step, uint16_t color, bool dotted)
+{
+    int error = 2 * minor - major;
+    for (int i = 0;; i++) {
+        if (!dotted || i % 3 != 2) {
+            *pixel = color;
+        }
+        if (i == major) {
+            break;
+        }
+        if (error > 0) {
+            pixel += minor_step;
+            error -= 2 * major;
+        }
+        error += 2 * minor;
+        pixel += major_step;
+    }
+}
+
+// Function to step a line shared between the two pixels across it at each step.
+// The fraction is truncated, so it never passes the end and the second pixel
+// stays within the line.
+static void draw_wu(uint16_t *pixel, int major, int minor, ptrdiff_t major_step,
+                    ptrdiff_t minor_step, uint16_t color, bool dotted)
+{
+    uint16_t native_color = PAINT_COLOR(color);
+    uint16_t fraction = 0;
+    uint16_t fraction_step = (uint16_t)(((uint32_t)minor << 16) / major);
+    for (int i = 0;; i++) {
+        if (!dotted || i % 3 != 2) {
+            int coverage = fraction >> (16 - COVERAGE_BITS);
+            blend_pixel(pixel, native_color, coverage_weights[(1 << COVERAGE_BITS) - 1 - coverage]);
+            if (coverage != 0) {
+                blend_pixel(pixel + minor_step, native_color, coverage_weights[coverage]);
+            }
+        }
+        if (i == major) {
+            break;
+        }
+        uint16_t last_fraction = fraction;
+        fraction += fraction_step;
+        if (fraction < last_fraction) {
+            pixel += minor_step;
+        }
+        pixel += major_step;
+    }
+}
+
+// Function to mix a colour into a pixel. Spreading the RGB565 fields over 32 bits,
+// green in the top half, leaves room between them for the weighted difference.
+static void blend_pixel(uint16_t *pixel, uint16_t color, int weight)
+{
+    if (weight == 0) {
+        return;
+    }
+    uint32_t background = PAINT_COLOR(*pixel);
+    background = (background | background << 16) & 0x07E0F81F;
+    uint32_t foreground = (color | (uint32_t)color << 16) & 0x07E0F81F;
+    uint32_t result = (background + (((foreground - background) * weight) >> BLEND_BITS)) & 0x07E0F81F;
+    *pixel = PAINT_COLOR((uint16_t)(result | result >> 16));
+}
+
+// Function to fill part of a row, clipped to the image
+static void fill_span(const struct RasterImage *image, int y, int left, int right, uint16_t color)
+{
+    if (y < 0 || y >= image->height) {
+        return;
+    }
+    if (left < 0) {
+        left = 0;
+    }
+    if (right >= image->width) {
+        right = image->width - 1;
+    }
+    uint16_t *row = image->pixels + (ptrdiff_t)y * image->width;
+    for (int x = left; x <= right; x++) {
+        row[x] = color;
+    }
+}
+
+// Function to check a point is within the image
+static bool is_inside(const struct RasterImage *image, int x, int y)
+{
+    return x >= 0 && x < image->width && y >= 0 && y < image->height;
+}
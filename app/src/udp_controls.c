@@ -5,8 +5,10 @@
  * target-to-target and target-to-host communication.
  */
 
+#include "gesture_classifier.h"
+#include "landmark_ring.h"
 #include "hand_commands.h"
-#include "lcd_menus.h"
+#include "event_loop.h"
 #include "utils.h"
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -20,55 +22,40 @@
 
 #define UDP_PORT 12345          // The port used for UDP communication
 #define MAX_BUFFER_SIZE 1600    // Maximum size of the UDP buffer
+#define HAND_VALUES (1 + LANDMARK_RING_NUM_VALUES) // Hand ID and landmarks of each hand in a packet
 
-#define NUM_HANDLERS 6          // Number of handlers for different commands
-#define CMD_SIZE 128            // Size of the command strings
+// Gesture of each hand's previous frame, to only pass on changes
+static int prev_gesture[LANDMARK_MAX_HANDS];
 
-// Track the previous command to avoid reprocessing
-char prev_cmd[CMD_SIZE] = "";
+// Packet processing statistics
+static long long packets_received = 0;
+static long long hands_received = 0;
+static long long packet_total_ns = 0;
 
 // UDP socket descriptor and address structures
 static int socket_descriptor;
 static struct sockaddr_in client_addr;
 static socklen_t addr_len = sizeof(client_addr);
 
-// Thread control variables
-static pthread_t udp_thread;
-static volatile bool running = true;
-
 // Helper function prototypes
-static void *udp_listener(void *arg);
+static void udp_listener(void *arg);
 static void process_string(const char *cmd);
-static int binary_string_to_integer(const char* str);
+static void process_hand(int hand, const int landmarks[]);
 
 void udp_init(void) 
 {
-    if (pthread_create(&udp_thread, NULL, udp_listener, NULL) != 0) {
-        perror("Failed to create UDP listener thread");
-        close(socket_descriptor);
-        exit(EXIT_FAILURE);
+    for (int i = 0; i < LANDMARK_MAX_HANDS; i++) {
+        prev_gesture[i] = -1;
     }
-}
-
-void udp_cleanup(void) 
-{
-    running = false;
-    shutdown(socket_descriptor, SHUT_RDWR);
-    pthread_join(udp_thread, NULL);
-    close(socket_descriptor);
-}
 
-// Thread function that listens for incoming UDP packets
-static void *udp_listener(void *arg) 
-{
-    (void)arg;
     struct sockaddr_in sin;
     memset(&sin, 0, sizeof(sin));
     sin.sin_family = AF_INET;
     sin.sin_addr.s_addr = htonl(INADDR_ANY);
     sin.sin_port = htons(UDP_PORT);
 
-    socket_descriptor = socket(PF_INET, SOCK_DGRAM, 0);
+    // Non-blocking, so the event loop can drain every queued packet
+    socket_descriptor = socket(PF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
     if (socket_descriptor < 0) {
         perror("Failed to create UDP socket");
         exit(EXIT_FAILURE);
@@ -79,66 +66,94 @@ static void *udp_listener(void *arg)
         close(socket_descriptor);
         exit(EXIT_FAILURE);
     }
+    event_loop_add_fd(socket_descriptor, udp_listener, NULL);
+}
+
+void udp_cleanup(void) 
+{
+    event_loop_remove_fd(socket_descriptor);
+    close(socket_descriptor);
+
+    if (packets_received > 0){
+        printf("\nUDP: %lld packets with %lld hands, avg %lld ns per packet (%lld ns per hand)\n",
+               packets_received, hands_received, packet_total_ns / packets_received,
+               hands_received > 0 ? packet_total_ns / hands_received : 0);
+    }
+    gesture_classifier_print_stats();
+}
+
+// Event loop handler that reads the incoming UDP packets
+static void udp_listener(void *arg) 
+{
+    (void)arg;
     char buffer[MAX_BUFFER_SIZE]; 
 
-    while (running) {
+    while (true) {
         ssize_t n = recvfrom(socket_descriptor, buffer, MAX_BUFFER_SIZE - 1, 0,
                              (struct sockaddr *)&client_addr, &addr_len);
+        if (n < 0) {
+            break;
+        }
         if (n > 0) {
             buffer[n] = '\0';
             trim_newline(buffer);
             process_string(buffer);
         }
     }
-    return NULL;
 }
 
-// Function to process the received command string and extract the keypoints
+// Function to parse the landmarks of each hand in a packet and classify the gesture they show
 static void process_string(const char *cmd) 
 {
-    //copy the command, safer for strtok
-    char cmd_copy[strlen(cmd) + 1];
-    strcpy(cmd_copy, cmd);
-
-    //extract first token
-    int num_tokens = 43; 
-    int token_index = 0;  
-    char *tokens[num_tokens];
-    tokens[token_index] = strtok(cmd_copy, " ");
-
-    //extract the rest of tokens and copy to integer buffer
-    int data_points[num_tokens - 1];
-    while(tokens[token_index] != NULL && token_index < num_tokens){
-      token_index++;
-      tokens[token_index] = strtok(NULL, " ");
+    long long start_ns = get_monotonic_time_in_ns();
+
+    // Each hand is its ID followed by the x, y pairs of its 21 landmarks, separated by spaces.
+    // One extra value is read so packets with too many hands are noticed.
+    int data_points[LANDMARK_MAX_HANDS * HAND_VALUES + 1];
+    int num_points = 0;
+    const char *next = cmd;
+
+    while (num_points < LANDMARK_MAX_HANDS * HAND_VALUES + 1) {
+        char *end;
+        long value = strtol(next, &end, 10);
+        if (end == next) {
+            break;
+        }
+        data_points[num_points++] = (int)value;
+        next = end;
     }
 
-    for(int i = 1; i < num_tokens; i++){
-      data_points[i - 1] = atoi(tokens[i]);
+    // A single hand may also be sent without its ID
+    if (num_points == LANDMARK_RING_NUM_VALUES) {
+        process_hand(0, data_points);
+        hands_received++;
     }
-    set_keypoint_buff(data_points, num_tokens - 1);
-
-    //if its a new command, we parse
-    if (strcasecmp(tokens[0], prev_cmd) != 0) {
-      strncpy(prev_cmd, tokens[0], CMD_SIZE - 1);
-      prev_cmd[CMD_SIZE - 1] = '\0';
-
-      //char *endptr;
-      // previously, was just taking the raw 1100 and converting into int
-      // meaning 1100 meant 1100 and not 14
-      int value = binary_string_to_integer(tokens[0]); //strtol(cmd, &endptr, 2);
-      command_handler_update_current_command(value);
+    // Drop packets that were cut short or are not landmarks
+    else if (num_points == 0 || num_points % HAND_VALUES != 0
+             || num_points > LANDMARK_MAX_HANDS * HAND_VALUES) {
+        return;
     }
+    else {
+        for (int i = 0; i < num_points; i += HAND_VALUES) {
+            int hand = data_points[i];
+            if (hand >= 0 && hand < LANDMARK_MAX_HANDS) {
+                process_hand(hand, &data_points[i + 1]);
+                hands_received++;
+            }
+        }
+    }
+    packets_received++;
+    packet_total_ns += get_monotonic_time_in_ns() - start_ns;
 }
 
-// Function to convert a binary string to an integer
-static int binary_string_to_integer(const char* str) 
+// Function to share a hand's landmarks and pass on its gesture when it changes
+static void process_hand(int hand, const int landmarks[])
 {
-    int out = 0;
-    int len = 3;
-    
-    for(int i = 0; str[i] != '\0'; i++) {
-        out = out | ((str[i] - '0') << (len - i));
+    landmark_ring_publish(hand, landmarks, LANDMARK_RING_NUM_VALUES);
+
+    int gesture = gesture_classifier_update(hand, landmarks, LANDMARK_RING_NUM_VALUES);
+    if (gesture != -1 && gesture != prev_gesture[hand]) {
+        prev_gesture[hand] = gesture;
+        command_handler_update_current_command(hand, gesture);
     }
-    return atoi(str);
 }
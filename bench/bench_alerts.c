@@ -0,0 +1,125 @@
+/*
+ * This file benchmarks how the lgpio alert thread puts a pass of alerts in
+ * time order. Each active line contributes a run of alerts already in order,
+ * as the kernel reports them, with their timestamps interleaved between
+ * lines. The runs are put in order by the k-way merge the alert thread uses,
+ * and by qsort() as it used to, for 1 to 64 active lines, and the results
+ * are checked against each other.
+ */
+
+#include "lgpio.h"
+#include "utils.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_ALERTS 2000          // Alerts the alert thread handles in one pass, LG_MAX_ALERTS
+#define MAX_ALERTS_PER_LINE 128  // Alerts a line reports in one read
+#define NUM_REPEATS 2000         // Passes timed for each line count
+
+// Alert buffer and functions of the alert thread in lgPthAlerts.c
+extern lgGpioAlert_t aBuf[];
+void xMergeRuns(int count);
+int tscomp(const void *p1, const void *p2);
+
+static lgGpioAlert_t pass[MAX_ALERTS];
+static lgGpioAlert_t sorted[MAX_ALERTS];
+
+// Helper function prototypes
+static int fill_pass(int num_lines);
+static bool is_same_order(int count);
+static void run(int num_lines);
+static int truncating_compare(const void *p1, const void *p2);
+
+int main(void)
+{
+    printf("%d passes per line count\n", NUM_REPEATS);
+    printf("%5s %7s %12s %12s %14s %14s %6s\n", "lines", "alerts", "qsort us", "merge us",
+           "qsort ns/alert", "merge ns/alert", "order");
+    for (int num_lines = 1; num_lines <= 64; num_lines *= 2) {
+        run(num_lines);
+    }
+
+    // A difference of 2^32 ns, about 4.3 s, truncates to 0 in an int
+    lgGpioAlert_t later = {.report = {.timestamp = (1ULL << 32) + 1}};
+    lgGpioAlert_t earlier = {.report = {.timestamp = 1}};
+    printf("Alerts 2^32 ns apart compare as %d with an int difference, %d with tscomp()\n",
+           truncating_compare(&later, &earlier), tscomp(&later, &earlier));
+    return EXIT_SUCCESS;
+}
+
+// Function to fill a pass with a run of edges from each line, returning the alert count
+static int fill_pass(int num_lines)
+{
+    int per_line = MAX_ALERTS / num_lines;
+    if (per_line > MAX_ALERTS_PER_LINE) {
+        per_line = MAX_ALERTS_PER_LINE;
+    }
+
+    int count = 0;
+    for (int line = 0; line < num_lines; line++) {
+        // Edges 0.5 to 20 us apart, like the encoder and echo pins at speed
+        uint64_t timestamp = 1000000000ULL + rand() % 1000;
+        for (int i = 0; i < per_line; i++) {
+            timestamp += 500 + rand() % 20000;
+            memset(&pass[count], 0, sizeof(pass[count]));
+            pass[count].report.timestamp = timestamp;
+            pass[count].report.gpio = line;
+            pass[count].report.level = i & 1;
+            count++;
+        }
+    }
+    return count;
+}
+
+// Function to check the merged alerts are in the order qsort() put them in
+static bool is_same_order(int count)
+{
+    for (int i = 0; i < count; i++) {
+        if (aBuf[i].report.timestamp != sorted[i].report.timestamp) {
+            return false;
+        }
+        if (i > 0 && aBuf[i].report.timestamp < aBuf[i - 1].report.timestamp) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Function to time both ways of ordering a pass from a number of lines
+static void run(int num_lines)
+{
+    int count = fill_pass(num_lines);
+
+    long long qsort_ns = 0;
+    for (int i = 0; i < NUM_REPEATS; i++) {
+        memcpy(aBuf, pass, sizeof(pass[0]) * count);
+        long long start_ns = get_monotonic_time_in_ns();
+        qsort(aBuf, count, sizeof(aBuf[0]), tscomp);
+        qsort_ns += get_monotonic_time_in_ns() - start_ns;
+    }
+    memcpy(sorted, aBuf, sizeof(sorted[0]) * count);
+
+    long long merge_ns = 0;
+    for (int i = 0; i < NUM_REPEATS; i++) {
+        memcpy(aBuf, pass, sizeof(pass[0]) * count);
+        long long start_ns = get_monotonic_time_in_ns();
+        xMergeRuns(count);
+        merge_ns += get_monotonic_time_in_ns() - start_ns;
+    }
+
+    printf("%5d %7d %12.1f %12.1f %14.1f %14.1f %6s\n", num_lines, count,
+           qsort_ns / 1e3 / NUM_REPEATS, merge_ns / 1e3 / NUM_REPEATS,
+           (double)qsort_ns / NUM_REPEATS / count, (double)merge_ns / NUM_REPEATS / count,
+           is_same_order(count) ? "same" : "WRONG");
+}
+
+// Function to compare alerts the way tscomp() used to, truncating the difference to an int
+static int truncating_compare(const void *p1, const void *p2)
+{
+    const lgGpioAlert_t *a1 = p1;
+    const lgGpioAlert_t *a2 = p2;
+    return a1->report.timestamp - a2->report.timestamp;
+}
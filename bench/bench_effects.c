@@ -0,0 +1,87 @@
+/*
+ * This file benchmarks the effects chain of the Sine Mixer. Fixed blocks of
+ * a sine are run through audio_effects_process() as the playback thread
+ * would, with every effect off and with every effect turned up, and the
+ * module prints the average and longest time each stage took per block. The
+ * time of a whole block is also reported against the time it plays for.
+ */
+
+#include "audio_effects.h"
+#include "utils.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SAMPLE_RATE 44100  // As played by the Sine Mixer
+#define BLOCK_SIZE 512     // Samples per block, about one playback period
+#define NUM_BLOCKS 20000   // Blocks processed in each run
+#define TONE_HZ 440.0
+#define PI 3.1415926535897932
+
+// Struct of the settings of a run
+struct Settings {
+    const char *name;
+    int values[AUDIO_EFFECT_PARAM_COUNT];
+};
+
+static const struct Settings runs[] = {
+    {"every effect off", {0, 100, 0, 0, 0, 30, 0}},
+    {"every effect on", {60, 40, 70, 100, 60, 50, 80}},
+};
+
+static double samples[BLOCK_SIZE];
+static double cutoff_ratios[BLOCK_SIZE];
+
+// Helper function prototypes
+static void fill_tone(double *block, int size, long long first_sample);
+static void run(const struct Settings *settings);
+
+int main(void)
+{
+    for (int i = 0; i < BLOCK_SIZE; i++) {
+        cutoff_ratios[i] = 1.0;
+    }
+
+    printf("%d blocks of %d samples per run, a block plays for %.0f us\n", NUM_BLOCKS, BLOCK_SIZE,
+           BLOCK_SIZE * 1e6 / SAMPLE_RATE);
+    for (int i = 0; i < (int)(sizeof(runs) / sizeof(runs[0])); i++) {
+        run(&runs[i]);
+    }
+    return EXIT_SUCCESS;
+}
+
+// Function to fill a block with the next samples of a sine at half scale
+static void fill_tone(double *block, int size, long long first_sample)
+{
+    for (int i = 0; i < size; i++) {
+        block[i] = 0.5 * sin(2.0 * PI * TONE_HZ * (first_sample + i) / SAMPLE_RATE);
+    }
+}
+
+// Function to time the chain over a run of blocks with one set of settings
+static void run(const struct Settings *settings)
+{
+    audio_effects_init(SAMPLE_RATE);
+    for (int i = 0; i < AUDIO_EFFECT_PARAM_COUNT; i++) {
+        audio_effects_set_param(i, settings->values[i]);
+    }
+
+    long long total_ns = 0;
+    long long max_ns = 0;
+    for (int block = 0; block < NUM_BLOCKS; block++) {
+        fill_tone(samples, BLOCK_SIZE, (long long)block * BLOCK_SIZE);
+        long long start_ns = get_monotonic_time_in_ns();
+        audio_effects_process(samples, cutoff_ratios, BLOCK_SIZE);
+        long long elapsed_ns = get_monotonic_time_in_ns() - start_ns;
+        total_ns += elapsed_ns;
+        if (elapsed_ns > max_ns) {
+            max_ns = elapsed_ns;
+        }
+    }
+
+    double average_us = (double)total_ns / NUM_BLOCKS / 1000;
+    printf("\n%s: block avg %.1f us (max %.1f us), %.2f%% of its playing time",
+           settings->name, average_us, max_ns / 1000.0, average_us * SAMPLE_RATE / BLOCK_SIZE / 1e4);
+    audio_effects_print_stats();
+    audio_effects_cleanup();
+}
@@ -0,0 +1,135 @@
+/*
+ * This file benchmarks the handling of hand tracking packets. It runs the
+ * UDP controls module with the event loop and command handler stood in for,
+ * sends it synthetic 1, 2 and 4 hand streams over loopback, and times the
+ * listener reading, parsing, publishing and classifying each packet. The
+ * cost per hand should stay flat as hands are added.
+ */
+
+#include "udp_controls.h"
+#include "hand_commands.h"
+#include "event_loop.h"
+#include "landmark_ring.h"
+#include "utils.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UDP_PORT 12345        // Port the UDP controls module listens on
+#define NUM_PACKETS 20000     // Packets sent for each hand count
+#define MAX_PACKET_SIZE 1600
+#define THUMB_TIP 4           // Landmarks moved to change the gesture
+#define INDEX_TIP 8
+
+// Landmarks of an open hand, as x, y pairs in the 240x240 frame
+static const int open_hand[LANDMARK_RING_NUM_VALUES] = {
+    120, 200, 95, 185, 80, 165, 70, 145, 60, 130, 100, 130, 95, 100, 92, 80, 90, 62,
+    120, 125, 120, 92, 120, 70, 120, 50, 138, 130, 142, 100, 145, 80, 147, 62,
+    155, 140, 162, 115, 166, 98, 170, 82,
+};
+
+// Listener the UDP controls module registered with the event loop
+static EventHandler listener;
+static void *listener_context;
+
+// Gesture changes passed on to the command handler
+static long long gesture_changes = 0;
+
+// Helper function prototypes
+static int format_packet(char *packet, int num_hands, int frame);
+static void run(int sender, int num_hands);
+
+int main(void)
+{
+    udp_init();
+
+    int sender = socket(PF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(UDP_PORT);
+    if (sender < 0 || connect(sender, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("Failed to connect to the UDP controls socket");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("%d packets per hand count\n", NUM_PACKETS);
+    printf("%5s %10s %14s %12s\n", "hands", "bytes", "ns/packet", "ns/hand");
+    run(sender, 1);
+    run(sender, 2);
+    run(sender, 4);
+    printf("%lld gesture changes passed on\n", gesture_changes);
+
+    close(sender);
+    udp_cleanup();
+    return EXIT_SUCCESS;
+}
+
+void event_loop_add_fd(int fd, EventHandler handler, void *context)
+{
+    (void)fd;
+    listener = handler;
+    listener_context = context;
+}
+
+void event_loop_remove_fd(int fd)
+{
+    (void)fd;
+    listener = NULL;
+}
+
+void command_handler_update_current_command(int hand, int cmd)
+{
+    (void)hand;
+    (void)cmd;
+    gesture_changes++;
+}
+
+// Function to write a packet of hands drifting across the frame, returning its length
+static int format_packet(char *packet, int num_hands, int frame)
+{
+    int length = 0;
+    for (int hand = 0; hand < num_hands; hand++) {
+        length += sprintf(packet + length, hand == 0 ? "%d" : " %d", hand);
+
+        // Every 25 frames a hand touches its index tip to its thumb tip or lets go,
+        // changing its gesture
+        int shift = (frame + hand * 7) % 40 - 20;
+        bool is_touching = (frame / 25 + hand) % 2 == 0;
+        for (int i = 0; i < LANDMARK_RING_NUM_VALUES; i += 2) {
+            int landmark = is_touching && i == 2 * INDEX_TIP ? THUMB_TIP : i / 2;
+            length += sprintf(packet + length, " %d %d", open_hand[2 * landmark] + shift,
+                              open_hand[2 * landmark + 1]);
+        }
+    }
+    return length;
+}
+
+// Function to time the listener over a stream of packets with a number of hands
+static void run(int sender, int num_hands)
+{
+    char packet[MAX_PACKET_SIZE];
+    long long total_ns = 0;
+    long long total_bytes = 0;
+
+    for (int frame = 0; frame < NUM_PACKETS; frame++) {
+        int length = format_packet(packet, num_hands, frame);
+        if (send(sender, packet, length, 0) != length) {
+            perror("Failed to send packet");
+            exit(EXIT_FAILURE);
+        }
+        total_bytes += length;
+
+        long long start_ns = get_monotonic_time_in_ns();
+        listener(listener_context);
+        total_ns += get_monotonic_time_in_ns() - start_ns;
+    }
+    printf("%5d %10lld %14lld %12lld\n", num_hands, total_bytes / NUM_PACKETS,
+           total_ns / NUM_PACKETS, total_ns / NUM_PACKETS / num_hands);
+}
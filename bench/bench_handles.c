@@ -0,0 +1,190 @@
+/*
+ * This file benchmarks lgpio handle lookups, the lgHdlGetLockedObj() and
+ * lgHdlUnlock() pair every lgpio call goes through. One to four threads look
+ * up handles in a loop, each with its own handle or all sharing one, and the
+ * lookups per second are reported. A churn run then frees and reallocates
+ * handles while other threads look them up, checking each object is only
+ * destroyed once and never used after it is.
+ */
+
+#include "lgpio.h"
+#include "lgHdl.h"
+#include "utils.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_LOOKUPS 10000000  // Lookups made by each thread
+#define MAX_THREADS 4
+#define CHURN_HANDLES 16      // Handles the churn run cycles through
+#define CHURN_ALLOCATIONS 200000
+#define DESTROYED_MAGIC -1
+
+// Struct of the object behind each handle of the churn run
+struct ChurnObject {
+    int magic;
+    int uses;
+};
+
+static int handles[MAX_THREADS];
+static bool is_shared_run;
+
+// Churn run state
+static atomic_bool is_churning;
+static atomic_llong objects_created;
+static atomic_llong objects_destroyed;
+static atomic_llong bad_uses;
+
+// Helper function prototypes
+static void *lookup_thread(void *arg);
+static void time_lookups(int num_threads, bool is_shared);
+static void destroy_object(void *obj);
+static void *churn_lookup_thread(void *arg);
+static void *churn_alloc_thread(void *arg);
+static void run_churn(void);
+
+int main(void)
+{
+    void *obj;
+    for (int i = 0; i < MAX_THREADS; i++) {
+        handles[i] = lgHdlAlloc(LG_HDL_TYPE_SPI, sizeof(int), &obj, NULL);
+    }
+
+    printf("%d lookups per thread\n", NUM_LOOKUPS);
+    printf("%7s %-8s %12s %12s\n", "threads", "handle", "M lookups/s", "ns/lookup");
+    for (int num_threads = 1; num_threads <= MAX_THREADS; num_threads *= 2) {
+        time_lookups(num_threads, false);
+        time_lookups(num_threads, true);
+    }
+
+    for (int i = 0; i < MAX_THREADS; i++) {
+        lgHdlFree(handles[i], LG_HDL_TYPE_SPI);
+    }
+    run_churn();
+    return EXIT_SUCCESS;
+}
+
+// Function to look up and unlock a handle in a loop
+static void *lookup_thread(void *arg)
+{
+    int handle = handles[is_shared_run ? 0 : (int)(long)arg];
+    void *obj;
+    for (int i = 0; i < NUM_LOOKUPS; i++) {
+        if (lgHdlGetLockedObj(handle, LG_HDL_TYPE_SPI, &obj) == LG_OKAY) {
+            lgHdlUnlock(handle);
+        }
+    }
+    return NULL;
+}
+
+// Function to time a number of threads looking up their own handles or a shared one
+static void time_lookups(int num_threads, bool is_shared)
+{
+    pthread_t threads[MAX_THREADS];
+    is_shared_run = is_shared;
+
+    long long start_ns = get_monotonic_time_in_ns();
+    for (long i = 0; i < num_threads; i++) {
+        pthread_create(&threads[i], NULL, lookup_thread, (void *)i);
+    }
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed_ns = get_monotonic_time_in_ns() - start_ns;
+
+    double lookups = (double)num_threads * NUM_LOOKUPS;
+    printf("%7d %-8s %12.1f %12.1f\n", num_threads, is_shared ? "shared" : "own",
+           lookups / elapsed_ns * 1e3, elapsed_ns / lookups);
+}
+
+// Function called by lgpio to release a churn object, which must only happen once
+static void destroy_object(void *obj)
+{
+    struct ChurnObject *object = obj;
+    if (object->magic == DESTROYED_MAGIC) {
+        atomic_fetch_add(&bad_uses, 1);
+    }
+    object->magic = DESTROYED_MAGIC;
+    atomic_fetch_add(&objects_destroyed, 1);
+}
+
+// Function to look up random churn handles, using each object found
+static void *churn_lookup_thread(void *arg)
+{
+    unsigned int seed = (unsigned int)(long)arg;
+    while (atomic_load_explicit(&is_churning, memory_order_relaxed)) {
+        int handle = rand_r(&seed) % CHURN_HANDLES;
+        struct ChurnObject *object;
+        if (lgHdlGetLockedObj(handle, LG_HDL_TYPE_SPI, (void **)&object) == LG_OKAY) {
+            if (object->magic == DESTROYED_MAGIC) {
+                atomic_fetch_add(&bad_uses, 1);
+            }
+            object->uses++;
+            lgHdlUnlock(handle);
+        }
+    }
+    return NULL;
+}
+
+// Function to allocate handles and free random ones, some while holding them locked
+static void *churn_alloc_thread(void *arg)
+{
+    unsigned int seed = (unsigned int)(long)arg;
+    for (int i = 0; i < CHURN_ALLOCATIONS; i++) {
+        struct ChurnObject *object;
+        int handle = lgHdlAlloc(LG_HDL_TYPE_SPI, sizeof(*object), (void **)&object, destroy_object);
+        if (handle < 0) {
+            continue;
+        }
+        atomic_fetch_add(&objects_created, 1);
+
+        int victim = rand_r(&seed) % CHURN_HANDLES;
+        if (rand_r(&seed) & 1) {
+            // The pattern lgpio close calls use
+            struct ChurnObject *locked;
+            if (lgHdlGetLockedObj(victim, LG_HDL_TYPE_SPI, (void **)&locked) == LG_OKAY) {
+                lgHdlFree(victim, LG_HDL_TYPE_SPI);
+                lgHdlUnlock(victim);
+            }
+        }
+        else {
+            lgHdlFree(victim, LG_HDL_TYPE_SPI);
+        }
+
+        // Keep the handles in use within the range the lookups cover
+        if (handle >= CHURN_HANDLES) {
+            lgHdlFree(handle, LG_HDL_TYPE_SPI);
+        }
+    }
+    return NULL;
+}
+
+// Function to free and reallocate handles while four threads look them up
+static void run_churn(void)
+{
+    pthread_t lookups[MAX_THREADS];
+    pthread_t allocators[2];
+
+    atomic_store(&is_churning, true);
+    for (long i = 0; i < MAX_THREADS; i++) {
+        pthread_create(&lookups[i], NULL, churn_lookup_thread, (void *)(i + 1));
+    }
+    for (long i = 0; i < 2; i++) {
+        pthread_create(&allocators[i], NULL, churn_alloc_thread, (void *)(i + 100));
+    }
+    for (int i = 0; i < 2; i++) {
+        pthread_join(allocators[i], NULL);
+    }
+    atomic_store(&is_churning, false);
+    for (int i = 0; i < MAX_THREADS; i++) {
+        pthread_join(lookups[i], NULL);
+    }
+    for (int handle = 0; handle < CHURN_HANDLES; handle++) {
+        lgHdlFree(handle, LG_HDL_TYPE_SPI);
+    }
+
+    printf("Churn: %lld objects created, %lld destroyed, %lld used after being destroyed\n",
+           atomic_load(&objects_created), atomic_load(&objects_destroyed), atomic_load(&bad_uses));
+}
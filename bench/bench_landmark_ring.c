@@ -0,0 +1,155 @@
+/*
+ * This file benchmarks the landmark ring under contention. One thread
+ * publishes frames as fast as it can while reader threads copy the latest
+ * frame in a loop, and the same is run with the frame copied under a mutex,
+ * the way the LCD used to take it. It reports the average and worst cost of
+ * a publish, how many frames each reader copied, and checks no reader ever
+ * saw a torn frame.
+ */
+
+#include "landmark_ring.h"
+#include "utils.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_FRAMES 2000000 // Frames published in each run
+#define MAX_READERS 4
+
+// Struct of what one reader thread counted
+struct ReaderResult {
+    long long reads;
+    long long torn_reads;
+};
+
+// Frame and lock of the mutex run, shared like the old LCD keypoint buffer
+static pthread_mutex_t frame_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct LandmarkFrame locked_frame;
+
+static atomic_bool is_running;
+static bool is_locked_run;
+
+// Helper function prototypes
+static void *reader_thread(void *arg);
+static bool is_torn(const struct LandmarkFrame *frame);
+static void publish_locked(const int values[], unsigned long long sequence);
+static void run(int num_readers, bool is_locked);
+
+int main(void)
+{
+    printf("%d frames per run, one writer\n", NUM_FRAMES);
+    printf("%-6s %7s %12s %14s %16s %11s\n", "copy", "readers", "ns/publish", "worst ns", "reads/reader/s",
+           "torn reads");
+    for (int num_readers = 0; num_readers <= MAX_READERS; num_readers = num_readers == 0 ? 1 : num_readers * 2) {
+        run(num_readers, false);
+        run(num_readers, true);
+    }
+    return EXIT_SUCCESS;
+}
+
+// Function to copy the latest frame until the writer is done, checking each copy
+static void *reader_thread(void *arg)
+{
+    struct ReaderResult *result = arg;
+    struct LandmarkFrame frame;
+
+    while (atomic_load_explicit(&is_running, memory_order_relaxed)) {
+        bool is_copied;
+        if (is_locked_run) {
+            pthread_mutex_lock(&frame_mutex);
+            frame = locked_frame;
+            pthread_mutex_unlock(&frame_mutex);
+            is_copied = frame.sequence != 0;
+        }
+        else {
+            is_copied = landmark_ring_read_latest(0, &frame);
+        }
+        if (is_copied) {
+            result->reads++;
+            if (is_torn(&frame)) {
+                result->torn_reads++;
+            }
+        }
+    }
+    return NULL;
+}
+
+// Function to check every value of a frame came from the same publish
+static bool is_torn(const struct LandmarkFrame *frame)
+{
+    for (int i = 0; i < LANDMARK_RING_NUM_VALUES; i++) {
+        if (frame->values[i] != (int)frame->sequence) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Function to publish a frame by copying it under the mutex
+static void publish_locked(const int values[], unsigned long long sequence)
+{
+    pthread_mutex_lock(&frame_mutex);
+    locked_frame.hand = 0;
+    locked_frame.sequence = sequence;
+    locked_frame.timestamp_us = get_time_in_us();
+    memcpy(locked_frame.values, values, sizeof(locked_frame.values));
+    pthread_mutex_unlock(&frame_mutex);
+}
+
+// Function to time one writer against a number of readers
+static void run(int num_readers, bool is_locked)
+{
+    pthread_t readers[MAX_READERS];
+    struct ReaderResult results[MAX_READERS];
+    int values[LANDMARK_RING_NUM_VALUES];
+
+    // The ring keeps counting frames from the last run, so values follow its sequence
+    static unsigned long long ring_sequence = 0;
+
+    is_locked_run = is_locked;
+    atomic_store(&is_running, true);
+    memset(results, 0, sizeof(results));
+    for (int i = 0; i < num_readers; i++) {
+        pthread_create(&readers[i], NULL, reader_thread, &results[i]);
+    }
+
+    long long start_ns = get_monotonic_time_in_ns();
+    long long worst_ns = 0;
+    for (int frame = 1; frame <= NUM_FRAMES; frame++) {
+        long long publish_start_ns = get_monotonic_time_in_ns();
+        if (is_locked) {
+            for (int i = 0; i < LANDMARK_RING_NUM_VALUES; i++) {
+                values[i] = frame;
+            }
+            publish_locked(values, frame);
+        }
+        else {
+            ring_sequence++;
+            for (int i = 0; i < LANDMARK_RING_NUM_VALUES; i++) {
+                values[i] = (int)ring_sequence;
+            }
+            landmark_ring_publish(0, values, LANDMARK_RING_NUM_VALUES);
+        }
+        long long publish_ns = get_monotonic_time_in_ns() - publish_start_ns;
+        if (publish_ns > worst_ns) {
+            worst_ns = publish_ns;
+        }
+    }
+    long long elapsed_ns = get_monotonic_time_in_ns() - start_ns;
+
+    atomic_store(&is_running, false);
+    long long reads = 0;
+    long long torn_reads = 0;
+    for (int i = 0; i < num_readers; i++) {
+        pthread_join(readers[i], NULL);
+        reads += results[i].reads;
+        torn_reads += results[i].torn_reads;
+    }
+
+    double reads_per_reader = num_readers == 0 ? 0 : (double)reads / num_readers / (elapsed_ns / 1e9);
+    printf("%-6s %7d %12.1f %14lld %16.0f %11lld\n", is_locked ? "mutex" : "ring", num_readers,
+           (double)elapsed_ns / NUM_FRAMES, worst_ns, reads_per_reader, torn_reads);
+}
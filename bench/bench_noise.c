@@ -0,0 +1,102 @@
+/*
+ * This file benchmarks the noise module against rand(). Blocks the size of
+ * an audio period are filled with bipolar noise, first with rand() as the
+ * audio thread used to, then with the thread's xorshift generator, alone and
+ * while another thread also calls rand() and contends for its lock. The
+ * mean and variance of the noise are printed as a sanity check.
+ */
+
+#include "noise.h"
+#include "utils.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BLOCK_SIZE 512     // Samples per block, about one playback period
+#define NUM_BLOCKS 20000   // Blocks filled in each run
+
+static double samples[BLOCK_SIZE];
+static atomic_bool is_contending;
+
+// Helper function prototypes
+static void *rand_thread(void *arg);
+static void fill_with_rand(double *block, int size);
+static void run(const char *label);
+static void print_distribution(void);
+
+int main(void)
+{
+    printf("%d blocks of %d samples per run\n", NUM_BLOCKS, BLOCK_SIZE);
+    printf("%-20s %16s %16s\n", "", "rand() ns/sample", "noise ns/sample");
+    run("alone");
+
+    pthread_t thread;
+    atomic_store(&is_contending, true);
+    pthread_create(&thread, NULL, rand_thread, NULL);
+    run("rand() contended");
+    atomic_store(&is_contending, false);
+    pthread_join(thread, NULL);
+
+    print_distribution();
+    return EXIT_SUCCESS;
+}
+
+// Function to keep calling rand() from another thread, like a second user of libc
+static void *rand_thread(void *arg)
+{
+    (void)arg;
+    volatile int sink = 0;
+    while (atomic_load_explicit(&is_contending, memory_order_relaxed)) {
+        sink += rand();
+    }
+    return NULL;
+}
+
+// Function to fill a block the way the audio thread used to, one rand() per sample
+static void fill_with_rand(double *block, int size)
+{
+    for (int i = 0; i < size; i++) {
+        block[i] = rand() / (double)RAND_MAX * 2.0 - 1.0;
+    }
+}
+
+// Function to time both sources filling the same blocks
+static void run(const char *label)
+{
+    long long start_ns = get_monotonic_time_in_ns();
+    for (int block = 0; block < NUM_BLOCKS; block++) {
+        fill_with_rand(samples, BLOCK_SIZE);
+    }
+    long long rand_ns = get_monotonic_time_in_ns() - start_ns;
+
+    struct NoiseGenerator *generator = noise_thread_generator();
+    start_ns = get_monotonic_time_in_ns();
+    for (int block = 0; block < NUM_BLOCKS; block++) {
+        noise_fill(generator, samples, BLOCK_SIZE);
+    }
+    long long noise_ns = get_monotonic_time_in_ns() - start_ns;
+
+    double num_samples = (double)NUM_BLOCKS * BLOCK_SIZE;
+    printf("%-20s %16.2f %16.2f\n", label, rand_ns / num_samples, noise_ns / num_samples);
+}
+
+// Function to print the mean and variance of the noise, which should be 0 and 1/3
+static void print_distribution(void)
+{
+    struct NoiseGenerator generator;
+    noise_seed(&generator, 1);
+
+    double sum = 0;
+    double sum_of_squares = 0;
+    for (int block = 0; block < 1000; block++) {
+        noise_fill(&generator, samples, BLOCK_SIZE);
+        for (int i = 0; i < BLOCK_SIZE; i++) {
+            sum += samples[i];
+            sum_of_squares += samples[i] * samples[i];
+        }
+    }
+    double num_samples = 1000.0 * BLOCK_SIZE;
+    printf("Noise mean %.5f, variance %.4f (uniform is 0 and 0.3333)\n",
+           sum / num_samples, sum_of_squares / num_samples);
+}
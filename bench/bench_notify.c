@@ -0,0 +1,223 @@
+/*
+ * This file benchmarks lgpio notifications through a shared memory ring
+ * against a pipe. Batches of reports are handed to emitNotifications() as
+ * the alert thread would. It first times emitting and draining each batch
+ * size on one thread, then streams reports to a consumer thread, flat out
+ * and paced like a fast edge source, and reports events per second and how
+ * long each report took from being emitted to being read.
+ */
+
+#include "lgpio.h"
+#include "utils.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define RING_SLOTS 65536       // Reports the ring holds
+#define PIPE_SIZE (1 << 20)    // Bytes the pipe holds
+#define NUM_BATCHES 200000     // Batches emitted for each batch size
+#define STREAM_REPORTS 2000000 // Reports streamed to the consumer thread
+#define STREAM_BATCH 16        // Reports per batch when streaming
+#define PACED_INTERVAL_NS 20000
+
+// Alert buffer and emitter of the alert thread in lgPthAlerts.c
+extern lgGpioAlert_t aBuf[];
+void emitNotifications(int count);
+
+// Struct of a notification and how to read it
+struct Channel {
+    const char *name;
+    int handle;
+    lgNotifyRing_p ring; // NULL for the pipe
+    int pipe_fd;
+};
+
+// Set once every report has been emitted, so a consumer missing dropped ones stops
+static atomic_bool is_stream_done;
+
+// Latency totals of the consumer thread
+static long long reports_read;
+static long long latency_total_ns;
+static long long latency_max_ns;
+
+// Helper function prototypes
+static void fill_batch(int handle, int size);
+static long long drain(const struct Channel *channel);
+static void time_batches(const struct Channel *channels, int num_channels, int batch_size);
+static void record_latency(const lgGpioReport_t *reports, int count);
+static void *consumer_thread(void *arg);
+static void stream(const struct Channel *channel, bool is_paced);
+
+int main(void)
+{
+    struct Channel ring_channel = {.name = "ring", .pipe_fd = -1};
+    ring_channel.handle = lgNotifyOpenRing(RING_SLOTS);
+    ring_channel.ring = lgNotifyGetRing(ring_channel.handle);
+
+    // Pipe notifications are read through the FIFO lgpio creates in its work directory
+    struct Channel pipe_channel = {.name = "pipe", .ring = NULL};
+    pipe_channel.handle = lgNotifyOpenWithSize(PIPE_SIZE);
+    char pipe_name[256];
+    snprintf(pipe_name, sizeof(pipe_name), "%s/.lgd-nfy%d", lguGetWorkDir(), pipe_channel.handle);
+    pipe_channel.pipe_fd = open(pipe_name, O_RDONLY | O_NONBLOCK);
+
+    if (ring_channel.ring == NULL || pipe_channel.pipe_fd < 0) {
+        printf("Unable to open the notifications (%s)\n", pipe_name);
+        return EXIT_FAILURE;
+    }
+
+    struct Channel channels[] = {ring_channel, pipe_channel};
+    printf("%d batches per size, ns per batch on one thread\n", NUM_BATCHES);
+    printf("%5s %10s %10s %13s %13s\n", "batch", "ring emit", "pipe emit", "ring consume", "pipe consume");
+    time_batches(channels, 2, 1);
+    time_batches(channels, 2, 16);
+    time_batches(channels, 2, 128);
+
+    printf("\n%d reports in batches of %d to a consumer thread\n", STREAM_REPORTS, STREAM_BATCH);
+    printf("%-5s %-10s %12s %15s %15s\n", "", "", "M events/s", "avg latency us", "max latency us");
+    stream(&ring_channel, false);
+    stream(&ring_channel, true);
+    stream(&pipe_channel, false);
+    stream(&pipe_channel, true);
+    printf("Ring dropped %u reports\n", ring_channel.ring->dropped);
+
+    close(pipe_channel.pipe_fd);
+    lgNotifyClose(ring_channel.handle);
+    lgNotifyClose(pipe_channel.handle);
+    return EXIT_SUCCESS;
+}
+
+// Function to fill the alert buffer with a batch of reports for a notification
+static void fill_batch(int handle, int size)
+{
+    long long now_ns = get_monotonic_time_in_ns();
+    for (int i = 0; i < size; i++) {
+        aBuf[i].nfyHandle = handle;
+        aBuf[i].report.timestamp = now_ns;
+        aBuf[i].report.chip = 0;
+        aBuf[i].report.gpio = i;
+        aBuf[i].report.level = i & 1;
+        aBuf[i].report.flags = 0;
+    }
+}
+
+// Function to read every waiting report, returning how long it took
+static long long drain(const struct Channel *channel)
+{
+    long long start_ns = get_monotonic_time_in_ns();
+    if (channel->ring != NULL) {
+        lgGpioReport_t *reports;
+        int count;
+        while ((count = lgNotifyRingPeek(channel->ring, &reports)) > 0) {
+            lgNotifyRingRelease(channel->ring, count);
+        }
+    }
+    else {
+        lgGpioReport_t reports[4096];
+        while (read(channel->pipe_fd, reports, sizeof(reports)) > 0) {
+        }
+    }
+    return get_monotonic_time_in_ns() - start_ns;
+}
+
+// Function to time emitting and draining batches of one size through each channel
+static void time_batches(const struct Channel *channels, int num_channels, int batch_size)
+{
+    long long emit_ns[2] = {0};
+    long long consume_ns[2] = {0};
+
+    for (int batch = 0; batch < NUM_BATCHES; batch++) {
+        for (int i = 0; i < num_channels; i++) {
+            fill_batch(channels[i].handle, batch_size);
+            long long start_ns = get_monotonic_time_in_ns();
+            emitNotifications(batch_size);
+            emit_ns[i] += get_monotonic_time_in_ns() - start_ns;
+            consume_ns[i] += drain(&channels[i]);
+        }
+    }
+    printf("%5d %10.0f %10.0f %13.0f %13.0f\n", batch_size,
+           (double)emit_ns[0] / NUM_BATCHES, (double)emit_ns[1] / NUM_BATCHES,
+           (double)consume_ns[0] / NUM_BATCHES, (double)consume_ns[1] / NUM_BATCHES);
+}
+
+// Function to add up how long reports took to arrive since they were emitted
+static void record_latency(const lgGpioReport_t *reports, int count)
+{
+    long long now_ns = get_monotonic_time_in_ns();
+    for (int i = 0; i < count; i++) {
+        long long latency_ns = now_ns - (long long)reports[i].timestamp;
+        latency_total_ns += latency_ns;
+        if (latency_ns > latency_max_ns) {
+            latency_max_ns = latency_ns;
+        }
+    }
+    reports_read += count;
+}
+
+// Function to read reports as they arrive, the way the HAL would
+static void *consumer_thread(void *arg)
+{
+    const struct Channel *channel = arg;
+
+    while (reports_read < STREAM_REPORTS) {
+        bool is_done = atomic_load(&is_stream_done);
+        int count = 0;
+        if (channel->ring != NULL) {
+            lgGpioReport_t *reports;
+            if (lgNotifyRingWait(channel->ring, 100) > 0) {
+                count = lgNotifyRingPeek(channel->ring, &reports);
+                record_latency(reports, count);
+                lgNotifyRingRelease(channel->ring, count);
+            }
+        }
+        else {
+            lgGpioReport_t reports[256];
+            struct pollfd pfd = {.fd = channel->pipe_fd, .events = POLLIN};
+            poll(&pfd, 1, 100);
+            ssize_t bytes = read(channel->pipe_fd, reports, sizeof(reports));
+            if (bytes > 0) {
+                count = bytes / sizeof(reports[0]);
+                record_latency(reports, count);
+            }
+        }
+        if (count == 0 && is_done) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+// Function to stream reports to a consumer thread, flat out or a batch every 20 us
+static void stream(const struct Channel *channel, bool is_paced)
+{
+    pthread_t thread;
+    reports_read = 0;
+    latency_total_ns = 0;
+    latency_max_ns = 0;
+    atomic_store(&is_stream_done, false);
+    pthread_create(&thread, NULL, consumer_thread, (void *)channel);
+
+    long long start_ns = get_monotonic_time_in_ns();
+    for (int sent = 0; sent < STREAM_REPORTS; sent += STREAM_BATCH) {
+        fill_batch(channel->handle, STREAM_BATCH);
+        emitNotifications(STREAM_BATCH);
+        if (is_paced) {
+            long long next_ns = get_monotonic_time_in_ns() + PACED_INTERVAL_NS;
+            while (get_monotonic_time_in_ns() < next_ns) {
+            }
+        }
+    }
+    atomic_store(&is_stream_done, true);
+    pthread_join(thread, NULL);
+    long long elapsed_ns = get_monotonic_time_in_ns() - start_ns;
+
+    printf("%-5s %-10s %12.2f %15.1f %15.1f %s\n", channel->name, is_paced ? "paced" : "flat out",
+           reports_read / (elapsed_ns / 1e9) / 1e6,
+           (double)latency_total_ns / reports_read / 1e3, latency_max_ns / 1e3,
+           reports_read < STREAM_REPORTS ? "(reports lost)" : "");
+}
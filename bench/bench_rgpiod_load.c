@@ -0,0 +1,243 @@
+/*
+ * This file is a load generator for the rgpiod socket interface. It opens
+ * hundreds of loopback connections to a running rgpiod, spread over a few
+ * client threads, and keeps one TICK command outstanding on each, sending the
+ * next as soon as the reply arrives. It reports the commands per second and
+ * the 50th, 99th and 99.9th percentile and worst round trip. Run it against
+ * rgpiod started with a thread per connection (the default) and with the
+ * event loop (-e), e.g.
+ *
+ *     rgpiod -p 8889 &          then  bench_rgpiod_load 256 4 5 8889
+ *     rgpiod -p 8890 -e 4 &     then  bench_rgpiod_load 256 4 5 8890
+ */
+
+#include "rgpiod.h"
+#include "utils.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define DEFAULT_CONNECTIONS 256
+#define DEFAULT_THREADS 4
+#define DEFAULT_SECONDS 5
+#define DEFAULT_PORT 8889          // rgpiod's default port
+#define MAX_THREADS 64
+#define MAX_SAMPLES 4000000        // Round trips each thread records
+#define MAX_EVENTS 256
+
+// Struct of a client connection and when its command was sent
+struct Connection {
+    int fd;
+    long long sent_ns;
+};
+
+// Struct of a client thread, its connections and the round trips it measured
+struct Client {
+    pthread_t thread;
+    int num_connections;
+    struct Connection *connections;
+    uint32_t *round_trips_100ns;
+    long num_round_trips;
+};
+
+static int port = DEFAULT_PORT;
+static atomic_bool is_running;
+
+// Helper function prototypes
+static int connect_to_rgpiod(void);
+static bool send_tick(struct Connection *connection);
+static bool read_reply(struct Connection *connection);
+static void *client_thread(void *arg);
+static int compare_round_trips(const void *p1, const void *p2);
+static void print_results(struct Client *clients, int num_threads, int num_connections, int seconds);
+
+int main(int argc, char *argv[])
+{
+    int num_connections = argc > 1 ? atoi(argv[1]) : DEFAULT_CONNECTIONS;
+    int num_threads = argc > 2 ? atoi(argv[2]) : DEFAULT_THREADS;
+    int seconds = argc > 3 ? atoi(argv[3]) : DEFAULT_SECONDS;
+    port = argc > 4 ? atoi(argv[4]) : DEFAULT_PORT;
+
+    if (num_threads < 1 || num_threads > MAX_THREADS || num_connections < num_threads || seconds < 1) {
+        fprintf(stderr, "Usage: %s [connections] [threads 1-%d] [seconds] [port]\n", argv[0], MAX_THREADS);
+        return EXIT_FAILURE;
+    }
+
+    // Each thread connects its share before the clock starts
+    static struct Client clients[MAX_THREADS];
+    for (int i = 0; i < num_threads; i++) {
+        struct Client *client = &clients[i];
+        client->num_connections = num_connections / num_threads + (i < num_connections % num_threads);
+        client->connections = calloc(client->num_connections, sizeof(*client->connections));
+        client->round_trips_100ns = malloc(sizeof(*client->round_trips_100ns) * MAX_SAMPLES);
+        if (client->connections == NULL || client->round_trips_100ns == NULL) {
+            fprintf(stderr, "Failed to allocate the client buffers\n");
+            return EXIT_FAILURE;
+        }
+        for (int j = 0; j < client->num_connections; j++) {
+            client->connections[j].fd = connect_to_rgpiod();
+        }
+    }
+
+    atomic_store(&is_running, true);
+    for (int i = 0; i < num_threads; i++) {
+        pthread_create(&clients[i].thread, NULL, client_thread, &clients[i]);
+    }
+    sleep(seconds);
+    atomic_store(&is_running, false);
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(clients[i].thread, NULL);
+    }
+
+    print_results(clients, num_threads, num_connections, seconds);
+
+    for (int i = 0; i < num_threads; i++) {
+        for (int j = 0; j < clients[i].num_connections; j++) {
+            close(clients[i].connections[j].fd);
+        }
+        free(clients[i].connections);
+        free(clients[i].round_trips_100ns);
+    }
+    return EXIT_SUCCESS;
+}
+
+// Function to open a connection to rgpiod on the loopback interface
+static int connect_to_rgpiod(void)
+{
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("Failed to connect to rgpiod");
+        exit(EXIT_FAILURE);
+    }
+
+    // Commands are small and answered one at a time, so send them at once
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+// Function to send a TICK command, the cheapest command rgpiod answers
+static bool send_tick(struct Connection *connection)
+{
+    lgCmd_t cmd = {.magic = LG_MAGIC, .size = 0, .cmd = LG_CMD_TICK};
+    connection->sent_ns = get_monotonic_time_in_ns();
+    return send(connection->fd, &cmd, sizeof(cmd), 0) == sizeof(cmd);
+}
+
+// Function to read a whole reply, its header and any extension after it
+static bool read_reply(struct Connection *connection)
+{
+    lgCmd_t reply;
+    if (recv(connection->fd, &reply, sizeof(reply), MSG_WAITALL) != sizeof(reply)) {
+        return false;
+    }
+
+    char extension[256];
+    uint32_t remaining = reply.size;
+    while (remaining > 0) {
+        size_t chunk = remaining < sizeof(extension) ? remaining : sizeof(extension);
+        if (recv(connection->fd, extension, chunk, MSG_WAITALL) != (ssize_t)chunk) {
+            return false;
+        }
+        remaining -= chunk;
+    }
+    return true;
+}
+
+// Function to keep one command outstanding on each of a thread's connections
+static void *client_thread(void *arg)
+{
+    struct Client *client = arg;
+    int epoll_fd = epoll_create1(0);
+
+    for (int i = 0; i < client->num_connections; i++) {
+        struct Connection *connection = &client->connections[i];
+        struct epoll_event event = {.events = EPOLLIN, .data.ptr = connection};
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, connection->fd, &event);
+        if (!send_tick(connection)) {
+            perror("Failed to send command");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    struct epoll_event events[MAX_EVENTS];
+    while (atomic_load_explicit(&is_running, memory_order_relaxed)) {
+        int count = epoll_wait(epoll_fd, events, MAX_EVENTS, 100);
+        for (int i = 0; i < count; i++) {
+            struct Connection *connection = events[i].data.ptr;
+            if (!read_reply(connection)) {
+                fprintf(stderr, "rgpiod closed a connection\n");
+                exit(EXIT_FAILURE);
+            }
+
+            long long round_trip_ns = get_monotonic_time_in_ns() - connection->sent_ns;
+            if (client->num_round_trips < MAX_SAMPLES) {
+                client->round_trips_100ns[client->num_round_trips++] = (uint32_t)(round_trip_ns / 100);
+            }
+            if (!send_tick(connection)) {
+                perror("Failed to send command");
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    close(epoll_fd);
+    return NULL;
+}
+
+// Function to order round trips for qsort()
+static int compare_round_trips(const void *p1, const void *p2)
+{
+    uint32_t a = *(const uint32_t *)p1;
+    uint32_t b = *(const uint32_t *)p2;
+    return (a > b) - (a < b);
+}
+
+// Function to print the command rate and the round trip percentiles of every thread together
+static void print_results(struct Client *clients, int num_threads, int num_connections, int seconds)
+{
+    long total = 0;
+    for (int i = 0; i < num_threads; i++) {
+        total += clients[i].num_round_trips;
+    }
+    if (total == 0) {
+        printf("No replies from rgpiod on port %d\n", port);
+        return;
+    }
+
+    uint32_t *round_trips = malloc(sizeof(*round_trips) * total);
+    if (round_trips == NULL) {
+        fprintf(stderr, "Failed to allocate the results\n");
+        return;
+    }
+    long count = 0;
+    for (int i = 0; i < num_threads; i++) {
+        memcpy(round_trips + count, clients[i].round_trips_100ns,
+               sizeof(*round_trips) * clients[i].num_round_trips);
+        count += clients[i].num_round_trips;
+    }
+    qsort(round_trips, total, sizeof(*round_trips), compare_round_trips);
+
+    printf("%d connections, %d threads, %d s on port %d\n", num_connections, num_threads, seconds, port);
+    printf("%10s %10s %10s %10s %10s %10s\n", "commands", "per s", "p50 us", "p99 us", "p99.9 us", "max us");
+    printf("%10ld %10.0f %10.1f %10.1f %10.1f %10.1f\n", total, (double)total / seconds,
+           round_trips[total / 2] / 10.0, round_trips[total * 99 / 100] / 10.0,
+           round_trips[total * 999 / 1000] / 10.0, round_trips[total - 1] / 10.0);
+    free(round_trips);
+}
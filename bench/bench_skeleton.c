@@ -0,0 +1,138 @@
+/*
+ * This file benchmarks drawing the hand skeleton on the LCD screen buffer.
+ * Frames of two hands with random landmarks are drawn the way the paint
+ * library did it, with Paint_DrawCircle() and dotted Paint_DrawLine(), and
+ * with the skeleton rasterizer, with and without anti-aliasing. Each frame
+ * includes clearing the buffer, which is also timed alone.
+ */
+
+#include "GUI_Paint.h"
+#include "skeleton_raster.h"
+#include "utils.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SCREEN_SIZE 240    // Width and height of the LCD
+#define NUM_FRAMES 5000    // Frames drawn each way
+#define NUM_LANDMARKS 21
+#define JOINT_RADIUS 3     // As drawn by lcd_menus.c
+#define HAND_SPREAD 110    // Pixels a hand's landmarks spread over
+
+// Ways of drawing a frame
+enum DrawMode {
+    DRAW_PAINT,
+    DRAW_RASTER,
+    DRAW_RASTER_ANTIALIASED,
+    NUM_DRAW_MODES,
+};
+
+static const char *mode_names[NUM_DRAW_MODES] = {
+    "Paint_DrawCircle/DrawLine",
+    "raster",
+    "raster anti-aliased",
+};
+
+// Landmark pairs joined by a bone, as in lcd_menus.c
+static const int bones[][2] = {
+    {0, 1}, {1, 2}, {2, 3}, {3, 4},
+    {0, 5}, {5, 6}, {6, 7}, {7, 8},
+    {5, 9}, {9, 13}, {13, 17},
+    {9, 10}, {10, 11}, {11, 12},
+    {13, 14}, {14, 15}, {15, 16},
+    {0, 17}, {17, 18}, {18, 19}, {19, 20},
+};
+#define NUM_BONES ((int)(sizeof(bones) / sizeof(bones[0])))
+
+static UWORD frame_buffer[SCREEN_SIZE * SCREEN_SIZE];
+
+// Helper function prototypes
+static void random_hand(int points[], unsigned int *seed);
+static void draw_frame(enum DrawMode mode, unsigned int seed);
+static void run(enum DrawMode mode);
+
+int main(void)
+{
+    Paint_NewImage(frame_buffer, SCREEN_SIZE, SCREEN_SIZE, 0, BLACK, 16);
+
+    printf("%d frames of two hands, clear included\n", NUM_FRAMES);
+    printf("%-28s %10s %10s\n", "", "avg us", "min us");
+    for (int mode = 0; mode < NUM_DRAW_MODES; mode++) {
+        run(mode);
+    }
+
+    long long start_ns = get_monotonic_time_in_ns();
+    for (int frame = 0; frame < NUM_FRAMES; frame++) {
+        Paint_Clear(BLACK);
+    }
+    printf("%-28s %10.1f\n", "clear alone", (get_monotonic_time_in_ns() - start_ns) / 1e3 / NUM_FRAMES);
+    return EXIT_SUCCESS;
+}
+
+// Function to place the landmarks of a hand at random around a random wrist
+static void random_hand(int points[], unsigned int *seed)
+{
+    int wrist_x = HAND_SPREAD / 2 + rand_r(seed) % (SCREEN_SIZE - HAND_SPREAD);
+    int wrist_y = HAND_SPREAD / 2 + rand_r(seed) % (SCREEN_SIZE - HAND_SPREAD);
+    for (int i = 0; i < NUM_LANDMARKS; i++) {
+        points[2 * i] = wrist_x - HAND_SPREAD / 2 + rand_r(seed) % HAND_SPREAD;
+        points[2 * i + 1] = wrist_y - HAND_SPREAD / 2 + rand_r(seed) % HAND_SPREAD;
+    }
+}
+
+// Function to clear the buffer and draw the joints and dotted bones of two hands
+static void draw_frame(enum DrawMode mode, unsigned int seed)
+{
+    const struct RasterImage image = {frame_buffer, SCREEN_SIZE, SCREEN_SIZE};
+    const UWORD colors[2] = {WHITE, GREEN};
+
+    Paint_Clear(BLACK);
+    for (int hand = 0; hand < 2; hand++) {
+        int points[2 * NUM_LANDMARKS];
+        random_hand(points, &seed);
+
+        for (int i = 0; i < NUM_LANDMARKS; i++) {
+            int x = points[2 * i];
+            int y = points[2 * i + 1];
+            if (mode == DRAW_PAINT) {
+                Paint_DrawCircle(x, y, JOINT_RADIUS, colors[hand], DOT_PIXEL_1X1, DRAW_FILL_FULL);
+            }
+            else {
+                skeleton_raster_disc(&image, x, y, JOINT_RADIUS, colors[hand]);
+            }
+        }
+
+        for (int i = 0; i < NUM_BONES; i++) {
+            const int *from = &points[2 * bones[i][0]];
+            const int *to = &points[2 * bones[i][1]];
+            if (mode == DRAW_PAINT) {
+                Paint_DrawLine(from[0], from[1], to[0], to[1], colors[hand], DOT_PIXEL_1X1, LINE_STYLE_DOTTED);
+            }
+            else {
+                skeleton_raster_line(&image, from[0], from[1], to[0], to[1], colors[hand], true,
+                                     mode == DRAW_RASTER_ANTIALIASED);
+            }
+        }
+    }
+}
+
+// Function to time drawing the same frames one way, twice, printing the second pass
+static void run(enum DrawMode mode)
+{
+    for (int pass = 0; pass < 2; pass++) {
+        long long total_ns = 0;
+        long long min_ns = -1;
+        for (int frame = 0; frame < NUM_FRAMES; frame++) {
+            long long start_ns = get_monotonic_time_in_ns();
+            draw_frame(mode, frame);
+            long long frame_ns = get_monotonic_time_in_ns() - start_ns;
+            total_ns += frame_ns;
+            if (min_ns < 0 || frame_ns < min_ns) {
+                min_ns = frame_ns;
+            }
+        }
+        if (pass == 1) {
+            printf("%-28s %10.1f %10.1f\n", mode_names[mode], total_ns / 1e3 / NUM_FRAMES, min_ns / 1e3);
+        }
+    }
+}
@@ -0,0 +1,155 @@
+/*
+ * This file benchmarks the timing of lgpio software PWM. The tx thread runs
+ * against a simulated GPIO backend whose xWrite() timestamps each edge
+ * instead of setting a line. Square waves are started on 16 to 1024 GPIOs
+ * with staggered offsets, and the error of every edge interval from the
+ * expected half period is reported as percentiles, with the edges output
+ * against those expected and the CPU time each edge cost.
+ */
+
+#include "lgPthTx.h"
+#include "utils.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#define MAX_EDGES 4000000   // Edges recorded in one run
+#define MAX_GPIOS 1024
+#define RUN_SECONDS 3
+
+// Struct of an edge written to the simulated backend
+struct Edge {
+    long long timestamp_ns;
+    int gpio;
+};
+
+// Struct of a run, its GPIO count and the half period of their square waves
+struct Run {
+    int num_gpios;
+    int half_period_us;
+};
+
+static const struct Run runs[] = {
+    {16, 500},
+    {256, 10000},
+    {1024, 40000},
+};
+
+// Edges of the current run, only written by the tx thread
+static struct Edge edges[MAX_EDGES];
+static int num_edges;
+static int recording_handle = -1;
+
+// Helper function prototypes
+static double get_cpu_time_in_s(void);
+static int compare_errors(const void *p1, const void *p2);
+static void run(const struct Run *config, int handle);
+
+int main(void)
+{
+    lgPthTxStart();
+
+    printf("%d s per run, edge interval error from the half period\n", RUN_SECONDS);
+    printf("%5s %9s %9s %9s %8s %8s %10s %10s %12s\n", "gpios", "period us", "edges", "expected",
+           "p50 us", "p99 us", "p99.9 us", "max us", "cpu ns/edge");
+    for (int i = 0; i < (int)(sizeof(runs) / sizeof(runs[0])); i++) {
+        run(&runs[i], i + 1);
+    }
+    return EXIT_SUCCESS;
+}
+
+// Function lgpio calls to set a line, which records the edge of the current run instead
+void xWrite(lgChipObj_p chip, int gpio, int value)
+{
+    (void)value;
+    if (chip->handle == recording_handle && num_edges < MAX_EDGES) {
+        edges[num_edges].timestamp_ns = get_monotonic_time_in_ns();
+        edges[num_edges].gpio = gpio;
+        num_edges++;
+    }
+}
+
+// Function lgpio calls to set a group of lines, which waves would use and PWM does not
+void xGroupWrite(lgChipObj_p chip, int gpio, uint64_t groupBits, uint64_t groupMask)
+{
+    (void)chip;
+    (void)gpio;
+    (void)groupBits;
+    (void)groupMask;
+}
+
+// Function to get the CPU time the process has used
+static double get_cpu_time_in_s(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// Function to order edge interval errors for qsort()
+static int compare_errors(const void *p1, const void *p2)
+{
+    long long a = *(const long long *)p1;
+    long long b = *(const long long *)p2;
+    return (a > b) - (a < b);
+}
+
+// Function to run square waves on a number of GPIOs and report the error of their edges
+static void run(const struct Run *config, int handle)
+{
+    static lgChipObj_t chip;
+    static long long last_edge_ns[MAX_GPIOS];
+    static long long errors[MAX_EDGES];
+    int period_us = 2 * config->half_period_us;
+
+    chip.handle = handle;
+    lgPthTxLock();
+    num_edges = 0;
+    recording_handle = handle;
+    lgPthTxUnlock();
+
+    // Offsets spread the edges over the period rather than all due at once
+    double start_cpu_s = get_cpu_time_in_s();
+    for (int gpio = 0; gpio < config->num_gpios; gpio++) {
+        lgGpioCreateTxRec(&chip, gpio, config->half_period_us, config->half_period_us,
+                          (gpio * 37) % period_us, 0);
+    }
+    sleep(RUN_SECONDS);
+
+    lgPthTxLock();
+    lgPthTxStop(&chip);
+    recording_handle = -1;
+    int count = num_edges;
+    lgPthTxUnlock();
+    double cpu_s = get_cpu_time_in_s() - start_cpu_s;
+
+    // Stopped records are freed once their next edge comes due
+    usleep(period_us + 100000);
+
+    for (int gpio = 0; gpio < config->num_gpios; gpio++) {
+        last_edge_ns[gpio] = -1;
+    }
+    int num_errors = 0;
+    for (int i = 0; i < count; i++) {
+        const struct Edge *edge = &edges[i];
+        if (last_edge_ns[edge->gpio] >= 0) {
+            long long error_ns = edge->timestamp_ns - last_edge_ns[edge->gpio] - config->half_period_us * 1000LL;
+            errors[num_errors++] = error_ns < 0 ? -error_ns : error_ns;
+        }
+        last_edge_ns[edge->gpio] = edge->timestamp_ns;
+    }
+    if (num_errors == 0) {
+        printf("%5d no edges\n", config->num_gpios);
+        return;
+    }
+    qsort(errors, num_errors, sizeof(errors[0]), compare_errors);
+
+    long long expected = (long long)config->num_gpios * RUN_SECONDS * 1000000 / config->half_period_us;
+    printf("%5d %9d %9d %9lld %8.1f %8.1f %10.1f %10.1f %12.0f\n", config->num_gpios, period_us,
+           count, expected, errors[num_errors / 2] / 1e3, errors[(long)num_errors * 99 / 100] / 1e3,
+           errors[(long)num_errors * 999 / 1000] / 1e3, errors[num_errors - 1] / 1e3,
+           cpu_s * 1e9 / count);
+}
@@ -50,6 +50,14 @@ long long get_time_in_us(void);
  */
 long long get_time_in_ns(void);
 
+/**
+ * Gets the time of the monotonic clock in nanoseconds, for timing how long
+ * code takes. Unlike get_time_in_ns() it can be called from any thread.
+ *
+ * @return The time in nanoseconds from an arbitrary starting point.
+ */
+long long get_monotonic_time_in_ns(void);
+
 /**
  * Trims the newline character from a string (if present).
  *
@@ -66,6 +66,13 @@ long long get_time_in_ns(void)
     return nanoSeconds;
 }
 
+long long get_monotonic_time_in_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
 void trim_newline(char *str)
 {
     size_t len = strlen(str);
@@ -0,0 +1,87 @@
+/*
+ * This module is used to run the effects chain of the Sine Mixer. The mixed
+ * voices pass through a waveshaper, a state-variable filter, a chorus, a
+ * delay and a small reverb, one block at a time. Every buffer is allocated
+ * when the module starts, and the parameters are read without locking, so
+ * processing a block never waits on the controls.
+ */
+
+#ifndef _AUDIO_EFFECTS_H_
+#define _AUDIO_EFFECTS_H_
+
+#define AUDIO_EFFECTS_PARAM_MAX 100 // Parameters range from 0 to this value
+
+// Parameters of the effects chain that can be adjusted
+typedef enum {
+    AUDIO_EFFECT_DRIVE,            // Waveshaper gain, 0 leaves the signal clean
+    AUDIO_EFFECT_FILTER_CUTOFF,    // Low-pass cutoff, from 80 Hz up to fully open
+    AUDIO_EFFECT_FILTER_RESONANCE, // Resonance at the cutoff
+    AUDIO_EFFECT_CHORUS,           // Chorus depth and mix
+    AUDIO_EFFECT_DELAY_MIX,        // Level of the echoes
+    AUDIO_EFFECT_DELAY_TIME,       // Time between echoes, from 50 ms to 1 s
+    AUDIO_EFFECT_REVERB,           // Level of the reverb
+    AUDIO_EFFECT_PARAM_COUNT
+} AudioEffectParam;
+
+
+/**
+ * Initializes the effects chain, allocating its delay lines, and starts
+ * its timing stats afresh. Must be called before any other functions.
+ *
+ * @param sample_rate The sample rate of the audio, in Hz.
+ */
+void audio_effects_init(int sample_rate);
+
+
+/**
+ * Sets a parameter of the effects chain. The change is picked up at the
+ * start of the next block.
+ *
+ * @param param The parameter to set.
+ * @param value The new value, from 0 to AUDIO_EFFECTS_PARAM_MAX.
+ */
+void audio_effects_set_param(AudioEffectParam param, int value);
+
+
+/**
+ * Gets a parameter of the effects chain.
+ *
+ * @param param The parameter to get.
+ * @return The current value, from 0 to AUDIO_EFFECTS_PARAM_MAX.
+ */
+int audio_effects_get_param(AudioEffectParam param);
+
+
+/**
+ * Gets the name of a parameter, for display.
+ *
+ * @param param The parameter to name.
+ * @return The name of the parameter.
+ */
+const char *audio_effects_get_param_name(AudioEffectParam param);
+
+
+/**
+ * Runs a block of samples through the effects chain in place.
+ * Must only be called from the playback thread.
+ *
+ * @param samples The samples to process, between -1 and 1.
+ * @param cutoff_ratios The modulation of the filter cutoff, a ratio per sample.
+ * @param size The number of samples in the block.
+ */
+void audio_effects_process(double *samples, const double *cutoff_ratios, int size);
+
+
+/**
+ * Prints the average and longest time each effect took per block.
+ * Must not be called while blocks are being processed.
+ */
+void audio_effects_print_stats(void);
+
+
+/**
+ * Frees the delay lines of the effects chain.
+ */
+void audio_effects_cleanup(void);
+
+#endif
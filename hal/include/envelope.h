@@ -0,0 +1,86 @@
+/*
+ * This module is used to shape the level of each voice of the Sine Mixer
+ * with an ADSR envelope. Each segment is an exponential curve computed
+ * with one multiply and one add per sample, from coefficients worked out
+ * when the envelope is set up, so rendering never calls exp(). A new note
+ * attacks from the level the envelope is at, and a released note fades
+ * out instead of stopping, so neither clicks.
+ */
+
+#ifndef _ENVELOPE_H_
+#define _ENVELOPE_H_
+
+#include <stdbool.h>
+
+// Stages of an envelope
+enum EnvelopeStage {
+    ENVELOPE_IDLE,
+    ENVELOPE_ATTACK,
+    ENVELOPE_DECAY,
+    ENVELOPE_SUSTAIN,
+    ENVELOPE_RELEASE
+};
+
+// Struct representing an envelope and the coefficients of its segments
+struct Envelope {
+    enum EnvelopeStage stage;
+    double level;
+    double sustain;
+    double attack_coef;
+    double attack_base;
+    double decay_coef;
+    double decay_base;
+    double release_coef;
+    double release_base;
+};
+
+
+/**
+ * Sets up an envelope, idle at a level of 0.
+ *
+ * @param envelope The envelope to set up.
+ * @param attack_ms The time to rise from 0 to full level.
+ * @param decay_ms The time to fall from full level to the sustain level.
+ * @param sustain The level held while the note is held, from 0 to 1.
+ * @param release_ms The time to fall from the sustain level to 0 once the note is released.
+ * @param sample_rate The sample rate of the audio, in Hz.
+ */
+void envelope_init(struct Envelope *envelope, double attack_ms, double decay_ms, double sustain,
+                   double release_ms, int sample_rate);
+
+
+/**
+ * Starts the attack of a note from the current level.
+ *
+ * @param envelope The envelope to start.
+ */
+void envelope_note_on(struct Envelope *envelope);
+
+
+/**
+ * Starts the release of a note from the current level.
+ *
+ * @param envelope The envelope to release.
+ */
+void envelope_note_off(struct Envelope *envelope);
+
+
+/**
+ * Checks if an envelope is still sounding.
+ *
+ * @param envelope The envelope to check.
+ * @return False once the release has finished, true otherwise.
+ */
+bool envelope_is_active(const struct Envelope *envelope);
+
+
+/**
+ * Renders the level of an envelope for a block of samples.
+ *
+ * @param envelope The envelope to render.
+ * @param levels Where the level of each sample is stored.
+ * @param size The number of samples in the block.
+ */
+void envelope_render(struct Envelope *envelope, double *levels, int size);
+
+#endif
@@ -0,0 +1,71 @@
+/*
+ * This module runs the event loop shared by the input devices. A single
+ * thread waits with epoll on every registered file descriptor (GPIO line
+ * events, timers and sockets) and calls the handler of each one that becomes
+ * readable, so devices do not need a thread of their own to wait on.
+ */
+
+#ifndef _EVENT_LOOP_H_
+#define _EVENT_LOOP_H_
+
+#include <stdbool.h>
+
+#define EVENT_LOOP_MAX_SOURCES 16 // Maximum number of registered descriptors
+
+// Function called from the event loop thread when a descriptor is readable
+typedef void (*EventHandler)(void *context);
+
+
+/**
+ * Creates the event loop and starts its thread. Must be called before any
+ * descriptor is registered.
+ */
+void event_loop_init(void);
+
+
+/**
+ * Registers a descriptor, calling the handler each time it is readable.
+ * The handler must consume the pending data, or it is called again.
+ *
+ * @param fd The file descriptor to watch.
+ * @param handler Function to call when the descriptor is readable.
+ * @param context Pointer passed to the handler.
+ */
+void event_loop_add_fd(int fd, EventHandler handler, void *context);
+
+
+/**
+ * Unregisters a descriptor. Once this returns, its handler is not running
+ * and will not be called again. Must not be called from a handler.
+ *
+ * @param fd The file descriptor to stop watching.
+ */
+void event_loop_remove_fd(int fd);
+
+
+/**
+ * Creates a periodic timer and calls the handler each time it expires.
+ *
+ * @param period_ms The period of the timer in milliseconds.
+ * @param handler Function to call when the timer expires.
+ * @param context Pointer passed to the handler.
+ * @return The timer descriptor, used to remove the timer.
+ */
+int event_loop_add_timer(int period_ms, EventHandler handler, void *context);
+
+
+/**
+ * Stops and closes a timer created by event_loop_add_timer().
+ *
+ * @param timer_fd The timer descriptor to remove.
+ */
+void event_loop_remove_timer(int timer_fd);
+
+
+/**
+ * Stops the event loop thread and closes the loop. Every descriptor should
+ * be removed by its owner first.
+ */
+void event_loop_cleanup(void);
+
+#endif
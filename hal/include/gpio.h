@@ -1,18 +1,24 @@
 /*
  * This module for low-level GPIO access using libgpiod. Includes functions 
  * for initializing GPIO chips, opening GPIO lines for event reading, and
- * waiting for line changes.
+ * reading line changes once their event descriptor is readable.
  */
 
-#ifndef _GPIO_H_
-#define _GPIO_H_
+#ifndef _HAL_GPIO_H_
+#define _HAL_GPIO_H_
 
 #include <stdbool.h>
-#include <gpiod.h>
 
 // Structure representing a GPIO line
 struct GPIOLine;
 
+// Structure representing a single edge event read from a GPIO line
+struct GPIOEvent {
+    int line_number; // Line number on its GPIO chip that changed
+    bool is_rising;  // True for a rising edge, false for a falling edge
+    long long timestamp_ns; // Time the kernel saw the edge
+};
+
 // Enumeration of available GPIO chips.
 enum eGPIOChips {
     GPIO_CHIP_0,       // GPIO chip 0
@@ -29,7 +35,7 @@ void gpio_initialize(void);
 
 
 /**
- * Opens a GPIO line for event handling.
+ * Opens a GPIO line and requests both edge events on it.
  * 
  * @param chip The GPIO chip to use (e.g., GPIO_CHIP_0).
  * @param pinNumber The GPIO pin number to open (e.g., 15).
@@ -39,35 +45,23 @@ struct GPIOLine* gpio_open_for_events(enum eGPIOChips chip, int pin_number);
 
 
 /**
- * Waits for changes on one specified GPIO line.
+ * Gets the descriptor that becomes readable when the line has an event,
+ * to be watched by the event loop.
  * 
- * @param line1 Pointer to the first GPIO line to monitor.
- * @param bulk_events Pointer to a gpiod_line_bulk structure for event storage.
- * @param should_exit Pointer to a flag used for graceful thread exit.
- * @return 0 on success, or a negative value on failure.
+ * @param line Pointer to the GPIO line opened for events.
+ * @return The event file descriptor of the line.
  */
-int gpio_wait_for_line_change_one(
-    struct GPIOLine* line1, 
-    struct gpiod_line_bulk *bulkEvents, 
-    volatile bool *should_exit
-);
+int gpio_get_event_fd(struct GPIOLine* line);
 
 
 /**
- * Waits for changes on two specified GPIO lines.
+ * Reads one pending event from a line whose event descriptor is readable.
  * 
- * @param line1 Pointer to the first GPIO line to monitor.
- * @param line2 Pointer to the second GPIO line to monitor.
- * @param bulk_events Pointer to a gpiod_line_bulk structure for event storage.
- * @param should_exit Pointer to a flag used for graceful thread exit.
- * @return 0 on success, or a negative value on failure.
+ * @param line Pointer to the GPIO line opened for events.
+ * @param event Pointer to where the event read is stored.
+ * @return 0 on success, or -1 on failure.
  */
-int gpio_wait_for_line_change_two(
-    struct GPIOLine* line1,
-    struct GPIOLine* line2,
-    struct gpiod_line_bulk *bulk_events,
-    volatile bool *should_exit
-);
+int gpio_read_event(struct GPIOLine* line, struct GPIOEvent *event);
 
 
 /**
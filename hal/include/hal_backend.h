@@ -0,0 +1,77 @@
+/*
+ * This module defines the backend used by the HAL drivers to reach the devices.
+ * The board backend talks to libgpiod, i2c-dev and lgpio on the BeagleY-AI,
+ * while the simulated backend replays scripted joystick values, encoder edges
+ * and distance traces and discards display frames, so the whole program can
+ * run on a workstation without the board.
+ */
+
+#ifndef _HAL_BACKEND_H_
+#define _HAL_BACKEND_H_
+
+#include "joystick.h"
+#include "gpio.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Struct of the device operations a backend provides to the HAL drivers
+typedef struct {
+    const char *name; // Name of the backend, for logging
+
+    // Joystick ADC, returning raw 12-bit conversions
+    int (*joystick_open)(void);
+    uint16_t (*joystick_read_raw)(int handle, JoystickDirection dir);
+    void (*joystick_close)(int handle);
+
+    // Edge events on GPIO input lines
+    void (*gpio_initialize)(void);
+    struct GPIOLine *(*gpio_open_for_events)(enum eGPIOChips chip, int pin_number);
+    int (*gpio_get_event_fd)(struct GPIOLine *line);
+    int (*gpio_read_event)(struct GPIOLine *line, struct GPIOEvent *event);
+    void (*gpio_close)(struct GPIOLine *line);
+    void (*gpio_cleanup)(void);
+
+    // Ultrasonic distance sensor, returning cm or -1 on a missed echo
+    void (*distance_open)(void);
+    int (*distance_measure_cm)(void);
+    void (*distance_close)(void);
+
+    // LCD panel, taking full 240x240 RGB565 frames
+    int (*display_init)(void);
+    void (*display_show)(uint16_t *image);
+    void (*display_exit)(void);
+} HalBackend;
+
+// Backend using the devices wired to the board
+extern const HalBackend hal_backend_board;
+
+// Backend using scripted devices, for runs without the board
+extern const HalBackend hal_backend_simulated;
+
+
+/**
+ * Selects the backend used by every HAL driver. Must be called before any
+ * driver is initialized; the board backend is used otherwise.
+ *
+ * @param backend Pointer to the backend to use.
+ */
+void hal_backend_select(const HalBackend *backend);
+
+
+/**
+ * Gets the backend currently used by the HAL drivers.
+ *
+ * @return Pointer to the selected backend.
+ */
+const HalBackend *hal_backend_get(void);
+
+
+/**
+ * Sets how long a simulated run lasts before the simulated joystick
+ * button is pressed to end the program.
+ *
+ * @param seconds The run time in seconds, or 0 to run until stopped.
+ */
+void hal_backend_simulated_set_run_time(int seconds);
+
+#endif
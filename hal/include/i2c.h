@@ -2,6 +2,11 @@
  * This module has helper functions for I2C, including
  * starting the I2C bus and reading/writing 16-bit registers.
  * Functions are from the CMPT433 course I2C Guide.
+ *
+ * Register accesses can also be queued into a transaction, which is sent as
+ * one I2C_RDWR ioctl: each register read becomes a write of the register
+ * address followed by a repeated-start read, so a batch of reads and writes
+ * to a device costs a single syscall.
  */
 
 #ifndef _I2C_H_
@@ -17,8 +22,25 @@
 #include <assert.h>
 #include <stdint.h>
 #include <fcntl.h>
+#include <string.h>
 #include <stdio.h>
 
+#define I2C_TRANSACTION_MAX_OPS 8 // Register accesses that fit in one transaction
+
+// Struct of register accesses queued to be sent as one combined transfer
+typedef struct {
+	int i2c_file_desc;
+	uint16_t address;
+	int num_ops;
+	int num_msgs;
+	int num_reads;
+	struct i2c_msg msgs[I2C_TRANSACTION_MAX_OPS * 2];
+	uint8_t tx_buffers[I2C_TRANSACTION_MAX_OPS][3];
+	uint8_t rx_buffers[I2C_TRANSACTION_MAX_OPS][2];
+	int read_ops[I2C_TRANSACTION_MAX_OPS];
+	uint16_t *read_results[I2C_TRANSACTION_MAX_OPS];
+} I2CTransaction;
+
 
 /**
  * Initializes the I2C bus for communication with a specific device.
@@ -49,5 +71,45 @@ void write_i2c_reg16(int i2c_file_desc, uint8_t reg_addr, uint16_t value);
  */
 uint16_t read_i2c_reg16(int i2c_file_desc, uint8_t reg_addr);
 
+
+/**
+ * Starts an empty transaction for a device on an opened I2C bus.
+ *
+ * @param transaction Pointer to the transaction to start.
+ * @param i2c_file_desc The file descriptor for the I2C bus.
+ * @param address The address of the I2C device.
+ */
+void i2c_transaction_begin(I2CTransaction *transaction, int i2c_file_desc, uint16_t address);
+
+
+/**
+ * Queues a write of a 16-bit value (little-endian) to a register.
+ *
+ * @param transaction Pointer to the transaction.
+ * @param reg_addr The register address to write to.
+ * @param value The 16-bit value to write.
+ */
+void i2c_transaction_write_reg16(I2CTransaction *transaction, uint8_t reg_addr, uint16_t value);
+
+
+/**
+ * Queues a repeated-start read of a 16-bit register. The value is stored
+ * in the same byte order as read_i2c_reg16() once the transaction executes.
+ *
+ * @param transaction Pointer to the transaction.
+ * @param reg_addr The register address to read from.
+ * @param value Pointer to where the value read is stored.
+ */
+void i2c_transaction_read_reg16(I2CTransaction *transaction, uint8_t reg_addr, uint16_t *value);
+
+
+/**
+ * Sends every queued access in one I2C_RDWR ioctl and stores the values
+ * read. The transaction is empty again afterwards and can be reused.
+ *
+ * @param transaction Pointer to the transaction to execute.
+ */
+void i2c_transaction_execute(I2CTransaction *transaction);
+
 #endif
  
\ No newline at end of file
@@ -1,7 +1,9 @@
 /*
  * This module is used to read the joystick input on the BeagleBone. The joystick
  * can be read along the X or Y axis, and the values are scaled to [-100, 100] in
- * both directions to make it easier to work with.
+ * both directions to make it easier to work with. A timer on the event loop can
+ * also sample the joystick at a fixed rate and publish changes in the direction it is
+ * held, so callers block until the joystick moves instead of polling it.
  */
 
 #ifndef _JOYSTICK_H
@@ -17,6 +19,15 @@ typedef enum {
     JOYSTICK_Y  // Joystick input along the Y-axis.
 } JoystickDirection;
 
+// Enum representing the directions the joystick can be held in.
+typedef enum {
+    JOYSTICK_CENTER, // Joystick at rest.
+    JOYSTICK_UP,     // Joystick pushed towards +Y.
+    JOYSTICK_DOWN,   // Joystick pushed towards -Y.
+    JOYSTICK_LEFT,   // Joystick pushed towards -X.
+    JOYSTICK_RIGHT   // Joystick pushed towards +X.
+} JoystickPosition;
+
 // Struct of a joystick.
 typedef struct {
     int i2c_file_desc;   // I2C file descriptor for the joystick.
@@ -42,6 +53,36 @@ void joystick_init(Joystick *joystick);
 int joystick_read_input(Joystick *joystick, JoystickDirection dir);
 
 
+/**
+ * Starts sampling from the event loop, reading both axes at the given rate and
+ * publishes a change whenever the joystick moves to a different direction.
+ * The axes are read on alternate ticks, so the ADC settles between them.
+ * 
+ * @param joystick Pointer to the Joystick struct to sample.
+ * @param rate_hz The number of samples per second.
+ */
+void joystick_start_sampling(Joystick *joystick, int rate_hz);
+
+
+/**
+ * Blocks until the joystick is held in a different direction than the one
+ * given, or until sampling stops.
+ * 
+ * @param joystick Pointer to the sampled Joystick struct.
+ * @param position The direction the caller last saw.
+ * @return The new direction, or the given one if sampling stopped.
+ */
+JoystickPosition joystick_wait_for_position_change(Joystick *joystick, JoystickPosition position);
+
+
+/**
+ * Stops sampling and wakes every caller waiting for a change.
+ * 
+ * @param joystick Pointer to the sampled Joystick struct.
+ */
+void joystick_stop_sampling(Joystick *joystick);
+
+
 /**
  * Clean up joystick by closing the I2C connection and uninitializing.
  * 
@@ -10,7 +10,6 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <gpiod.h>
 
 // Struct representing the Joystick button device
 typedef struct {
@@ -0,0 +1,111 @@
+/*
+ * This module is used to modulate the Sine Mixer. Three LFOs, a noise
+ * source and the distance and hand position controls are the sources, and a matrix of
+ * amounts routes each of them to the pitch, gain, filter cutoff and
+ * waveform morph. The matrix is evaluated at a control rate and each
+ * destination is interpolated between evaluations, giving one value per
+ * sample. Every route is summed whether it is set or not, so a block
+ * always costs the same.
+ */
+
+#ifndef _MODULATION_H_
+#define _MODULATION_H_
+
+#define MODULATION_CONTROL_PERIOD 32         // Samples between evaluations of the matrix
+#define MODULATION_AMOUNT_MAX 100            // Routes range from -this value to this value
+#define MODULATION_PITCH_RANGE_SEMITONES 2.0 // Pitch moved by a full source at the largest amount
+
+// Sources of modulation. The LFOs and noise swing from -1 to 1, the controls from 0 to 1.
+typedef enum {
+    MODULATION_SOURCE_LFO_1,    // 5.5 Hz sine, for vibrato
+    MODULATION_SOURCE_LFO_2,    // 0.5 Hz triangle, for slow sweeps
+    MODULATION_SOURCE_LFO_3,    // 2 Hz smoothed random, for drift
+    MODULATION_SOURCE_NOISE,    // New random value each control period, for rough jitter
+    MODULATION_SOURCE_DISTANCE, // Closeness of the hand to the distance sensor
+    MODULATION_SOURCE_HAND_X,   // Palm of the first hand, left to right
+    MODULATION_SOURCE_HAND_Y,   // Palm of the first hand, bottom to top
+    MODULATION_SOURCE_COUNT
+} ModulationSource;
+
+// Destinations of modulation
+typedef enum {
+    MODULATION_DEST_PITCH,          // Up to MODULATION_PITCH_RANGE_SEMITONES either way
+    MODULATION_DEST_GAIN,           // Up to 12 dB either way
+    MODULATION_DEST_FILTER_CUTOFF,  // Up to 4 octaves either way
+    MODULATION_DEST_WAVEFORM_MORPH, // Blend from the selected waveform into the next one
+    MODULATION_DEST_COUNT
+} ModulationDestination;
+
+
+/**
+ * Initializes the modulation, allocating a buffer per destination.
+ * Must be called before rendering. Routes and sources set beforehand are kept.
+ *
+ * @param sample_rate The sample rate of the audio, in Hz.
+ * @param max_block_size The most samples that will be rendered at once.
+ */
+void modulation_init(int sample_rate, int max_block_size);
+
+
+/**
+ * Sets how much a source moves a destination.
+ *
+ * @param source The source to route.
+ * @param destination The destination to route it to.
+ * @param amount From -MODULATION_AMOUNT_MAX to MODULATION_AMOUNT_MAX, 0 removes the route.
+ */
+void modulation_set_route(ModulationSource source, ModulationDestination destination, int amount);
+
+
+/**
+ * Gets how much a source moves a destination.
+ *
+ * @param source The routed source.
+ * @param destination The destination it is routed to.
+ * @return The amount of the route.
+ */
+int modulation_get_route(ModulationSource source, ModulationDestination destination);
+
+
+/**
+ * Sets the value of one of the control sources. The value is smoothed at
+ * the control rate, so it can be set at whatever rate the control is read.
+ *
+ * @param source The control to set, not one of the LFOs.
+ * @param value The new value, from 0 to 1.
+ */
+void modulation_set_source(ModulationSource source, double value);
+
+
+/**
+ * Renders the destinations for the next block of samples.
+ * Must only be called from the playback thread.
+ *
+ * @param size The number of samples in the block.
+ */
+void modulation_render(int size);
+
+
+/**
+ * Gets the values of a destination rendered for the current block. Pitch,
+ * gain and cutoff are ratios to multiply by, and the morph goes from 0 to 1.
+ *
+ * @param destination The destination to get.
+ * @return One value per sample of the block.
+ */
+const double *modulation_get_buffer(ModulationDestination destination);
+
+
+/**
+ * Prints the average and longest time rendering a block took.
+ * Must not be called while blocks are being rendered.
+ */
+void modulation_print_stats(void);
+
+
+/**
+ * Frees the buffers of the modulation.
+ */
+void modulation_cleanup(void);
+
+#endif
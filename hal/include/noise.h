@@ -0,0 +1,66 @@
+/*
+ * This module is used to generate random numbers and white noise for the
+ * audio. Generators are xorshift32 in a few independent lanes, so filling
+ * a block steps every lane at once and the loop can be vectorized. Each
+ * thread has a generator of its own, so drawing from it never takes a
+ * lock, unlike rand().
+ */
+
+#ifndef _NOISE_H_
+#define _NOISE_H_
+
+#include <stdint.h>
+
+#define NOISE_LANES 4 // Independent generators stepped together when filling a block
+
+// Struct representing a generator, the state of each lane is never 0
+struct NoiseGenerator {
+    uint32_t lanes[NOISE_LANES];
+};
+
+
+/**
+ * Seeds a generator. Generators given the same seed give the same numbers.
+ *
+ * @param generator The generator to seed.
+ * @param seed Any value, including 0.
+ */
+void noise_seed(struct NoiseGenerator *generator, uint64_t seed);
+
+
+/**
+ * Gets the generator of the calling thread, seeding it on first use.
+ *
+ * @return The generator, only to be used by the calling thread.
+ */
+struct NoiseGenerator *noise_thread_generator(void);
+
+
+/**
+ * Gets the next random number of a generator.
+ *
+ * @param generator The generator to draw from.
+ * @return A number from 1 to UINT32_MAX.
+ */
+uint32_t noise_next(struct NoiseGenerator *generator);
+
+
+/**
+ * Gets the next random number of a generator as a sample.
+ *
+ * @param generator The generator to draw from.
+ * @return A number from -1 to 1.
+ */
+double noise_next_bipolar(struct NoiseGenerator *generator);
+
+
+/**
+ * Fills a block with white noise.
+ *
+ * @param generator The generator to draw from.
+ * @param samples Where the noise is stored, from -1 to 1.
+ * @param size The number of samples in the block.
+ */
+void noise_fill(struct NoiseGenerator *generator, double *samples, int size);
+
+#endif
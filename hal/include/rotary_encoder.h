@@ -1,14 +1,14 @@
 /*
  * This module is used to interface with a Rotary Encoder.
- * It allows the creation of a pthread which actively reads
- * and adjusts the value of the Rotary Encoder based on CW
- * and CCW turns to increment and decrement.
+ * It registers the encoder lines with the event loop, which
+ * adjusts the value of the Rotary Encoder based on CW
+ * and CCW turns to increment and decrement. Fast turns can
+ * optionally move the value by more than one per detent.
  */
 
 #ifndef _ROTARY_ENCODER_H_
 #define _ROTARY_ENCODER_H_
 
-#include <pthread.h>
 #include <stdbool.h>
 
 // Struct representing the Rotary Encoder device
@@ -16,20 +16,6 @@ typedef struct {
     bool is_initialized; // Flag indicating if the Rotary Encoder is initialized
 } RotaryEncoder;
 
-// Struct representing a state event for the state machine
-struct stateEvent {
-    struct state *next_state;  // Pointer to the next state
-    void (*action)();          // Action to be performed during the event
-};
-
-// Struct representing a state in the state machine
-struct state {
-    struct stateEvent risingA;
-    struct stateEvent fallingA;
-    struct stateEvent risingB;
-    struct stateEvent fallingB;
-};
-
 
 /**
  * Initializes the Rotary Encoder.
@@ -40,11 +26,11 @@ void rotary_encoder_init(RotaryEncoder *rotary_encoder);
 
 
 /**
- * Starts the thread that handles the Rotary Encoder state changes.
+ * Starts handling the Rotary Encoder state changes from the event loop.
  * 
  * @param rotary_encoder A pointer to the RotaryEncoder struct.
  */
-void rotary_encoder_start_thread(RotaryEncoder *rotary_encoder);
+void rotary_encoder_start_events(RotaryEncoder *rotary_encoder);
 
 
 /**
@@ -65,11 +51,20 @@ int rotary_encoder_get_value(RotaryEncoder *rotary_encoder);
 
 
 /**
- * Stops the thread that handles the Rotary Encoder state changes.
+ * Enables or disables acceleration, where detents turned in quick
+ * succession move the value by 2 or 4 instead of 1.
+ * 
+ * @param enabled True to accelerate fast turns, false for one per detent.
+ */
+void rotary_encoder_set_acceleration(bool enabled);
+
+
+/**
+ * Stops handling the Rotary Encoder state changes from the event loop.
  * 
  * @param rotary_encoder A pointer to the RotaryEncoder struct.
  */
-void rotary_encoder_stop_thread(RotaryEncoder *rotary_encoder);
+void rotary_encoder_stop_events(RotaryEncoder *rotary_encoder);
 
 
 /**
@@ -2,7 +2,9 @@
  * This module is used to interface with a Sine Mixer. It constantly plays
  * a sine wave at a given frequency and allows the user to change the
  * frequency, waveform, and volume of the sound. It also allows for
- * distortion of the frequency to simulate different sound effects.
+ * vibrato of the frequency, set as its distortion.
+ * Several voices can play at once, each at its own frequency, and each
+ * note fades in and out with an envelope.
  */
 
 #ifndef _SINE_MIXER_H
@@ -10,6 +12,7 @@
 
 #define SINEMIXER_VOLUME_MAX 100
 #define SINEMIXER_VOLUME_MIN 0
+#define SINEMIXER_MAX_VOICES 4 // Voices that can play at once, one per tracked hand
 
 // Different waveforms that can be played
 enum SineMixerWaveform
@@ -21,6 +24,7 @@ enum SineMixerWaveform
     SINEMIXER_WAVE_STAIRS,
     SINEMIXER_WAVE_RECTIFIED_SINE,
     SINEMIXER_WAVE_DECAYING_SINE,
+    SINEMIXER_WAVE_NOISE,
     SINEMIXER_WAVE_COUNT
 };
 
@@ -31,20 +35,49 @@ enum SineMixerWaveform
 void sine_mixer_init(void);
 
 /**
- * Queues the continous playback of the given frequency.
+ * Queues the continous playback of the given frequency on the first voice.
  * Replaces the currently playing frequency if there is one.
  * @param frequency the frequency of the sine wave to be played
  */
 void sine_mixer_queue_frequency(double frequency);
 
 /**
- * Gets the currently playing frequency.
+ * Queues the continous playback of the given frequency on one voice.
+ * Glides the held note to it if there is one, otherwise starts a note.
+ * @param voice the voice to play on, from 0 to SINEMIXER_MAX_VOICES - 1.
+ * @param frequency the frequency of the wave to be played
+ */
+void sine_mixer_queue_voice_frequency(int voice, double frequency);
+
+/**
+ * Starts a new note on one voice, attacking again from the voice's level.
+ * @param voice the voice to play on, from 0 to SINEMIXER_MAX_VOICES - 1.
+ * @param frequency the frequency of the note.
+ */
+void sine_mixer_note_on(int voice, double frequency);
+
+/**
+ * Releases the note of one voice, which fades out over its release.
+ * @param voice the voice to stop.
+ */
+void sine_mixer_stop_voice(int voice);
+
+/**
+ * Gets the frequency playing on the first voice.
  * @return the currently playing frequency.
  */
 double sine_mixer_get_frequency(void);
 
+/**
+ * Gets how long queued frequencies waited before the playback thread
+ * started rendering the next buffer towards them.
+ * @param avg_us where the average wait in microseconds is stored.
+ * @param max_us where the longest wait in microseconds is stored.
+ */
+void sine_mixer_get_pickup_latency(long long *avg_us, long long *max_us);
+
 /*
- * Stops the playback of the current frequency, if there is one.
+ * Stops the playback of every voice.
  */
 void sine_mixer_stop_playback(void);
 
@@ -61,10 +94,10 @@ void sine_mixer_set_waveform(enum SineMixerWaveform waveform);
 enum SineMixerWaveform sine_mixer_get_waveform(void);
 
 /**
- * Adds a random amount of offset to the playing frequency.
- * the amount of offset is relative to the given frequency
- * @param distortion the % amount of distortion to add to a given note.
- * for example, 0.01 adds 1% distortion
+ * Sets the depth of the vibrato, routing the first LFO of the modulation
+ * to the pitch. The depth is relative to the playing frequency.
+ * @param distortion the % amount of vibrato to add to a given note.
+ * for example, 0.01 swings the note 1% either way
  */
 void sine_mixer_set_distortion(double distortion);
 
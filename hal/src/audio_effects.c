@@ -0,0 +1,399 @@
+/*
+ * This file implements the audio effects module. Each effect runs over the
+ * whole block before the next one starts, reading its parameters once per
+ * block. The delay lines are ring buffers with a power-of-two length, so
+ * reading and writing them only needs a mask. The reverb is a small
+ * Schroeder design in the style of Freeverb: four damped combs in parallel
+ * followed by two allpasses.
+ */
+
+#include "audio_effects.h"
+#include "modulation.h"
+#include "utils.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdio.h>
+#include <math.h>
+
+#define PI 3.1415926535897932
+
+#define DRIVE_MAX_GAIN 10.0          // Waveshaper input gain at full drive
+#define FILTER_MIN_HZ 80.0           // Cutoff at the bottom of the dial
+#define FILTER_MAX_HZ 18000.0        // Cutoff at the top of the dial
+#define FILTER_LOWEST_HZ 20.0        // Lowest cutoff the modulation can reach
+#define FILTER_MAX_Q_DAMPING 1.8     // Damping removed at full resonance
+#define CHORUS_RATE_HZ 0.7           // Speed of the chorus sweep
+#define CHORUS_BASE_MS 15.0          // Delay the chorus sweeps around
+#define CHORUS_DEPTH_MS 8.0          // Sweep either side of the base delay at full depth
+#define DELAY_MIN_MS 50.0            // Echo time at the bottom of the dial
+#define DELAY_MAX_MS 1000.0          // Echo time at the top of the dial
+#define DELAY_FEEDBACK 0.4           // Level of each echo relative to the last
+#define DELAY_GLIDE 0.0005           // Share of the way to a new echo time moved per sample
+#define REVERB_NUM_COMBS 4
+#define REVERB_NUM_ALLPASSES 2
+#define REVERB_COMB_FEEDBACK 0.84    // Length of the reverb tail
+#define REVERB_COMB_DAMPING 0.2      // High frequencies lost on each pass
+#define REVERB_ALLPASS_FEEDBACK 0.5
+#define REVERB_INPUT_GAIN 0.15       // Keeps the sum of the combs within range
+#define ANTI_DENORMAL 1e-18          // Inaudible offset that keeps decaying tails out of denormals
+
+// Reverb delays in samples at 44.1 kHz, from Freeverb
+static const int comb_lengths[REVERB_NUM_COMBS] = {1116, 1188, 1277, 1356};
+static const int allpass_lengths[REVERB_NUM_ALLPASSES] = {556, 441};
+
+// Effects in the order they run
+enum Stage {
+    STAGE_DRIVE,
+    STAGE_FILTER,
+    STAGE_CHORUS,
+    STAGE_DELAY,
+    STAGE_REVERB,
+    NUM_STAGES
+};
+static const char *stage_names[NUM_STAGES] = {"drive", "filter", "chorus", "delay", "reverb"};
+
+// Parameters, written by the controls and read by the playback thread
+static atomic_int params[AUDIO_EFFECT_PARAM_COUNT];
+static const int default_params[AUDIO_EFFECT_PARAM_COUNT] = {0, 100, 0, 0, 0, 30, 0};
+static const char *param_names[AUDIO_EFFECT_PARAM_COUNT] = {
+    "Drive", "Cutoff", "Resonance", "Chorus", "Delay Mix", "Delay Time", "Reverb",
+};
+
+// Struct representing a delay line
+struct DelayLine {
+    double *buffer;
+    int mask;  // Length of the buffer minus one, the length being a power of two
+    int write; // Position the next sample is written to
+};
+
+// Struct representing a comb filter of the reverb
+struct Comb {
+    struct DelayLine line;
+    int length;
+    double filter_store;
+};
+
+// Struct representing an allpass filter of the reverb
+struct Allpass {
+    struct DelayLine line;
+    int length;
+};
+
+// State of each effect, only used by the playback thread
+static int rate = 0;
+static double filter_ic1 = 0;
+static double filter_ic2 = 0;
+static double filter_g = 0;
+static const double *block_cutoff_ratios = NULL;
+static struct DelayLine chorus_line;
+static double chorus_cos = 1;
+static double chorus_sin = 0;
+static struct DelayLine delay_line;
+static double delay_samples = 0;
+static struct Comb combs[REVERB_NUM_COMBS];
+static struct Allpass allpasses[REVERB_NUM_ALLPASSES];
+
+// Time each effect took per block
+static long long stage_total_ns[NUM_STAGES];
+static long long stage_max_ns[NUM_STAGES];
+static long long blocks_processed = 0;
+static int last_block_size = 0;
+
+// Module initialization status
+static bool is_initialized = false;
+
+// Helper function prototypes
+static void delay_line_init(struct DelayLine *line, int min_length);
+static double delay_line_read(const struct DelayLine *line, double delay);
+static void delay_line_write(struct DelayLine *line, double sample);
+static void process_drive(double *samples, int size);
+static void process_filter(double *samples, int size);
+static void process_chorus(double *samples, int size);
+static void process_delay(double *samples, int size);
+static void process_reverb(double *samples, int size);
+static double param_fraction(AudioEffectParam param);
+static double filter_base_cutoff(void);
+
+void audio_effects_init(int sample_rate)
+{
+    assert(!is_initialized);
+    rate = sample_rate;
+
+    for (int i = 0; i < AUDIO_EFFECT_PARAM_COUNT; i++) {
+        atomic_store(&params[i], default_params[i]);
+    }
+    for (int i = 0; i < NUM_STAGES; i++) {
+        stage_total_ns[i] = 0;
+        stage_max_ns[i] = 0;
+    }
+    blocks_processed = 0;
+
+    // Room for the chorus sweep, and for the longest echo
+    delay_line_init(&chorus_line, (int)((CHORUS_BASE_MS + CHORUS_DEPTH_MS) * rate / 1000) + 2);
+    delay_line_init(&delay_line, (int)(DELAY_MAX_MS * rate / 1000) + 2);
+    delay_samples = (DELAY_MIN_MS + (DELAY_MAX_MS - DELAY_MIN_MS) * param_fraction(AUDIO_EFFECT_DELAY_TIME))
+                    * rate / 1000;
+    filter_g = tan(PI * filter_base_cutoff() / rate);
+
+    for (int i = 0; i < REVERB_NUM_COMBS; i++) {
+        combs[i].length = comb_lengths[i] * rate / 44100;
+        combs[i].filter_store = 0;
+        delay_line_init(&combs[i].line, combs[i].length + 1);
+    }
+    for (int i = 0; i < REVERB_NUM_ALLPASSES; i++) {
+        allpasses[i].length = allpass_lengths[i] * rate / 44100;
+        delay_line_init(&allpasses[i].line, allpasses[i].length + 1);
+    }
+    is_initialized = true;
+}
+
+void audio_effects_set_param(AudioEffectParam param, int value)
+{
+    assert(param >= 0 && param < AUDIO_EFFECT_PARAM_COUNT);
+    if (value < 0) {
+        value = 0;
+    }
+    else if (value > AUDIO_EFFECTS_PARAM_MAX) {
+        value = AUDIO_EFFECTS_PARAM_MAX;
+    }
+    atomic_store(&params[param], value);
+}
+
+int audio_effects_get_param(AudioEffectParam param)
+{
+    assert(param >= 0 && param < AUDIO_EFFECT_PARAM_COUNT);
+    return atomic_load(&params[param]);
+}
+
+const char *audio_effects_get_param_name(AudioEffectParam param)
+{
+    assert(param >= 0 && param < AUDIO_EFFECT_PARAM_COUNT);
+    return param_names[param];
+}
+
+void audio_effects_process(double *samples, const double *cutoff_ratios, int size)
+{
+    assert(is_initialized);
+    static void (*const stages[NUM_STAGES])(double *, int) = {
+        process_drive, process_filter, process_chorus, process_delay, process_reverb,
+    };
+
+    // Silence would otherwise decay into denormal numbers in the filter and
+    // feedback paths, which are far slower to compute on some processors
+    for (int i = 0; i < size; i++) {
+        samples[i] += ANTI_DENORMAL;
+    }
+    block_cutoff_ratios = cutoff_ratios;
+
+    // Every effect runs on every block, so the cost of a block does not depend on the settings
+    for (int i = 0; i < NUM_STAGES; i++) {
+        long long start_ns = get_monotonic_time_in_ns();
+        stages[i](samples, size);
+        long long elapsed_ns = get_monotonic_time_in_ns() - start_ns;
+
+        stage_total_ns[i] += elapsed_ns;
+        if (elapsed_ns > stage_max_ns[i]) {
+            stage_max_ns[i] = elapsed_ns;
+        }
+    }
+    blocks_processed++;
+    last_block_size = size;
+}
+
+void audio_effects_print_stats(void)
+{
+    if (blocks_processed == 0) {
+        return;
+    }
+    printf("\nEffects over %lld blocks of %d samples:", blocks_processed, last_block_size);
+    for (int i = 0; i < NUM_STAGES; i++) {
+        printf(" %s avg %.1f us (max %.1f us)%s", stage_names[i],
+               (double)stage_total_ns[i] / blocks_processed / 1000, stage_max_ns[i] / 1000.0,
+               i < NUM_STAGES - 1 ? "," : "\n");
+    }
+}
+
+void audio_effects_cleanup(void)
+{
+    assert(is_initialized);
+    free(chorus_line.buffer);
+    free(delay_line.buffer);
+    for (int i = 0; i < REVERB_NUM_COMBS; i++) {
+        free(combs[i].line.buffer);
+    }
+    for (int i = 0; i < REVERB_NUM_ALLPASSES; i++) {
+        free(allpasses[i].line.buffer);
+    }
+    is_initialized = false;
+}
+
+// Allocates a delay line of at least the given length, rounded up to a power of two
+static void delay_line_init(struct DelayLine *line, int min_length)
+{
+    int length = 1;
+    while (length < min_length) {
+        length <<= 1;
+    }
+    line->buffer = calloc(length, sizeof(*line->buffer));
+    if (line->buffer == NULL) {
+        perror("Unable to allocate delay line");
+        exit(EXIT_FAILURE);
+    }
+    line->mask = length - 1;
+    line->write = 0;
+}
+
+// Reads the sample written a number of samples ago, interpolating between samples
+static double delay_line_read(const struct DelayLine *line, double delay)
+{
+    int whole = (int)delay;
+    double fraction = delay - whole;
+    double newer = line->buffer[(line->write - whole) & line->mask];
+    double older = line->buffer[(line->write - whole - 1) & line->mask];
+    return newer + (older - newer) * fraction;
+}
+
+// Writes the next sample of a delay line
+static void delay_line_write(struct DelayLine *line, double sample)
+{
+    line->buffer[line->write] = sample;
+    line->write = (line->write + 1) & line->mask;
+}
+
+// Soft clipping, blended in with the drive so no drive leaves the signal untouched
+static void process_drive(double *samples, int size)
+{
+    double amount = param_fraction(AUDIO_EFFECT_DRIVE);
+    double gain = 1.0 + (DRIVE_MAX_GAIN - 1.0) * amount;
+
+    // Rational approximation of tanh, normalized so a full-scale input stays full scale
+    double norm_x = gain < 3.0 ? gain : 3.0;
+    double norm = norm_x * (27.0 + norm_x * norm_x) / (27.0 + 9.0 * norm_x * norm_x);
+
+    for (int i = 0; i < size; i++) {
+        double x = samples[i] * gain;
+        if (x > 3.0) {
+            x = 3.0;
+        }
+        else if (x < -3.0) {
+            x = -3.0;
+        }
+        double shaped = x * (27.0 + x * x) / (27.0 + 9.0 * x * x) / norm;
+        samples[i] += (shaped - samples[i]) * amount;
+    }
+}
+
+// Low-pass state-variable filter, in the trapezoidal form that stays stable at any cutoff.
+// The modulated cutoff is converted once per control period and ramped in between.
+static void process_filter(double *samples, int size)
+{
+    double base_cutoff = filter_base_cutoff();
+    double k = 2.0 - FILTER_MAX_Q_DAMPING * param_fraction(AUDIO_EFFECT_FILTER_RESONANCE);
+
+    for (int start = 0; start < size; start += MODULATION_CONTROL_PERIOD) {
+        int count = size - start < MODULATION_CONTROL_PERIOD ? size - start : MODULATION_CONTROL_PERIOD;
+        double cutoff = fmin(fmax(base_cutoff * block_cutoff_ratios[start + count - 1], FILTER_LOWEST_HZ),
+                             0.45 * rate);
+        double target_g = tan(PI * cutoff / rate);
+        double step = (target_g - filter_g) / count;
+
+        for (int i = start; i < start + count; i++) {
+            filter_g += step;
+            double a1 = 1.0 / (1.0 + filter_g * (filter_g + k));
+            double a2 = filter_g * a1;
+            double a3 = filter_g * a2;
+
+            double v3 = samples[i] - filter_ic2;
+            double v1 = a1 * filter_ic1 + a2 * v3;
+            double v2 = filter_ic2 + a2 * filter_ic1 + a3 * v3;
+            filter_ic1 = 2.0 * v1 - filter_ic1;
+            filter_ic2 = 2.0 * v2 - filter_ic2;
+            samples[i] = v2;
+        }
+        filter_g = target_g;
+    }
+}
+
+// Chorus, mixing in a copy delayed by a slowly swept amount
+static void process_chorus(double *samples, int size)
+{
+    double amount = param_fraction(AUDIO_EFFECT_CHORUS);
+    double base = CHORUS_BASE_MS * rate / 1000;
+    double depth = CHORUS_DEPTH_MS * rate / 1000 * amount;
+    double mix = 0.5 * amount;
+
+    // The sweep is a rotating phasor, renormalized each block so it does not drift
+    double step = 2.0 * PI * CHORUS_RATE_HZ / rate;
+    double step_cos = cos(step);
+    double step_sin = sin(step);
+    double length = sqrt(chorus_cos * chorus_cos + chorus_sin * chorus_sin);
+    chorus_cos /= length;
+    chorus_sin /= length;
+
+    for (int i = 0; i < size; i++) {
+        double delayed = delay_line_read(&chorus_line, base + depth * chorus_sin);
+        delay_line_write(&chorus_line, samples[i]);
+        samples[i] += (delayed - samples[i]) * mix;
+
+        double next_cos = chorus_cos * step_cos - chorus_sin * step_sin;
+        chorus_sin = chorus_sin * step_cos + chorus_cos * step_sin;
+        chorus_cos = next_cos;
+    }
+}
+
+// Echoes fed back into the delay line, gliding to a new time instead of jumping
+static void process_delay(double *samples, int size)
+{
+    double mix = param_fraction(AUDIO_EFFECT_DELAY_MIX);
+    double target = (DELAY_MIN_MS + (DELAY_MAX_MS - DELAY_MIN_MS) * param_fraction(AUDIO_EFFECT_DELAY_TIME))
+                    * rate / 1000;
+
+    for (int i = 0; i < size; i++) {
+        delay_samples += (target - delay_samples) * DELAY_GLIDE;
+        double echo = delay_line_read(&delay_line, delay_samples);
+        delay_line_write(&delay_line, samples[i] + echo * DELAY_FEEDBACK);
+        samples[i] += echo * mix;
+    }
+}
+
+// Reverb, from damped combs in parallel followed by allpasses in series
+static void process_reverb(double *samples, int size)
+{
+    double mix = 0.6 * param_fraction(AUDIO_EFFECT_REVERB);
+
+    for (int i = 0; i < size; i++) {
+        double input = samples[i] * REVERB_INPUT_GAIN;
+        double wet = 0;
+
+        for (int c = 0; c < REVERB_NUM_COMBS; c++) {
+            struct Comb *comb = &combs[c];
+            double out = comb->line.buffer[(comb->line.write - comb->length) & comb->line.mask];
+            comb->filter_store = out * (1.0 - REVERB_COMB_DAMPING) + comb->filter_store * REVERB_COMB_DAMPING;
+            delay_line_write(&comb->line, input + comb->filter_store * REVERB_COMB_FEEDBACK);
+            wet += out;
+        }
+
+        for (int a = 0; a < REVERB_NUM_ALLPASSES; a++) {
+            struct Allpass *allpass = &allpasses[a];
+            double out = allpass->line.buffer[(allpass->line.write - allpass->length) & allpass->line.mask];
+            delay_line_write(&allpass->line, wet + out * REVERB_ALLPASS_FEEDBACK);
+            wet = out - wet;
+        }
+
+        samples[i] += wet * mix;
+    }
+}
+
+// Function to get a parameter as a fraction of its range
+static double param_fraction(AudioEffectParam param)
+{
+    return atomic_load_explicit(&params[param], memory_order_relaxed) / (double)AUDIO_EFFECTS_PARAM_MAX;
+}
+
+// Function to get the filter cutoff set on the dial, before modulation
+static double filter_base_cutoff(void)
+{
+    return FILTER_MIN_HZ * pow(FILTER_MAX_HZ / FILTER_MIN_HZ, param_fraction(AUDIO_EFFECT_FILTER_CUTOFF));
+}
@@ -0,0 +1,252 @@
+/*
+ * This file implements the board backend for the HAL, reaching the joystick
+ * ADC over i2c-dev, the GPIO lines and distance sensor through libgpiod, and
+ * the LCD panel through the Waveshare library on top of lgpio.
+ */
+
+#include "hal_backend.h"
+#include "DEV_Config.h"
+#include "LCD_1in54.h"
+#include "GUI_Paint.h"
+#include "utils.h"
+#include "gpio.h"
+#include "i2c.h"
+#include <stdlib.h>
+#include <unistd.h>
+#include <gpiod.h>
+#include <stdio.h>
+#include <time.h>
+
+#define I2CDRV_LINUX_BUS "/dev/i2c-1"   // The I2C bus to communicate with the joystick.
+#define I2C_DEVICE_ADDRESS 0x48         // The I2C address of the joystick device.
+
+#define REG_CONFIGURATION 0x01          // Register address for configuration.
+#define REG_DATA 0x00                   // Register address for data.
+
+// Configuration values, sent low byte first: continuous conversion at 1600 SPS
+#define TLA2024_CHANNEL_CONF_X 0x83D2   // Configuration value for X-axis reading.
+#define TLA2024_CHANNEL_CONF_Y 0x83C2   // Configuration value for Y-axis reading.
+#define TLA2024_SETTLE_US 2000          // Two conversion periods, so a switched channel has settled
+
+#define GPIOCHIP1 "/dev/gpiochip1" // GPIO chip identifier for the echo pin
+#define GPIOCHIP2 "/dev/gpiochip2" // GPIO chip identifier for the trigger pin
+#define TRIGGER_PIN 17             // GPIO line number for the trigger pin
+#define ECHO_PIN 38                // GPIO line number for the echo pin
+
+#define TIMEOUT_US 30000            // Timeout for echo in microseconds
+#define MAX_DISTANCE 400            // Maximum distance in cm
+
+// GPIO state values
+static const char HIGH = 1;
+static const char LOW = 0;
+
+// GPIO chip and line handles for the distance sensor
+static struct gpiod_chip *chip1, *chip2;
+static struct gpiod_line *trigger, *echo;
+
+// Joystick axis the ADC is converting, or -1 before the first read
+static int configured_axis = -1;
+static long long configured_time_us;
+
+static uint16_t channel_config(JoystickDirection dir)
+{
+    if (dir == JOYSTICK_X) {
+        return TLA2024_CHANNEL_CONF_X;
+    }
+    return TLA2024_CHANNEL_CONF_Y;
+}
+
+static int board_joystick_open(void)
+{
+    configured_axis = -1;
+    return init_i2c_bus(I2CDRV_LINUX_BUS, I2C_DEVICE_ADDRESS);
+}
+
+static uint16_t board_joystick_read_raw(int handle, JoystickDirection dir)
+{
+    I2CTransaction transaction;
+
+    // Switch the ADC to the axis if the previous read did not already
+    if (configured_axis != (int)dir) {
+        i2c_transaction_begin(&transaction, handle, I2C_DEVICE_ADDRESS);
+        i2c_transaction_write_reg16(&transaction, REG_CONFIGURATION, channel_config(dir));
+        i2c_transaction_execute(&transaction);
+        configured_axis = dir;
+        configured_time_us = get_time_in_us();
+    }
+
+    // Only wait for whatever settle time is left since the switch, which the
+    // joystick sampler never needs as it reads the axes a tick apart
+    long long settle_us = configured_time_us + TLA2024_SETTLE_US - get_time_in_us();
+    if (settle_us > 0) {
+        usleep(settle_us);
+    }
+
+    // The axes are sampled in turn, so read this conversion and switch to
+    // the other axis in one transfer, letting it settle until the next read
+    JoystickDirection next = (dir == JOYSTICK_X) ? JOYSTICK_Y : JOYSTICK_X;
+    uint16_t raw_read;
+    i2c_transaction_begin(&transaction, handle, I2C_DEVICE_ADDRESS);
+    i2c_transaction_read_reg16(&transaction, REG_DATA, &raw_read);
+    i2c_transaction_write_reg16(&transaction, REG_CONFIGURATION, channel_config(next));
+    i2c_transaction_execute(&transaction);
+    configured_axis = next;
+    configured_time_us = get_time_in_us();
+
+    // Convert the raw value from the joystick, obtained from tla2024_demo.c
+    uint16_t value = ((raw_read  & 0xFF) << 8) | ((raw_read  & 0xFF00) >> 8);
+    return value >> 4;
+}
+
+static void board_joystick_close(int handle)
+{
+    close(handle);
+}
+
+static void board_distance_open(void)
+{
+    chip1 = gpiod_chip_open(GPIOCHIP1);
+
+    if (!chip1) {
+        perror("Failed to open gpiochip1");
+        exit(EXIT_FAILURE);
+    }
+    
+    echo = gpiod_chip_get_line(chip1, ECHO_PIN);
+    if (!echo) {
+        perror("Failed to get Echo line");
+        exit(EXIT_FAILURE);
+    }
+    
+    if (gpiod_line_request_input(echo, "Echo") < 0) {
+        perror("Failed to request Echo pin");
+        exit(EXIT_FAILURE);
+    }
+    
+    chip2 = gpiod_chip_open(GPIOCHIP2);
+
+    if (!chip2) {
+        perror("Failed to open gpiochip2");
+        exit(EXIT_FAILURE);
+    }
+    
+    trigger = gpiod_chip_get_line(chip2, TRIGGER_PIN);
+    
+    if (!trigger) {
+        perror("Failed to get Trigger line");
+        exit(EXIT_FAILURE);
+    }
+    
+    if (gpiod_line_request_output(trigger, "Trigger", LOW) < 0) {
+        perror("Failed to request Trigger pin");
+        exit(EXIT_FAILURE);
+    }
+    
+    usleep(100000);
+}
+
+// Function to get distance in cm
+static int board_distance_measure_cm(void) 
+{
+    struct timespec start_time, end_time, current_time;
+    long long timeout_ns;
+    int distance_in_cm = 0;
+    
+    gpiod_line_set_value(trigger, HIGH);
+    usleep(10);
+    gpiod_line_set_value(trigger, LOW);
+    
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    timeout_ns = start_time.tv_sec * 1000000000LL + start_time.tv_nsec + (TIMEOUT_US * 1000);
+    
+    while (gpiod_line_get_value(echo) == LOW) {
+        clock_gettime(CLOCK_MONOTONIC, &current_time);
+
+        if ((current_time.tv_sec * 1000000000LL + current_time.tv_nsec) > timeout_ns) {
+            return -1;
+        }
+        usleep(5);
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    
+    timeout_ns = start_time.tv_sec * 1000000000LL + start_time.tv_nsec + (TIMEOUT_US * 1000);
+    
+    while (gpiod_line_get_value(echo) == HIGH) {
+        clock_gettime(CLOCK_MONOTONIC, &current_time);
+
+        if ((current_time.tv_sec * 1000000000LL + current_time.tv_nsec) > timeout_ns) {
+            return -1;
+        }
+        usleep(5);
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    
+    long long start_ns = start_time.tv_sec * 1000000000LL + start_time.tv_nsec;
+    long long end_ns = end_time.tv_sec * 1000000000LL + end_time.tv_nsec;
+    long long duration_ns = end_ns - start_ns;
+    long long duration_us = duration_ns / 1000;
+    
+    distance_in_cm = (int)(duration_us * 0.01715);
+    
+    if (distance_in_cm > MAX_DISTANCE || distance_in_cm < 0) {
+        return -1;
+    }
+    
+    return distance_in_cm;
+}
+
+static void board_distance_close(void)
+{
+    gpiod_line_release(echo);
+    gpiod_chip_close(chip1);
+    gpiod_line_release(trigger);
+    gpiod_chip_close(chip2);
+}
+
+static int board_display_init(void)
+{
+    if (DEV_ModuleInit() != 0){
+        DEV_ModuleExit();
+        return -1;
+    }
+
+    LCD_1IN54_Init(HORIZONTAL);
+    LCD_1IN54_Clear(BLACK);
+    LCD_SetBacklight(1023);
+    return 0;
+}
+
+static void board_display_show(uint16_t *image)
+{
+    LCD_1IN54_Display(image);
+}
+
+static void board_display_exit(void)
+{
+    DEV_ModuleExit();
+}
+
+const HalBackend hal_backend_board = {
+    .name = "board",
+
+    .joystick_open = board_joystick_open,
+    .joystick_read_raw = board_joystick_read_raw,
+    .joystick_close = board_joystick_close,
+
+    .gpio_initialize = gpio_initialize,
+    .gpio_open_for_events = gpio_open_for_events,
+    .gpio_get_event_fd = gpio_get_event_fd,
+    .gpio_read_event = gpio_read_event,
+    .gpio_close = gpio_close,
+    .gpio_cleanup = gpio_cleanup,
+
+    .distance_open = board_distance_open,
+    .distance_measure_cm = board_distance_measure_cm,
+    .distance_close = board_distance_close,
+
+    .display_init = board_display_init,
+    .display_show = board_display_show,
+    .display_exit = board_display_exit,
+};
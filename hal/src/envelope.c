@@ -0,0 +1,98 @@
+/*
+ * This file implements the envelope module. Each segment heads towards a
+ * target just past its end level, following level = base + level * coef,
+ * so the curve reaches the end level in the set time. The overshoot ratio
+ * sets how curved each segment is.
+ */
+
+#include "envelope.h"
+#include <math.h>
+
+#define ATTACK_RATIO 0.3          // Overshoot of the attack, a gentle curve
+#define DECAY_RELEASE_RATIO 0.001 // Overshoot of the decay and release, close to exponential
+
+// Helper function prototypes
+static double segment_coef(double ms, double ratio, int sample_rate);
+
+void envelope_init(struct Envelope *envelope, double attack_ms, double decay_ms, double sustain,
+                   double release_ms, int sample_rate)
+{
+    envelope->stage = ENVELOPE_IDLE;
+    envelope->level = 0;
+    envelope->sustain = sustain;
+
+    envelope->attack_coef = segment_coef(attack_ms, ATTACK_RATIO, sample_rate);
+    envelope->attack_base = (1.0 + ATTACK_RATIO) * (1.0 - envelope->attack_coef);
+    envelope->decay_coef = segment_coef(decay_ms, DECAY_RELEASE_RATIO, sample_rate);
+    envelope->decay_base = (sustain - DECAY_RELEASE_RATIO) * (1.0 - envelope->decay_coef);
+    envelope->release_coef = segment_coef(release_ms, DECAY_RELEASE_RATIO, sample_rate);
+    envelope->release_base = -DECAY_RELEASE_RATIO * (1.0 - envelope->release_coef);
+}
+
+void envelope_note_on(struct Envelope *envelope)
+{
+    envelope->stage = ENVELOPE_ATTACK;
+}
+
+void envelope_note_off(struct Envelope *envelope)
+{
+    if (envelope->stage != ENVELOPE_IDLE){
+        envelope->stage = ENVELOPE_RELEASE;
+    }
+}
+
+bool envelope_is_active(const struct Envelope *envelope)
+{
+    return envelope->stage != ENVELOPE_IDLE;
+}
+
+void envelope_render(struct Envelope *envelope, double *levels, int size)
+{
+    enum EnvelopeStage stage = envelope->stage;
+    double level = envelope->level;
+
+    for (int i = 0; i < size; i++){
+        switch (stage){
+            case ENVELOPE_ATTACK:
+                level = envelope->attack_base + level * envelope->attack_coef;
+                if (level >= 1.0){
+                    level = 1.0;
+                    stage = ENVELOPE_DECAY;
+                }
+                break;
+
+            case ENVELOPE_DECAY:
+                level = envelope->decay_base + level * envelope->decay_coef;
+                if (level <= envelope->sustain){
+                    level = envelope->sustain;
+                    stage = ENVELOPE_SUSTAIN;
+                }
+                break;
+
+            case ENVELOPE_RELEASE:
+                level = envelope->release_base + level * envelope->release_coef;
+                if (level <= 0.0){
+                    level = 0.0;
+                    stage = ENVELOPE_IDLE;
+                }
+                break;
+
+            default:
+                break;
+        }
+        levels[i] = level;
+    }
+
+    envelope->stage = stage;
+    envelope->level = level;
+}
+
+// Function to get the coefficient of a segment that overshoots its end by the ratio
+static double segment_coef(double ms, double ratio, int sample_rate)
+{
+    double samples = ms * sample_rate / 1000;
+    if (samples <= 0){
+        return 0;
+    }
+    return exp(-log((1.0 + ratio) / ratio) / samples);
+}
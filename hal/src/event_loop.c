@@ -0,0 +1,244 @@
+/*
+ * This file implements the event loop module, waiting on every registered
+ * descriptor with a single epoll instance and dispatching to their handlers.
+ * An eventfd is registered alongside them to wake the loop when it stops.
+ * Each epoll event carries the slot of its source and the generation the slot
+ * was at when registered, so an event for a source that has been removed
+ * since is dropped even if its slot has been reused.
+ */
+
+#include "event_loop.h"
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <assert.h>
+#include <stdint.h>
+#include <errno.h>
+#include <stdio.h>
+
+#define STOP_EVENT_KEY UINT64_MAX // Event key of the stop eventfd, never a source's
+
+// Struct representing a registered descriptor and its handler
+struct EventSource {
+    int fd;
+    uint32_t generation; // Counts registrations in this slot, to spot stale events
+    bool is_timer;
+    EventHandler handler;
+    void *context;
+};
+
+// Registered descriptors; a handler only runs while holding the sources mutex,
+// so removing a source waits for its handler to return
+static struct EventSource sources[EVENT_LOOP_MAX_SOURCES];
+static pthread_mutex_t sources_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Epoll instance and the eventfd used to stop the loop
+static int epoll_fd = -1;
+static int stop_fd = -1;
+
+// Thread control variables
+static pthread_t loop_thread;
+static volatile bool exit_thread = false;
+
+// Module initialization status
+static bool is_initialized = false;
+
+// Internal function prototypes
+static void *event_loop_thread(void *arg);
+static struct EventSource *find_source(int fd);
+static void add_source(int fd, bool is_timer, EventHandler handler, void *context);
+
+void event_loop_init(void)
+{
+    assert(!is_initialized);
+
+    for (int i = 0; i < EVENT_LOOP_MAX_SOURCES; i++) {
+        sources[i].fd = -1;
+    }
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1) {
+        perror("Unable to create epoll instance");
+        exit(EXIT_FAILURE);
+    }
+
+    stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (stop_fd == -1) {
+        perror("Unable to create event loop eventfd");
+        exit(EXIT_FAILURE);
+    }
+
+    // The stop eventfd is told apart from the sources by its key
+    struct epoll_event event = {.events = EPOLLIN, .data.u64 = STOP_EVENT_KEY};
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stop_fd, &event) == -1) {
+        perror("Unable to watch event loop eventfd");
+        exit(EXIT_FAILURE);
+    }
+
+    exit_thread = false;
+    is_initialized = true;
+
+    if (pthread_create(&loop_thread, NULL, event_loop_thread, NULL) != 0) {
+        perror("Error creating event loop thread");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void event_loop_add_fd(int fd, EventHandler handler, void *context)
+{
+    add_source(fd, false, handler, context);
+}
+
+void event_loop_remove_fd(int fd)
+{
+    assert(is_initialized);
+    assert(!pthread_equal(pthread_self(), loop_thread));
+
+    pthread_mutex_lock(&sources_mutex);
+    {
+        struct EventSource *source = find_source(fd);
+        if (source != NULL) {
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+            source->fd = -1;
+        }
+    }
+    pthread_mutex_unlock(&sources_mutex);
+}
+
+int event_loop_add_timer(int period_ms, EventHandler handler, void *context)
+{
+    assert(period_ms > 0);
+
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd == -1) {
+        perror("Unable to create timer");
+        exit(EXIT_FAILURE);
+    }
+
+    struct itimerspec period;
+    period.it_interval.tv_sec = period_ms / 1000;
+    period.it_interval.tv_nsec = (period_ms % 1000) * 1000000L;
+    period.it_value = period.it_interval;
+    if (timerfd_settime(timer_fd, 0, &period, NULL) == -1) {
+        perror("Unable to start timer");
+        exit(EXIT_FAILURE);
+    }
+
+    add_source(timer_fd, true, handler, context);
+    return timer_fd;
+}
+
+void event_loop_remove_timer(int timer_fd)
+{
+    event_loop_remove_fd(timer_fd);
+    close(timer_fd);
+}
+
+void event_loop_cleanup(void)
+{
+    assert(is_initialized);
+
+    // Wake the loop so it sees the exit flag right away
+    exit_thread = true;
+    uint64_t one = 1;
+    if (write(stop_fd, &one, sizeof(one)) != sizeof(one)) {
+        perror("Unable to stop event loop");
+    }
+    pthread_join(loop_thread, NULL);
+
+    close(stop_fd);
+    close(epoll_fd);
+    stop_fd = -1;
+    epoll_fd = -1;
+    is_initialized = false;
+}
+
+// Finds the source registered for a descriptor, or a free slot for -1
+static struct EventSource *find_source(int fd)
+{
+    for (int i = 0; i < EVENT_LOOP_MAX_SOURCES; i++) {
+        if (sources[i].fd == fd) {
+            return &sources[i];
+        }
+    }
+    return NULL;
+}
+
+// Registers a descriptor; timer expirations are read before the handler runs
+static void add_source(int fd, bool is_timer, EventHandler handler, void *context)
+{
+    assert(is_initialized);
+
+    pthread_mutex_lock(&sources_mutex);
+    {
+        struct EventSource *source = find_source(-1);
+        if (source == NULL) {
+            fprintf(stderr, "Event loop: too many descriptors registered\n");
+            exit(EXIT_FAILURE);
+        }
+        source->fd = fd;
+        source->generation++;
+        source->is_timer = is_timer;
+        source->handler = handler;
+        source->context = context;
+
+        // The key packs the generation above the slot index
+        uint64_t key = ((uint64_t)source->generation << 32) | (uint64_t)(source - sources);
+        struct epoll_event event = {.events = EPOLLIN, .data.u64 = key};
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+            perror("Unable to watch descriptor");
+            exit(EXIT_FAILURE);
+        }
+    }
+    pthread_mutex_unlock(&sources_mutex);
+}
+
+// Thread function that waits for readable descriptors and runs their handlers
+static void *event_loop_thread(void *arg)
+{
+    (void)arg;
+    struct epoll_event events[EVENT_LOOP_MAX_SOURCES + 1];
+
+    while (!exit_thread) {
+        int num_events = epoll_wait(epoll_fd, events, EVENT_LOOP_MAX_SOURCES + 1, -1);
+        if (num_events == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Event loop wait failed");
+            exit(EXIT_FAILURE);
+        }
+
+        for (int i = 0; i < num_events && !exit_thread; i++) {
+            uint64_t key = events[i].data.u64;
+            if (key == STOP_EVENT_KEY) {
+                continue;
+            }
+            struct EventSource *source = &sources[key & UINT32_MAX];
+            uint32_t generation = (uint32_t)(key >> 32);
+
+            pthread_mutex_lock(&sources_mutex);
+            {
+                // The source may have been removed since epoll reported it,
+                // and its slot given to another descriptor
+                if (source->fd != -1 && source->generation == generation) {
+                    if (source->is_timer) {
+                        uint64_t expirations;
+                        if (read(source->fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+                            source->handler(source->context);
+                        }
+                    }
+                    else {
+                        source->handler(source->context);
+                    }
+                }
+            }
+            pthread_mutex_unlock(&sources_mutex);
+        }
+    }
+    return NULL;
+}
@@ -15,9 +15,6 @@
 #include <gpiod.h>
 #include <time.h>
 
-// Timeout for event waiting in nanoseconds (100ms)
-#define TIMEOUT_LIMIT_NS 100000000
-
 // List of GPIO chip names
 static char *chip_names[] = {
     "gpiochip0",
@@ -60,67 +57,32 @@ struct GPIOLine *gpio_open_for_events(enum eGPIOChips chip, int pin_number)
         exit(EXIT_FAILURE);
     }
 
+    // Request edge events once, the event descriptor stays valid until released
+    if (gpiod_line_request_both_edges_events(line, "Event Waiting") == -1){
+        perror("Unable to request GPIO line events");
+        exit(EXIT_FAILURE);
+    }
+
     // Cast to internal GPIOLine struct to hide gpiod dependency
     return (struct GPIOLine *)line;
 }
 
-int gpio_wait_for_line_change_one(
-    struct GPIOLine *line1,
-    struct gpiod_line_bulk *bulkEvents, 
-    volatile bool *should_exit)
+int gpio_get_event_fd(struct GPIOLine *line)
 {
-    struct gpiod_line_bulk bulkWait;
-    gpiod_line_bulk_init(&bulkWait);
-    gpiod_line_bulk_add(&bulkWait, (struct gpiod_line *)line1);
-
-    gpiod_line_request_bulk_both_edges_events(&bulkWait, "Event Waiting");
-
-    // Set timeout for event waiting
-    struct timespec timeout;
-    timeout.tv_sec = 0;
-    timeout.tv_nsec = TIMEOUT_LIMIT_NS;
-
-    while (!(*should_exit)){
-        int result = gpiod_line_event_wait_bulk(&bulkWait, &timeout, bulkEvents);
-
-        if (result == -1){
-            return -1;
-        }
-        else if (result > 0){
-            return gpiod_line_bulk_num_lines(bulkEvents);  // Return number of events
-        }
-    }
-    return 0;  // No event or exit requested
+    return gpiod_line_event_get_fd((struct gpiod_line *)line);
 }
 
-int gpio_wait_for_line_change_two(struct GPIOLine *line1, struct GPIOLine *line2,
-                                  struct gpiod_line_bulk *bulk_events, 
-                                  volatile bool *should_exit)
+int gpio_read_event(struct GPIOLine *line, struct GPIOEvent *event)
 {
-    struct gpiod_line_bulk bulk_wait;
-    gpiod_line_bulk_init(&bulk_wait);
-    gpiod_line_bulk_add(&bulk_wait, (struct gpiod_line *)line1);
-    gpiod_line_bulk_add(&bulk_wait, (struct gpiod_line *)line2);
-
-    // Request both edges events for both lines
-    gpiod_line_request_bulk_both_edges_events(&bulk_wait, "Event Waiting");
+    struct gpiod_line *line_handle = (struct gpiod_line *)line;
 
-    // Set timeout for event waiting
-    struct timespec timeout;
-    timeout.tv_sec = 0;
-    timeout.tv_nsec = TIMEOUT_LIMIT_NS;
-
-    // Wait for events until exit signal
-    while (!(*should_exit)){
-        int result = gpiod_line_event_wait_bulk(&bulk_wait, &timeout, bulk_events);
-
-        if (result == -1){
-            return -1;
-        }
-        else if (result > 0){
-            return gpiod_line_bulk_num_lines(bulk_events);
-        }
+    struct gpiod_line_event line_event;
+    if (gpiod_line_event_read(line_handle, &line_event) == -1){
+        return -1;
     }
+    event->line_number = gpiod_line_offset(line_handle);
+    event->is_rising = line_event.event_type == GPIOD_LINE_EVENT_RISING_EDGE;
+    event->timestamp_ns = line_event.ts.tv_sec * 1000000000LL + line_event.ts.tv_nsec;
     return 0;
 }
 
@@ -0,0 +1,23 @@
+/*
+ * This file implements the HAL backend selection, holding the backend
+ * every driver uses to reach its device.
+ */
+
+#include "hal_backend.h"
+#include <assert.h>
+#include <stdio.h>
+
+// The backend used by the drivers, the board unless told otherwise
+static const HalBackend *current_backend = &hal_backend_board;
+
+void hal_backend_select(const HalBackend *backend)
+{
+    assert(backend != NULL);
+    current_backend = backend;
+    printf("HAL backend: %s\n", backend->name);
+}
+
+const HalBackend *hal_backend_get(void)
+{
+    return current_backend;
+}
@@ -61,4 +61,83 @@ uint16_t read_i2c_reg16(int i2c_file_desc, uint8_t reg_addr)
 	}
 	return value;
 }
- 
\ No newline at end of file
+ 
+void i2c_transaction_begin(I2CTransaction *transaction, int i2c_file_desc, uint16_t address)
+{
+	transaction->i2c_file_desc = i2c_file_desc;
+	transaction->address = address;
+	transaction->num_ops = 0;
+	transaction->num_msgs = 0;
+	transaction->num_reads = 0;
+}
+
+void i2c_transaction_write_reg16(I2CTransaction *transaction, uint8_t reg_addr, uint16_t value)
+{
+	assert(transaction->num_ops < I2C_TRANSACTION_MAX_OPS);
+
+	// Each access has its own buffer, so the bytes stay valid until the ioctl
+	uint8_t *buff = transaction->tx_buffers[transaction->num_ops++];
+	buff[0] = reg_addr;
+	buff[1] = (value & 0xFF);
+	buff[2] = (value & 0xFF00) >> 8;
+
+	struct i2c_msg *msg = &transaction->msgs[transaction->num_msgs++];
+	msg->addr = transaction->address;
+	msg->flags = 0;
+	msg->len = 3;
+	msg->buf = buff;
+}
+
+void i2c_transaction_read_reg16(I2CTransaction *transaction, uint8_t reg_addr, uint16_t *value)
+{
+	assert(transaction->num_ops < I2C_TRANSACTION_MAX_OPS);
+
+	int op = transaction->num_ops++;
+	transaction->tx_buffers[op][0] = reg_addr;
+
+	// Write the register address, then read it back after a repeated start
+	struct i2c_msg *msg = &transaction->msgs[transaction->num_msgs++];
+	msg->addr = transaction->address;
+	msg->flags = 0;
+	msg->len = 1;
+	msg->buf = transaction->tx_buffers[op];
+
+	msg = &transaction->msgs[transaction->num_msgs++];
+	msg->addr = transaction->address;
+	msg->flags = I2C_M_RD;
+	msg->len = 2;
+	msg->buf = transaction->rx_buffers[op];
+
+	transaction->read_ops[transaction->num_reads] = op;
+	transaction->read_results[transaction->num_reads++] = value;
+}
+
+void i2c_transaction_execute(I2CTransaction *transaction)
+{
+	if (transaction->num_msgs == 0) {
+		return;
+	}
+
+	struct i2c_rdwr_ioctl_data data = {
+		.msgs = transaction->msgs,
+		.nmsgs = transaction->num_msgs,
+	};
+
+	// Send every queued message with a single stop at the end
+	if (ioctl(transaction->i2c_file_desc, I2C_RDWR, &data) != transaction->num_msgs) {
+		perror("Unable to run i2c transaction");
+		exit(EXIT_FAILURE);
+	}
+
+	// Copy the bytes read out in the same order read_i2c_reg16() returns them
+	for (int i = 0; i < transaction->num_reads; i++) {
+		uint8_t *buff = transaction->rx_buffers[transaction->read_ops[i]];
+		uint16_t value;
+		memcpy(&value, buff, sizeof(value));
+		*transaction->read_results[i] = value;
+	}
+
+	transaction->num_ops = 0;
+	transaction->num_msgs = 0;
+	transaction->num_reads = 0;
+}
@@ -3,23 +3,16 @@
  */
 
 #include "joystick.h"
+#include "hal_backend.h"
+#include "event_loop.h"
 #include "utils.h"
-#include "i2c.h"
+#include <pthread.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <assert.h>
 #include <stdio.h>
 #include <fcntl.h>
 
-#define I2CDRV_LINUX_BUS "/dev/i2c-1"   // The I2C bus to communicate with the joystick.
-#define I2C_DEVICE_ADDRESS 0x48         // The I2C address of the joystick device.
-
-#define REG_CONFIGURATION 0x01          // Register address for configuration.
-#define REG_DATA 0x00                   // Register address for data.
-
-#define TLA2024_CHANNEL_CONF_X 0x83D2   // Configuration value for X-axis reading.
-#define TLA2024_CHANNEL_CONF_Y 0x83C2   // Configuration value for Y-axis reading.
-
 // // Joystick scaling values
 #define JOYSTICK_X_MIN 1
 #define JOYSTICK_X_MAX 1630
@@ -28,16 +21,39 @@
 #define JOYSTICK_SCALE_RANGE 200
 #define JOYSTICK_OFFSET 100
 
+// Direction thresholds, with hysteresis so a held direction does not chatter
+#define JOYSTICK_PRESS_THRESHOLD 65   // Axis value needed to enter a direction
+#define JOYSTICK_RELEASE_THRESHOLD 45 // Axis value below which a direction is left
+#define JOYSTICK_CROSS_LIMIT 40       // Largest value on the other axis when entering
+
 // Flag to track if joystick module has been initialized.
 static bool is_initialized = false;
 
+// Sampling timer and the direction it publishes
+static int sample_timer_fd = -1;
+static pthread_mutex_t position_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t position_changed = PTHREAD_COND_INITIALIZER;
+static JoystickPosition current_position = JOYSTICK_CENTER;
+static JoystickPosition sampled_position = JOYSTICK_CENTER;
+static volatile bool is_sampling = false;
+
+// Axis read on the next tick and the latest value of each, only used by the handler
+static JoystickDirection next_axis = JOYSTICK_X;
+static int sampled_x = 0;
+static int sampled_y = 0;
+static bool has_both_axes = false;
+
+// Helper function prototypes
+static void sample_position(void *arg);
+static JoystickPosition classify_position(int x, int y, JoystickPosition held);
+
 void joystick_init(Joystick *joystick) 
 {
     assert(joystick != NULL);
     assert(!joystick->is_initialized);
     assert(!is_initialized);
 
-    joystick->i2c_file_desc = init_i2c_bus(I2CDRV_LINUX_BUS, I2C_DEVICE_ADDRESS);
+    joystick->i2c_file_desc = hal_backend_get()->joystick_open();
     if (joystick->i2c_file_desc < 0) {
         perror("Failed to initialize I2C");
         exit(EXIT_FAILURE);
@@ -53,20 +69,7 @@ int joystick_read_input(Joystick *joystick, JoystickDirection dir)
     assert(dir == JOYSTICK_X || dir == JOYSTICK_Y);
     assert(is_initialized);
 
-    uint16_t config;
-    if (dir == JOYSTICK_X) {
-        config = TLA2024_CHANNEL_CONF_X;
-    } 
-    else {
-        config = TLA2024_CHANNEL_CONF_Y;
-    }
-    write_i2c_reg16(joystick->i2c_file_desc, REG_CONFIGURATION, config);
-    sleep_for_ms(5);
-
-    // Read the raw value from the joystick, obtained from tla2024_demo.c
-    uint16_t raw_read = read_i2c_reg16(joystick->i2c_file_desc, REG_DATA);
-    uint16_t value = ((raw_read  & 0xFF) << 8) | ((raw_read  & 0xFF00) >> 8);
-    value = value >> 4;
+    int value = hal_backend_get()->joystick_read_raw(joystick->i2c_file_desc, dir);
     
     // Scales value to [-100, 100] based on observed min and max values for usability.
     if (dir == JOYSTICK_X) {
@@ -79,13 +82,143 @@ int joystick_read_input(Joystick *joystick, JoystickDirection dir)
     }
 }
 
+void joystick_start_sampling(Joystick *joystick, int rate_hz)
+{
+    assert(joystick != NULL);
+    assert(joystick->is_initialized);
+    assert(rate_hz > 0);
+    assert(!is_sampling);
+
+    sampled_position = JOYSTICK_CENTER;
+    next_axis = JOYSTICK_X;
+    has_both_axes = false;
+    is_sampling = true;
+
+    // One axis per tick, so each is still read at the rate asked for
+    sample_timer_fd = event_loop_add_timer(1000 / (2 * rate_hz), sample_position, joystick);
+}
+
+JoystickPosition joystick_wait_for_position_change(Joystick *joystick, JoystickPosition position)
+{
+    assert(joystick != NULL);
+    assert(joystick->is_initialized);
+
+    pthread_mutex_lock(&position_mutex);
+    {
+        while (is_sampling && current_position == position) {
+            pthread_cond_wait(&position_changed, &position_mutex);
+        }
+        position = current_position;
+    }
+    pthread_mutex_unlock(&position_mutex);
+    return position;
+}
+
+void joystick_stop_sampling(Joystick *joystick)
+{
+    assert(joystick != NULL);
+    assert(joystick->is_initialized);
+    if (!is_sampling) {
+        return;
+    }
+
+    event_loop_remove_timer(sample_timer_fd);
+    sample_timer_fd = -1;
+
+    pthread_mutex_lock(&position_mutex);
+    {
+        is_sampling = false;
+        pthread_cond_broadcast(&position_changed);
+    }
+    pthread_mutex_unlock(&position_mutex);
+}
+
 void joystick_cleanup(Joystick *joystick) 
 {
     assert(joystick != NULL);
     assert(joystick->is_initialized);
     assert(is_initialized);
 
-    close(joystick->i2c_file_desc);
+    joystick_stop_sampling(joystick);
+    hal_backend_get()->joystick_close(joystick->i2c_file_desc);
     joystick->is_initialized = false;
     is_initialized = false;
-}
\ No newline at end of file
+}
+
+// Timer handler that samples one axis and publishes direction changes. Reading
+// an axis switches the ADC to the other one, which settles until the next tick,
+// so the handler never waits on the ADC in the event loop thread.
+static void sample_position(void *arg)
+{
+    Joystick *joystick = arg;
+
+    if (next_axis == JOYSTICK_X) {
+        sampled_x = joystick_read_input(joystick, JOYSTICK_X);
+        next_axis = JOYSTICK_Y;
+    }
+    else {
+        sampled_y = joystick_read_input(joystick, JOYSTICK_Y);
+        next_axis = JOYSTICK_X;
+        has_both_axes = true;
+    }
+    if (!has_both_axes) {
+        return;
+    }
+
+    JoystickPosition new_position = classify_position(sampled_x, sampled_y, sampled_position);
+    if (new_position != sampled_position) {
+        sampled_position = new_position;
+        pthread_mutex_lock(&position_mutex);
+        {
+            current_position = sampled_position;
+            pthread_cond_broadcast(&position_changed);
+        }
+        pthread_mutex_unlock(&position_mutex);
+    }
+}
+
+// Function to find the direction held, staying in the current one until its axis is released
+static JoystickPosition classify_position(int x, int y, JoystickPosition held)
+{
+    switch (held) {
+        case JOYSTICK_UP:
+            if (y >= JOYSTICK_RELEASE_THRESHOLD) {
+                return held;
+            }
+            break;
+        case JOYSTICK_DOWN:
+            if (y <= -JOYSTICK_RELEASE_THRESHOLD) {
+                return held;
+            }
+            break;
+        case JOYSTICK_RIGHT:
+            if (x >= JOYSTICK_RELEASE_THRESHOLD) {
+                return held;
+            }
+            break;
+        case JOYSTICK_LEFT:
+            if (x <= -JOYSTICK_RELEASE_THRESHOLD) {
+                return held;
+            }
+            break;
+        default:
+            break;
+    }
+
+    bool x_centered = x < JOYSTICK_CROSS_LIMIT && x > -JOYSTICK_CROSS_LIMIT;
+    bool y_centered = y < JOYSTICK_CROSS_LIMIT && y > -JOYSTICK_CROSS_LIMIT;
+
+    if (y < -JOYSTICK_PRESS_THRESHOLD && x_centered) {
+        return JOYSTICK_DOWN;
+    }
+    else if (y > JOYSTICK_PRESS_THRESHOLD && x_centered) {
+        return JOYSTICK_UP;
+    }
+    else if (x > JOYSTICK_PRESS_THRESHOLD && y_centered) {
+        return JOYSTICK_RIGHT;
+    }
+    else if (x < -JOYSTICK_PRESS_THRESHOLD && y_centered) {
+        return JOYSTICK_LEFT;
+    }
+    return JOYSTICK_CENTER;
+}
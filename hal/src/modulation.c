@@ -0,0 +1,220 @@
+/*
+ * This file implements the modulation module. Each control period the LFOs
+ * advance by the samples in it and the smoothed controls step towards
+ * their latest values, then the whole matrix is multiplied out and each
+ * destination ramps linearly from its last value to the new one over the
+ * samples of the period.
+ */
+
+#include "modulation.h"
+#include "noise.h"
+#include "utils.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdio.h>
+#include <math.h>
+
+#define PI 3.1415926535897932
+
+#define NUM_LFOS 3
+#define CONTROL_SMOOTHING_MS 20.0 // Time constant the controls are smoothed with
+#define GAIN_RANGE_DB 12.0        // Gain moved by a full source at the largest amount
+#define CUTOFF_RANGE_OCTAVES 4.0  // Cutoff moved by a full source at the largest amount
+
+// Rate of each LFO, in the order of the sources
+static const double lfo_rates_hz[NUM_LFOS] = {5.5, 0.5, 2.0};
+
+// Value of each destination with nothing routed to it
+static const double resting_values[MODULATION_DEST_COUNT] = {1.0, 1.0, 1.0, 0.0};
+
+// Routes and controls, written by the other threads and read by the playback thread
+static atomic_int routes[MODULATION_SOURCE_COUNT][MODULATION_DEST_COUNT];
+static _Atomic double control_values[MODULATION_SOURCE_COUNT];
+
+// State of the sources and destinations, only used by the playback thread
+static int rate = 0;
+static int max_size = 0;
+static double *buffers[MODULATION_DEST_COUNT];
+static double last_values[MODULATION_DEST_COUNT];
+static double lfo_phases[NUM_LFOS];
+static double random_from = 0;
+static double random_to = 0;
+static double smoothed_controls[MODULATION_SOURCE_COUNT];
+static double control_smoothing = 0;
+
+// Time rendering each block took
+static long long render_total_ns = 0;
+static long long render_max_ns = 0;
+static long long blocks_rendered = 0;
+
+// Module initialization status
+static bool is_initialized = false;
+
+// Helper function prototypes
+static void update_sources(double sources[], const double controls[], int count);
+static double next_random(void);
+
+void modulation_init(int sample_rate, int max_block_size)
+{
+    assert(!is_initialized);
+    rate = sample_rate;
+    max_size = max_block_size;
+
+    for (int i = 0; i < MODULATION_DEST_COUNT; i++) {
+        buffers[i] = malloc(max_block_size * sizeof(*buffers[i]));
+        if (buffers[i] == NULL) {
+            perror("Unable to allocate modulation buffer");
+            exit(EXIT_FAILURE);
+        }
+        last_values[i] = resting_values[i];
+    }
+
+    control_smoothing = 1.0 - exp(-MODULATION_CONTROL_PERIOD / (rate * CONTROL_SMOOTHING_MS / 1000));
+    random_to = next_random();
+    is_initialized = true;
+}
+
+void modulation_set_route(ModulationSource source, ModulationDestination destination, int amount)
+{
+    assert(source >= 0 && source < MODULATION_SOURCE_COUNT);
+    assert(destination >= 0 && destination < MODULATION_DEST_COUNT);
+    if (amount < -MODULATION_AMOUNT_MAX) {
+        amount = -MODULATION_AMOUNT_MAX;
+    }
+    else if (amount > MODULATION_AMOUNT_MAX) {
+        amount = MODULATION_AMOUNT_MAX;
+    }
+    atomic_store(&routes[source][destination], amount);
+}
+
+int modulation_get_route(ModulationSource source, ModulationDestination destination)
+{
+    assert(source >= 0 && source < MODULATION_SOURCE_COUNT);
+    assert(destination >= 0 && destination < MODULATION_DEST_COUNT);
+    return atomic_load(&routes[source][destination]);
+}
+
+void modulation_set_source(ModulationSource source, double value)
+{
+    assert(source >= MODULATION_SOURCE_DISTANCE && source < MODULATION_SOURCE_COUNT);
+    atomic_store_explicit(&control_values[source], value, memory_order_relaxed);
+}
+
+void modulation_render(int size)
+{
+    assert(is_initialized && size <= max_size);
+    long long start_ns = get_monotonic_time_in_ns();
+
+    // Routes and controls are read once per block
+    double amounts[MODULATION_SOURCE_COUNT][MODULATION_DEST_COUNT];
+    double controls[MODULATION_SOURCE_COUNT] = {0};
+    for (int s = 0; s < MODULATION_SOURCE_COUNT; s++) {
+        for (int d = 0; d < MODULATION_DEST_COUNT; d++) {
+            amounts[s][d] = atomic_load_explicit(&routes[s][d], memory_order_relaxed)
+                            / (double)MODULATION_AMOUNT_MAX;
+        }
+        if (s >= MODULATION_SOURCE_DISTANCE) {
+            controls[s] = atomic_load_explicit(&control_values[s], memory_order_relaxed);
+        }
+    }
+
+    for (int start = 0; start < size; start += MODULATION_CONTROL_PERIOD) {
+        int count = size - start < MODULATION_CONTROL_PERIOD ? size - start : MODULATION_CONTROL_PERIOD;
+        double sources[MODULATION_SOURCE_COUNT];
+        update_sources(sources, controls, count);
+
+        // Every route is summed, set or not, so the cost does not depend on the routing
+        double targets[MODULATION_DEST_COUNT];
+        for (int d = 0; d < MODULATION_DEST_COUNT; d++) {
+            double sum = 0;
+            for (int s = 0; s < MODULATION_SOURCE_COUNT; s++) {
+                sum += sources[s] * amounts[s][d];
+            }
+            targets[d] = sum;
+        }
+        targets[MODULATION_DEST_PITCH] = exp2(targets[MODULATION_DEST_PITCH] * MODULATION_PITCH_RANGE_SEMITONES / 12);
+        targets[MODULATION_DEST_GAIN] = pow(10.0, targets[MODULATION_DEST_GAIN] * GAIN_RANGE_DB / 20);
+        targets[MODULATION_DEST_FILTER_CUTOFF] = exp2(targets[MODULATION_DEST_FILTER_CUTOFF] * CUTOFF_RANGE_OCTAVES);
+        targets[MODULATION_DEST_WAVEFORM_MORPH] = fmin(fmax(targets[MODULATION_DEST_WAVEFORM_MORPH], 0.0), 1.0);
+
+        // Ramp each destination from its last value, so none of them steps
+        for (int d = 0; d < MODULATION_DEST_COUNT; d++) {
+            double value = last_values[d];
+            double step = (targets[d] - value) / count;
+            double *out = buffers[d] + start;
+            for (int i = 0; i < count; i++) {
+                value += step;
+                out[i] = value;
+            }
+            last_values[d] = targets[d];
+        }
+    }
+
+    long long elapsed_ns = get_monotonic_time_in_ns() - start_ns;
+    render_total_ns += elapsed_ns;
+    if (elapsed_ns > render_max_ns) {
+        render_max_ns = elapsed_ns;
+    }
+    blocks_rendered++;
+}
+
+const double *modulation_get_buffer(ModulationDestination destination)
+{
+    assert(destination >= 0 && destination < MODULATION_DEST_COUNT);
+    return buffers[destination];
+}
+
+void modulation_print_stats(void)
+{
+    if (blocks_rendered == 0) {
+        return;
+    }
+    printf("\nModulation over %lld blocks: avg %lld us (max %lld us)\n",
+           blocks_rendered, render_total_ns / blocks_rendered / 1000, render_max_ns / 1000);
+}
+
+void modulation_cleanup(void)
+{
+    assert(is_initialized);
+    for (int i = 0; i < MODULATION_DEST_COUNT; i++) {
+        free(buffers[i]);
+        buffers[i] = NULL;
+    }
+    is_initialized = false;
+}
+
+// Advances the sources by a control period and gets their values at its end
+static void update_sources(double sources[], const double controls[], int count)
+{
+    for (int i = 0; i < NUM_LFOS; i++) {
+        lfo_phases[i] += lfo_rates_hz[i] * count / rate;
+    }
+
+    // The random LFO moves on to a new value each cycle
+    if (lfo_phases[2] >= 1.0) {
+        random_from = random_to;
+        random_to = next_random();
+    }
+    for (int i = 0; i < NUM_LFOS; i++) {
+        lfo_phases[i] -= floor(lfo_phases[i]);
+    }
+
+    sources[MODULATION_SOURCE_LFO_1] = sin(2.0 * PI * lfo_phases[0]);
+    sources[MODULATION_SOURCE_LFO_2] = 1.0 - 4.0 * fabs(lfo_phases[1] - 0.5);
+    sources[MODULATION_SOURCE_LFO_3] = random_from + (random_to - random_from)
+                                       * (0.5 - 0.5 * cos(PI * lfo_phases[2]));
+    sources[MODULATION_SOURCE_NOISE] = next_random();
+
+    for (int s = MODULATION_SOURCE_DISTANCE; s < MODULATION_SOURCE_COUNT; s++) {
+        smoothed_controls[s] += (controls[s] - smoothed_controls[s]) * control_smoothing;
+        sources[s] = smoothed_controls[s];
+    }
+}
+
+// Function to get a random value from the playback thread's generator, from -1 to 1
+static double next_random(void)
+{
+    return noise_next_bipolar(noise_thread_generator());
+}
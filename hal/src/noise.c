@@ -0,0 +1,92 @@
+/*
+ * This file implements the noise module. The lanes are seeded from one
+ * value with splitmix64, which spreads even nearby seeds far apart, and
+ * each step of a lane is three shifts and xors.
+ */
+
+#include "noise.h"
+#include <stdbool.h>
+#include <time.h>
+
+// Generator of each thread, seeded the first time the thread asks for it
+static _Thread_local struct NoiseGenerator thread_generator;
+static _Thread_local bool is_thread_seeded = false;
+
+// Helper function prototypes
+static uint32_t xorshift32(uint32_t x);
+static uint64_t splitmix64(uint64_t *state);
+
+void noise_seed(struct NoiseGenerator *generator, uint64_t seed)
+{
+    for (int i = 0; i < NOISE_LANES; i++) {
+        uint32_t lane = (uint32_t)(splitmix64(&seed) >> 32);
+        generator->lanes[i] = lane != 0 ? lane : 1;
+    }
+}
+
+struct NoiseGenerator *noise_thread_generator(void)
+{
+    if (!is_thread_seeded) {
+        // Threads starting at the same moment still differ by where their generator is
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        noise_seed(&thread_generator, (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec
+                                      + (uint64_t)(uintptr_t)&thread_generator);
+        is_thread_seeded = true;
+    }
+    return &thread_generator;
+}
+
+uint32_t noise_next(struct NoiseGenerator *generator)
+{
+    generator->lanes[0] = xorshift32(generator->lanes[0]);
+    return generator->lanes[0];
+}
+
+double noise_next_bipolar(struct NoiseGenerator *generator)
+{
+    return noise_next(generator) * (2.0 / 4294967296.0) - 1.0;
+}
+
+void noise_fill(struct NoiseGenerator *generator, double *samples, int size)
+{
+    uint32_t lanes[NOISE_LANES];
+    for (int lane = 0; lane < NOISE_LANES; lane++) {
+        lanes[lane] = generator->lanes[lane];
+    }
+
+    // Each lane steps on its own, so the lanes of a group can be computed side by side
+    int i = 0;
+    for (; i + NOISE_LANES <= size; i += NOISE_LANES) {
+        for (int lane = 0; lane < NOISE_LANES; lane++) {
+            lanes[lane] = xorshift32(lanes[lane]);
+            samples[i + lane] = lanes[lane] * (2.0 / 4294967296.0) - 1.0;
+        }
+    }
+    for (int lane = 0; i < size; i++, lane++) {
+        lanes[lane] = xorshift32(lanes[lane]);
+        samples[i] = lanes[lane] * (2.0 / 4294967296.0) - 1.0;
+    }
+
+    for (int lane = 0; lane < NOISE_LANES; lane++) {
+        generator->lanes[lane] = lanes[lane];
+    }
+}
+
+// Steps a lane, from Marsaglia's xorshift generators
+static uint32_t xorshift32(uint32_t x)
+{
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+// Steps the seeding state and gets a well mixed value from it
+static uint64_t splitmix64(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
@@ -1,9 +1,11 @@
 /*
  * This file implements the rotary encoder button module, handling state
- * machine logic, GPIO event processing, and thread management for the button clicks.
+ * machine logic and GPIO event processing for the button clicks from the event loop.
  */
 
 #include "rotary_button.h"
+#include "hal_backend.h"
+#include "event_loop.h"
 #include "joystick.h"
 #include "utils.h"
 #include "gpio.h"
@@ -33,21 +35,14 @@ struct GPIOLine *rotary_button = NULL;
 // Counter to track rotary button value, set to loop between 1-3.
 static atomic_int rotary_button_counter = 0;
 
-// Thread control variables
-static bool rotary_thread_running = false;
-static pthread_t rotary_button_thread;
+// Counter lock, the counter is updated from the event loop thread
 static pthread_mutex_t rotary_counter_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-// Flag to signal thread termination
-static volatile bool exit_rotary_thread = false;
-
 // Module initialization status
 static bool rotary_initialized = false;
 
 // Internal function prototypes for the rotary button
-static void button_start_thread(RotaryButton *button);
-static void *rotary_thread(void *arg);
-static void rotary_button_do_state();
+static void rotary_button_do_state(void *line);
 static void increment_rotary_counter();
 
 // Struct representing a state event for the state machine
@@ -79,11 +74,12 @@ struct state *rotary_current_state = &rotary_states[0];
 
 void rotary_button_init(RotaryButton *button)
 {
+    hal_backend_get()->gpio_initialize();
     button->is_initialized = true;
-    rotary_button = gpio_open_for_events(GPIO_CHIP_ROTARY, GPIO_LINE_ROTARY);
+    rotary_button = hal_backend_get()->gpio_open_for_events(GPIO_CHIP_ROTARY, GPIO_LINE_ROTARY);
     rotary_initialized = true;
-    button_start_thread(button);
-    gpio_initialize();
+    event_loop_add_fd(hal_backend_get()->gpio_get_event_fd(rotary_button),
+                      rotary_button_do_state, rotary_button);
 }
 
 void set_rotary_button_value(int value)
@@ -110,32 +106,11 @@ int get_rotary_button_value(RotaryButton *button)
 void clean_rotary_button(RotaryButton *button)
 {
     assert(button->is_initialized);
-    gpio_close(rotary_button);
+    event_loop_remove_fd(hal_backend_get()->gpio_get_event_fd(rotary_button));
+    hal_backend_get()->gpio_close(rotary_button);
     pthread_mutex_destroy(&rotary_counter_mutex);
 
     rotary_initialized = false;
-    rotary_thread_running = false;
-    exit_rotary_thread = true;
-    pthread_join(rotary_button_thread, NULL);
-}
-
-static void *rotary_thread(void *arg)
-{
-    (void)arg;
-    while (rotary_thread_running){
-        rotary_button_do_state();
-    }
-    return NULL;
-}
-
-static void button_start_thread(RotaryButton *button)
-{
-    assert(button->is_initialized);
-    rotary_thread_running = true;
-    if (pthread_create(&rotary_button_thread, NULL, rotary_thread, NULL) != 0){
-        perror("Error creating thread");
-        exit(EXIT_FAILURE);
-    }
 }
 
 static void increment_rotary_counter()
@@ -161,40 +136,28 @@ static void increment_rotary_counter()
     last_press_time = current_time;
 }
 
-static void rotary_button_do_state()
+static void rotary_button_do_state(void *line)
 {
     assert(rotary_initialized);
 
-    struct gpiod_line_bulk bulk_events;
-    int num_events = gpio_wait_for_line_change_one(rotary_button, &bulk_events, &exit_rotary_thread);
-
-    // Exit thread if program ends from GPIO timeout
-    if (num_events == -1){
+    // Called by the event loop once the line has an event to read
+    struct GPIOEvent event;
+    if (hal_backend_get()->gpio_read_event(line, &event) == -1){
         return;
     }
 
-    for (int i = 0; i < num_events; i++){
-        struct gpiod_line *line_handle = gpiod_line_bulk_get_line(&bulk_events, i);
-
-        struct gpiod_line_event event;
-        if (gpiod_line_event_read(line_handle, &event) == -1){
-            perror("Line Event");
-            exit(EXIT_FAILURE);
-        }
+    bool isRising = event.is_rising;
 
-        bool isRising = event.event_type == GPIOD_LINE_EVENT_RISING_EDGE;
-
-        struct stateEvent *pStateEvent = NULL;
-        if (isRising){
-            pStateEvent = &rotary_current_state->rising;
-        }
-        else{
-            pStateEvent = &rotary_current_state->falling;
-        }
+    struct stateEvent *pStateEvent = NULL;
+    if (isRising){
+        pStateEvent = &rotary_current_state->rising;
+    }
+    else{
+        pStateEvent = &rotary_current_state->falling;
+    }
 
-        if (pStateEvent->action != NULL){
-            pStateEvent->action();
-        }
-        rotary_current_state = pStateEvent->pNextState;
+    if (pStateEvent->action != NULL){
+        pStateEvent->action();
     }
+    rotary_current_state = pStateEvent->pNextState;
 }
\ No newline at end of file
@@ -1,17 +1,19 @@
 /*
- * This file implements the rotary encoder module, handling state machine logic,
- * GPIO event processing, and thread management for a rotary encoder.
+ * This file implements the rotary encoder module, decoding the quadrature
+ * signal with a transition table and processing GPIO events for a rotary
+ * encoder from the event loop.
  */
 
 #include "rotary_encoder.h"
+#include "hal_backend.h"
+#include "event_loop.h"
 #include "utils.h"
 #include "gpio.h"
 #include <stdatomic.h>
-#include <pthread.h>
+#include <stdint.h>
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <time.h>
 
 // Pin configuration for the rotary encoder channels
 //   $ gpiofind GPIO24
@@ -20,137 +22,104 @@
 #define GPIO_LINE_NUMBER_A 7     // GPIO line number for encoder channel A
 #define GPIO_LINE_NUMBER_B 8     // GPIO line number for encoder channel B
 
+// Level of both channels as (A << 1) | B, resting between detents with both high
+#define REST_LEVELS 0x3
+
+// Acceleration applied when detents come faster than these intervals
+#define ACCEL_FAST_INTERVAL_NS 30000000LL // Detents this close count 4 steps
+#define ACCEL_FAST_STEP 4
+#define ACCEL_MEDIUM_INTERVAL_NS 80000000LL // Detents this close count 2 steps
+#define ACCEL_MEDIUM_STEP 2
+
 // Handles for GPIO lines A and B
 struct GPIOLine *line_a = NULL;
 struct GPIOLine *line_b = NULL;
 
-// Counter to track rotary encoder value, thread-safe due to atomic type
+// Counter to track rotary encoder value, updated without locks
 static atomic_int counter = 50;
 
-// Thread control variables
-static bool thread_running = false;
-static pthread_t state_machine_thread;
-static pthread_mutex_t counter_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Whether fast turns move the counter by more than one per detent
+static atomic_bool is_accelerated = false;
+
+// Decoder state, only touched from the event loop thread
+static uint8_t levels = REST_LEVELS;
+static int steps = 0;
+static long long last_detent_ns = 0;
+
+// Quarter steps for each (previous levels << 2) | new levels transition. Clockwise
+// goes 11 -> 01 -> 00 -> 10 -> 11 (A falls first); transitions that skip a
+// state are bounces or missed edges and count as nothing
+static const int8_t transition_steps[16] = {
+     0, -1, +1,  0,
+    +1,  0,  0, -1,
+    -1,  0,  0, +1,
+     0, +1, -1,  0,
+};
 
-// Flag to signal thread termination
-static volatile bool exit_thread = false;
+// Event handling variables
+static bool events_running = false;
 
 // Module initialization status
 static bool is_initialized = false;
 
 // Internal function prototypes
-static void *rotary_encoder_thread(void *arg);
-static void increment_counter();
-static void decrement_counter();
-static void rotary_encoder_do_state();
-
-// Array of each state transition based on A/B rising/falling edges
-static struct state states[] = {
-    {
-        .risingA = {&states[0], NULL},
-        .fallingA = {&states[4], NULL},
-        .risingB = {&states[0], NULL},
-        .fallingB = {&states[1], NULL},
-    },
-    {
-        .risingA = {&states[1], NULL},
-        .fallingA = {&states[2], NULL},
-        .risingB = {&states[0], NULL},
-        .fallingB = {&states[1], NULL},   
-    },
-    {
-        .risingA = {&states[1], NULL},
-        .fallingA = {&states[2], NULL},
-        .risingB = {&states[3], NULL},
-        .fallingB = {&states[2], NULL},
-    },
-    {
-        .risingA = {&states[0], decrement_counter},
-        .fallingA = {&states[3], NULL},
-        .risingB = {&states[3], NULL},
-        .fallingB = {&states[2], NULL},
-    },
-    {
-        .risingA = {&states[0], NULL},
-        .fallingA = {&states[4], NULL},
-        .risingB = {&states[4], NULL},
-        .fallingB = {&states[5], NULL},
-    },
-    {
-        .risingA = {&states[6], NULL},
-        .fallingA = {&states[5], NULL},
-        .risingB = {&states[4], NULL},
-        .fallingB = {&states[5], NULL},
-    },
-    {
-        .risingA = {&states[6], NULL},
-        .fallingA = {&states[5], NULL},
-        .risingB = {&states[0], increment_counter},
-        .fallingB = {&states[6], NULL},
-    },
-};
-
-// Pointer to the current state in the state machine
-static struct state *current_state = &states[0];
+static void rotary_encoder_do_state(void *line);
+static void add_detent(int direction, long long timestamp_ns);
 
 void rotary_encoder_init(RotaryEncoder *rotary_encoder)
 {
     assert(!is_initialized);
     assert(!rotary_encoder->is_initialized);
-    gpio_initialize();
+    const HalBackend *backend = hal_backend_get();
+    backend->gpio_initialize();
     
     // Sets both Line A and B to listen at the same time
-    line_a = gpio_open_for_events(GPIO_CHIP, GPIO_LINE_NUMBER_A);
-    line_b = gpio_open_for_events(GPIO_CHIP, GPIO_LINE_NUMBER_B);
+    line_a = backend->gpio_open_for_events(GPIO_CHIP, GPIO_LINE_NUMBER_A);
+    line_b = backend->gpio_open_for_events(GPIO_CHIP, GPIO_LINE_NUMBER_B);
     is_initialized = true;
     
     rotary_encoder->is_initialized = true;
 
-    rotary_encoder_start_thread(rotary_encoder);
+    rotary_encoder_start_events(rotary_encoder);
 }
 
-void rotary_encoder_start_thread(RotaryEncoder *rotary_encoder)
+void rotary_encoder_start_events(RotaryEncoder *rotary_encoder)
 {
     assert(is_initialized);
     assert(rotary_encoder->is_initialized);
-    thread_running = true;
+    const HalBackend *backend = hal_backend_get();
+    events_running = true;
 
-    if (pthread_create(&state_machine_thread, NULL, rotary_encoder_thread, NULL) != 0){
-        perror("Error creating thread");
-        exit(EXIT_FAILURE);
-    }
+    event_loop_add_fd(backend->gpio_get_event_fd(line_a), rotary_encoder_do_state, line_a);
+    event_loop_add_fd(backend->gpio_get_event_fd(line_b), rotary_encoder_do_state, line_b);
 }
 
 int rotary_encoder_get_value(RotaryEncoder *rotary_encoder)
 {
     assert(is_initialized);
     assert(rotary_encoder->is_initialized);
-
-    int value;
-    pthread_mutex_lock(&counter_mutex);
-    {
-        value = counter;
-    }
-    pthread_mutex_unlock(&counter_mutex);
-    return value;
+    return atomic_load(&counter);
 }
 
 void rotary_encoder_set_value(int value)
 {
-    pthread_mutex_lock(&counter_mutex);
-    {
-        counter = value;
-    }
-    pthread_mutex_unlock(&counter_mutex);
+    atomic_store(&counter, value);
 }
 
-void rotary_encoder_stop_thread(RotaryEncoder *rotary_encoder)
+void rotary_encoder_set_acceleration(bool enabled)
+{
+    atomic_store(&is_accelerated, enabled);
+}
+
+void rotary_encoder_stop_events(RotaryEncoder *rotary_encoder)
 {
     assert(is_initialized);
     assert(rotary_encoder->is_initialized);
-    thread_running = false;
-    exit_thread = true;
-    pthread_join(state_machine_thread, NULL);
+    const HalBackend *backend = hal_backend_get();
+    events_running = false;
+
+    event_loop_remove_fd(backend->gpio_get_event_fd(line_a));
+    event_loop_remove_fd(backend->gpio_get_event_fd(line_b));
 }
 
 void rotary_encoder_cleanup(RotaryEncoder *rotary_encoder)
@@ -158,88 +127,60 @@ void rotary_encoder_cleanup(RotaryEncoder *rotary_encoder)
     assert(is_initialized);
     assert(rotary_encoder->is_initialized);
 
-    gpio_close(line_a);
-    gpio_close(line_b);
-    pthread_mutex_destroy(&counter_mutex);
+    if (events_running){
+        rotary_encoder_stop_events(rotary_encoder);
+    }
+
+    hal_backend_get()->gpio_close(line_a);
+    hal_backend_get()->gpio_close(line_b);
 
     is_initialized = false;
     rotary_encoder->is_initialized = false;
 }
 
-// Thread function that continuously handles state transitions
-static void *rotary_encoder_thread(void *arg)
+// Adds one detent in a direction, scaled by how soon it came after the last one
+static void add_detent(int direction, long long timestamp_ns)
 {
-    (void)arg;
-    while (thread_running){
-        rotary_encoder_do_state();
-    }
-    return NULL;
-}
-
-// Increments the counter, with an upper limit of 500
-static void increment_counter()
-{
-    pthread_mutex_lock(&counter_mutex);
-    {
-        counter += 1;
-    }
-    pthread_mutex_unlock(&counter_mutex);
-}
+    int step = 1;
+    long long interval_ns = timestamp_ns - last_detent_ns;
+    last_detent_ns = timestamp_ns;
 
-// Decrements the counter, with a lower limit of 0
-static void decrement_counter()
-{
-    pthread_mutex_lock(&counter_mutex);
-    { 
-        counter -= 1;
+    if (atomic_load(&is_accelerated)){
+        if (interval_ns < ACCEL_FAST_INTERVAL_NS){
+            step = ACCEL_FAST_STEP;
+        }
+        else if (interval_ns < ACCEL_MEDIUM_INTERVAL_NS){
+            step = ACCEL_MEDIUM_STEP;
+        }
     }
-    pthread_mutex_unlock(&counter_mutex);
+    atomic_fetch_add(&counter, direction * step);
 }
 
-// Core state machine logic: processes GPIO events and update states
-static void rotary_encoder_do_state()
+// Core decoder logic: processes a GPIO event on line A/B and counts full detents
+static void rotary_encoder_do_state(void *line)
 {
-    struct gpiod_line_bulk bulk;
+    struct GPIOEvent event;
 
-    // Wait for an event on line A/B, and can exit thread if program ends
-    int num = gpio_wait_for_line_change_two(line_a, line_b, &bulk, &exit_thread);
-    if (num == -1) {
+    // Called by the event loop once the line has an event to read
+    if (hal_backend_get()->gpio_read_event(line, &event) == -1) {
         return;
     }
-    for (int i = 0; i < num; i++){
-        struct gpiod_line *line_handle = gpiod_line_bulk_get_line(&bulk, i);
-        unsigned int this_line_number = gpiod_line_offset(line_handle);
-
-        struct gpiod_line_event event;
-        if (gpiod_line_event_read(line_handle, &event) == -1){
-            perror("Line Event");
-            exit(EXIT_FAILURE);
-        }
 
-        // Determine which state transition to take based on the line and event type
-        struct stateEvent *state_event = NULL;
-
-        if (this_line_number == GPIO_LINE_NUMBER_A) {
-            if (event.event_type == GPIOD_LINE_EVENT_RISING_EDGE) {
-                state_event = &current_state->risingA;
-            } 
-            else {
-                state_event = &current_state->fallingA;
-            }
-        } 
-        else {
-            if (event.event_type == GPIOD_LINE_EVENT_RISING_EDGE) {
-                state_event = &current_state->risingB;
-            } 
-            else {
-                state_event = &current_state->fallingB;
-            }
+    // Apply the edge to the channel levels and look up the quarter step
+    uint8_t bit = event.line_number == GPIO_LINE_NUMBER_A ? 0x2 : 0x1;
+    uint8_t new_levels = event.is_rising ? (levels | bit) : (levels & ~bit);
+    steps += transition_steps[(levels << 2) | new_levels];
+    levels = new_levels;
+
+    // A detent is complete once both channels are back at rest; bounces
+    // cancel out, so any remaining half turn decides the direction
+    if (levels == REST_LEVELS){
+        if (steps >= 2){
+            add_detent(1, event.timestamp_ns);
         }
-
-        // Execute action if defined (increment/decrement counter)
-        if (state_event->action != NULL){
-            state_event->action();
+        else if (steps <= -2){
+            add_detent(-1, event.timestamp_ns);
         }
-        current_state = state_event->next_state;
+        steps = 0;
     }
-} 
+}
@@ -0,0 +1,446 @@
+/*
+ * This file implements the simulated backend for the HAL. The joystick follows
+ * a script of held positions, the rotary encoder turns back and forth in bursts
+ * of detents, the rotary button toggles mute every few seconds, the distance
+ * sensor replays a trace of hand distances and display frames are dropped.
+ * Each device takes about as long as the real one to answer, so the threads
+ * above it run with the same timing as on the board.
+ */
+
+#include "hal_backend.h"
+#include "utils.h"
+#include <sys/timerfd.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <limits.h>
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Pin configuration of the simulated devices, matching the HAL drivers
+#define SIM_ENCODER_CHIP GPIO_CHIP_2         // Rotary encoder, see rotary_encoder.c
+#define SIM_ENCODER_LINE_A 7
+#define SIM_ENCODER_LINE_B 8
+#define SIM_ROTARY_BUTTON_CHIP GPIO_CHIP_0   // Rotary button, see rotary_button.c
+#define SIM_ROTARY_BUTTON_LINE 10
+#define SIM_JOYSTICK_BUTTON_CHIP GPIO_CHIP_2 // Joystick button, see joystick_button.c
+#define SIM_JOYSTICK_BUTTON_LINE 15
+
+#define SIM_JOYSTICK_CONVERSION_MS 2  // Time the TLA2024 takes to settle on a channel
+#define SIM_ENCODER_START_MS 3000     // Time before the encoder starts turning
+#define SIM_ENCODER_EDGE_MS 5         // Time between two encoder edges while turning
+#define SIM_BUTTON_HOLD_MS 80         // Time a simulated button is held down
+#define SIM_MUTE_PERIOD_MS 9000       // Time between two presses of the rotary button
+#define SIM_DISTANCE_STEP_MS 250      // Time between two points of the distance trace
+#define SIM_SOUND_US_PER_CM 58        // Echo round trip time per cm of distance
+
+#define SIM_MISSED_ECHO -1            // Distance trace entry for an echo that never returns
+
+// Roles of the simulated GPIO lines
+typedef enum {
+    SIM_LINE_NONE,
+    SIM_LINE_ENCODER,
+    SIM_LINE_ROTARY_BUTTON,
+    SIM_LINE_JOYSTICK_BUTTON,
+} SimLineRole;
+
+// Struct representing a simulated GPIO line, whose events come from a timer
+// armed for the next scripted edge on the line
+struct GPIOLine {
+    enum eGPIOChips chip; // GPIO chip the line was opened on
+    int pin_number;       // Line number on the chip
+    SimLineRole role;     // Device the line belongs to
+    int timer_fd;         // Timer expiring when the next edge is due
+};
+
+// Struct representing a held joystick position, in raw ADC units
+struct SimJoystickStep {
+    uint16_t x;
+    uint16_t y;
+    int hold_ms;
+};
+
+// Struct representing a burst of encoder detents followed by a pause
+struct SimEncoderBurst {
+    int detents;  // Number of detents, positive for clockwise
+    int pause_ms; // Time to rest after the burst
+};
+
+// Struct representing a button that is pressed and released on a schedule
+struct SimButton {
+    long long next_press_ms; // Time of the next falling edge, or LLONG_MAX
+    bool is_down;            // True while the button is held
+};
+
+// Joystick script cycling through rest and each dial direction
+static const struct SimJoystickStep joystick_script[] = {
+    {815, 835, 3000},  // Rest
+    {815, 23, 2000},   // Down: volume
+    {815, 835, 1500},  // Rest
+    {815, 1647, 2000}, // Up: octave
+    {815, 835, 1500},  // Rest
+    {1630, 835, 2000}, // Right: waveform
+    {815, 835, 1500},  // Rest
+    {1, 835, 2000},    // Left: distortion
+};
+#define SIM_JOYSTICK_STEPS (sizeof(joystick_script) / sizeof(joystick_script[0]))
+
+// Encoder script of slow and fast turns in both directions
+static const struct SimEncoderBurst encoder_script[] = {
+    {5, 700},
+    {-5, 700},
+    {40, 1200},
+    {-40, 1200},
+    {1, 300},
+    {-1, 300},
+};
+#define SIM_ENCODER_BURSTS (sizeof(encoder_script) / sizeof(encoder_script[0]))
+
+// Edges of one clockwise detent as (line, rising) pairs; counter-clockwise swaps lines
+static const struct GPIOEvent encoder_cw_edges[] = {
+    {SIM_ENCODER_LINE_A, false, 0},
+    {SIM_ENCODER_LINE_B, false, 0},
+    {SIM_ENCODER_LINE_A, true, 0},
+    {SIM_ENCODER_LINE_B, true, 0},
+};
+#define SIM_EDGES_PER_DETENT 4
+
+// Distance trace of a hand moving in and out of range, in cm
+static const int distance_trace[] = {
+    45, 40, 34, 28, 22, 16, 11, 7, 5, 4, 5, 7, 10, 14, 19, 25,
+    SIM_MISSED_ECHO, 32, 38, 44, 52, 60, 60, 52, 44, 36, 30, 26, 24, 23, 24, 28,
+};
+#define SIM_DISTANCE_POINTS (sizeof(distance_trace) / sizeof(distance_trace[0]))
+
+// Time the simulated devices were started
+static long long start_time_ms = 0;
+static pthread_once_t start_once = PTHREAD_ONCE_INIT;
+
+// Run time before the joystick button is pressed, 0 to never press it
+static int run_time_s = 0;
+
+// When the simulated ADC last switched channel
+static long long joystick_read_time_ms = 0;
+
+// Encoder playback state
+static long long encoder_next_edge_ms = 0;
+static int encoder_burst = 0;
+static int encoder_edge = 0;
+
+// Button playback state
+static struct SimButton rotary_button = {LLONG_MAX, false};
+static struct SimButton joystick_button = {LLONG_MAX, false};
+
+// Opened lines of each device, NULL until the driver opens them
+static struct GPIOLine *encoder_line_a = NULL;
+static struct GPIOLine *encoder_line_b = NULL;
+static struct GPIOLine *rotary_button_line = NULL;
+static struct GPIOLine *joystick_button_line = NULL;
+
+// Number of frames sent to the simulated display
+static long long frames_shown = 0;
+
+void hal_backend_simulated_set_run_time(int seconds)
+{
+    assert(seconds >= 0);
+    run_time_s = seconds;
+}
+
+// Starts the clock every script is played against
+static void start_clock(void)
+{
+    start_time_ms = get_time_in_ms();
+}
+
+static int sim_joystick_open(void)
+{
+    pthread_once(&start_once, start_clock);
+    return 0;
+}
+
+static uint16_t sim_joystick_read_raw(int handle, JoystickDirection dir)
+{
+    (void)handle;
+
+    // Like the board, only wait for what is left of the settle time since the
+    // previous read switched the channel
+    long long settle_ms = joystick_read_time_ms + SIM_JOYSTICK_CONVERSION_MS - get_time_in_ms();
+    if (settle_ms > 0){
+        sleep_for_ms(settle_ms);
+    }
+    joystick_read_time_ms = get_time_in_ms();
+
+    int cycle_ms = 0;
+    for (size_t i = 0; i < SIM_JOYSTICK_STEPS; i++){
+        cycle_ms += joystick_script[i].hold_ms;
+    }
+
+    // Find the step the script is currently holding
+    int elapsed_ms = (get_time_in_ms() - start_time_ms) % cycle_ms;
+    size_t step = 0;
+    while (elapsed_ms >= joystick_script[step].hold_ms){
+        elapsed_ms -= joystick_script[step].hold_ms;
+        step++;
+    }
+    return dir == JOYSTICK_X ? joystick_script[step].x : joystick_script[step].y;
+}
+
+static void sim_joystick_close(int handle)
+{
+    (void)handle;
+}
+
+static void sim_gpio_initialize(void)
+{
+    pthread_once(&start_once, start_clock);
+}
+
+// Arms the timer of a line to expire at due_ms, or disarms it for LLONG_MAX
+static void arm_line(struct GPIOLine *line, long long due_ms)
+{
+    if (line == NULL){
+        return;
+    }
+
+    // A due time of zero would disarm the timer, so late edges fire right away
+    struct itimerspec expiry = {0};
+    if (due_ms != LLONG_MAX){
+        long long fire_ms = due_ms > 0 ? due_ms : 1;
+        expiry.it_value.tv_sec = fire_ms / 1000;
+        expiry.it_value.tv_nsec = (fire_ms % 1000) * 1000000L;
+    }
+    if (timerfd_settime(line->timer_fd, TFD_TIMER_ABSTIME, &expiry, NULL) == -1){
+        perror("Unable to arm simulated GPIO line");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Gets the next edge of the encoder script without taking it
+static void encoder_peek_edge(struct GPIOEvent *event)
+{
+    bool clockwise = encoder_script[encoder_burst].detents > 0;
+
+    *event = encoder_cw_edges[encoder_edge % SIM_EDGES_PER_DETENT];
+    if (!clockwise){
+        event->line_number = event->line_number == SIM_ENCODER_LINE_A ?
+                             SIM_ENCODER_LINE_B : SIM_ENCODER_LINE_A;
+    }
+}
+
+// Arms the encoder line that owns the next edge and disarms the other one
+static void schedule_encoder(void)
+{
+    struct GPIOEvent next;
+    encoder_peek_edge(&next);
+
+    bool on_a = next.line_number == SIM_ENCODER_LINE_A;
+    arm_line(encoder_line_a, on_a ? encoder_next_edge_ms : LLONG_MAX);
+    arm_line(encoder_line_b, on_a ? LLONG_MAX : encoder_next_edge_ms);
+}
+
+// Gets the time of the next edge on a button
+static long long button_next_edge_ms(struct SimButton *button)
+{
+    if (button->is_down){
+        return button->next_press_ms + SIM_BUTTON_HOLD_MS;
+    }
+    return button->next_press_ms;
+}
+
+static struct GPIOLine *sim_gpio_open_for_events(enum eGPIOChips chip, int pin_number)
+{
+    struct GPIOLine *line = malloc(sizeof(*line));
+    if (line == NULL){
+        perror("Unable to allocate simulated GPIO line");
+        exit(EXIT_FAILURE);
+    }
+    line->chip = chip;
+    line->pin_number = pin_number;
+    line->role = SIM_LINE_NONE;
+    line->timer_fd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (line->timer_fd == -1){
+        perror("Unable to create simulated GPIO line timer");
+        exit(EXIT_FAILURE);
+    }
+
+    long long now_ms = get_time_in_ms();
+    if (chip == SIM_ENCODER_CHIP && pin_number == SIM_ENCODER_LINE_A){
+        line->role = SIM_LINE_ENCODER;
+        encoder_line_a = line;
+        encoder_next_edge_ms = now_ms + SIM_ENCODER_START_MS;
+        schedule_encoder();
+    }
+    else if (chip == SIM_ENCODER_CHIP && pin_number == SIM_ENCODER_LINE_B){
+        line->role = SIM_LINE_ENCODER;
+        encoder_line_b = line;
+        schedule_encoder();
+    }
+    else if (chip == SIM_ROTARY_BUTTON_CHIP && pin_number == SIM_ROTARY_BUTTON_LINE){
+        line->role = SIM_LINE_ROTARY_BUTTON;
+        rotary_button_line = line;
+        rotary_button.next_press_ms = now_ms + SIM_MUTE_PERIOD_MS;
+        arm_line(line, button_next_edge_ms(&rotary_button));
+    }
+    else if (chip == SIM_JOYSTICK_BUTTON_CHIP && pin_number == SIM_JOYSTICK_BUTTON_LINE){
+        line->role = SIM_LINE_JOYSTICK_BUTTON;
+        joystick_button_line = line;
+        if (run_time_s > 0){
+            joystick_button.next_press_ms = start_time_ms + run_time_s * 1000LL;
+        }
+        arm_line(line, button_next_edge_ms(&joystick_button));
+    }
+    return line;
+}
+
+static int sim_gpio_get_event_fd(struct GPIOLine *line)
+{
+    return line->timer_fd;
+}
+
+// Produces the next edge of a button, pressing it again after period_ms
+static void button_take_edge(struct SimButton *button, int pin_number,
+                             long long period_ms, struct GPIOEvent *event)
+{
+    event->line_number = pin_number;
+    event->is_rising = button->is_down;
+    event->timestamp_ns = button_next_edge_ms(button) * 1000000LL;
+
+    if (button->is_down){
+        button->next_press_ms = period_ms > 0 ? button->next_press_ms + period_ms : LLONG_MAX;
+    }
+    button->is_down = !button->is_down;
+}
+
+// Produces the next edge of the encoder script
+static void encoder_take_edge(struct GPIOEvent *event)
+{
+    const struct SimEncoderBurst *burst = &encoder_script[encoder_burst];
+    encoder_peek_edge(event);
+    event->timestamp_ns = encoder_next_edge_ms * 1000000LL;
+
+    encoder_edge++;
+    encoder_next_edge_ms += SIM_ENCODER_EDGE_MS;
+    if (encoder_edge == abs(burst->detents) * SIM_EDGES_PER_DETENT){
+        encoder_edge = 0;
+        encoder_next_edge_ms += burst->pause_ms;
+        encoder_burst = (encoder_burst + 1) % SIM_ENCODER_BURSTS;
+    }
+}
+
+static int sim_gpio_read_event(struct GPIOLine *line, struct GPIOEvent *event)
+{
+    // Nothing is pending unless the timer of the line expired
+    uint64_t expirations;
+    if (read(line->timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations)){
+        return -1;
+    }
+
+    if (line->role == SIM_LINE_ENCODER){
+        encoder_take_edge(event);
+        schedule_encoder();
+    }
+    else if (line->role == SIM_LINE_ROTARY_BUTTON){
+        button_take_edge(&rotary_button, SIM_ROTARY_BUTTON_LINE, SIM_MUTE_PERIOD_MS, event);
+        arm_line(line, button_next_edge_ms(&rotary_button));
+    }
+    else if (line->role == SIM_LINE_JOYSTICK_BUTTON){
+        button_take_edge(&joystick_button, SIM_JOYSTICK_BUTTON_LINE, 0, event);
+        arm_line(line, button_next_edge_ms(&joystick_button));
+    }
+    else{
+        return -1;
+    }
+    return 0;
+}
+
+static void sim_gpio_close(struct GPIOLine *line)
+{
+    if (line == encoder_line_a){
+        encoder_line_a = NULL;
+    }
+    else if (line == encoder_line_b){
+        encoder_line_b = NULL;
+    }
+    else if (line == rotary_button_line){
+        rotary_button_line = NULL;
+    }
+    else if (line == joystick_button_line){
+        joystick_button_line = NULL;
+    }
+    close(line->timer_fd);
+    free(line);
+}
+
+static void sim_gpio_cleanup(void)
+{
+}
+
+static void sim_distance_open(void)
+{
+    pthread_once(&start_once, start_clock);
+}
+
+static int sim_distance_measure_cm(void)
+{
+    // Interpolate between the two trace points around the current time
+    long long elapsed_ms = get_time_in_ms() - start_time_ms;
+    size_t index = (elapsed_ms / SIM_DISTANCE_STEP_MS) % SIM_DISTANCE_POINTS;
+    int from = distance_trace[index];
+    int to = distance_trace[(index + 1) % SIM_DISTANCE_POINTS];
+    if (from == SIM_MISSED_ECHO || to == SIM_MISSED_ECHO){
+        sleep_for_ms(30);
+        return -1;
+    }
+    int fraction_ms = elapsed_ms % SIM_DISTANCE_STEP_MS;
+    int distance = from + (to - from) * fraction_ms / SIM_DISTANCE_STEP_MS;
+
+    // Take as long as the echo would to come back
+    sleep_for_ms((distance * SIM_SOUND_US_PER_CM) / 1000 + 1);
+    return distance;
+}
+
+static void sim_distance_close(void)
+{
+}
+
+static int sim_display_init(void)
+{
+    frames_shown = 0;
+    return 0;
+}
+
+static void sim_display_show(uint16_t *image)
+{
+    (void)image;
+    frames_shown++;
+}
+
+static void sim_display_exit(void)
+{
+    printf("\nSimulated display showed %lld frames\n", frames_shown);
+}
+
+const HalBackend hal_backend_simulated = {
+    .name = "simulated",
+
+    .joystick_open = sim_joystick_open,
+    .joystick_read_raw = sim_joystick_read_raw,
+    .joystick_close = sim_joystick_close,
+
+    .gpio_initialize = sim_gpio_initialize,
+    .gpio_open_for_events = sim_gpio_open_for_events,
+    .gpio_get_event_fd = sim_gpio_get_event_fd,
+    .gpio_read_event = sim_gpio_read_event,
+    .gpio_close = sim_gpio_close,
+    .gpio_cleanup = sim_gpio_cleanup,
+
+    .distance_open = sim_distance_open,
+    .distance_measure_cm = sim_distance_measure_cm,
+    .distance_close = sim_distance_close,
+
+    .display_init = sim_display_init,
+    .display_show = sim_display_show,
+    .display_exit = sim_display_exit,
+};
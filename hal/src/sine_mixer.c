@@ -1,13 +1,25 @@
 /*
  * This file implements the sine mixer module, which generates and plays
  * which is a modified version of the audio mixer from assignment 3.
+ * Each voice keeps its own frequency and phase, and the playing voices
+ * are summed and run through the effects chain into the playback buffer.
+ * The modulation is rendered first, and its pitch, morph, gain and cutoff
+ * are applied sample by sample. Each voice's level follows its envelope,
+ * and its frequency is ramped across each buffer, so notes starting,
+ * stopping and changing do not click.
  */
 #include "sine_mixer.h"
+#include "audio_effects.h"
+#include "modulation.h"
+#include "envelope.h"
+#include "noise.h"
+#include "utils.h"
 #include <alsa/asoundlib.h>
 #include <stdbool.h>
 #include <pthread.h>
 #include <limits.h>
 #include <alloca.h>
+#include <assert.h>
 #include <math.h>
 
 #define PI 3.1415926535897932		// Pi constant used in sine wave calculations
@@ -16,24 +28,52 @@
 #define NUM_CHANNELS 1				// Number of audio channels (mono)
 #define SAMPLE_SIZE (sizeof(short)) // Bytes per sample
 
-// Audio buffer size and playback buffer
+#define ENVELOPE_ATTACK_MS 10.0		// Time a note takes to reach full level
+#define ENVELOPE_DECAY_MS 150.0		// Time it then takes to settle to the sustain level
+#define ENVELOPE_SUSTAIN 0.8		// Level a held note settles to
+#define ENVELOPE_RELEASE_MS 200.0	// Time a stopped note takes to fade out
+
+// Audio buffer size, playback buffer and the buffer voices are summed in
 static unsigned long playback_buffer_size = 0;
 static short *playback_buffer = NULL;
+static double *mix_buffer = NULL;
+static double *envelope_buffer = NULL;
+static double *noise_buffer = NULL;
 static snd_pcm_t *handle;
 
-// Vars to control current frequency playback
-static enum SineMixerWaveform current_waveform = SINEMIXER_WAVE_SINE;
-static double decayingSine_timeVar = 0;
+// Struct representing one voice of the mixer
+struct Voice {
+	bool is_playing;			   // Held between a note on and a note off
+	bool note_started;			   // Set by a note on, until the playback thread starts the attack
+	double current_frequency;	   // 0 once the voice has faded out
+	double desired_frequency;
+	bool restart_decay;			   // Set when a new note restarts the decaying sine
+	long long frequency_queued_us; // Time the last frequency was queued, until picked up
+};
+
+static struct Voice voices[SINEMIXER_MAX_VOICES];
+
+// Waveform position, level and last rendered frequency of each voice, only used by the playback thread
+static double voice_phase[SINEMIXER_MAX_VOICES];
+static double voice_decay_level[SINEMIXER_MAX_VOICES];
+static double voice_rendered_frequency[SINEMIXER_MAX_VOICES];
+static struct Envelope voice_envelopes[SINEMIXER_MAX_VOICES];
+static double voice_scale = 1.0;
+
+// The decaying sine falls by a fixed ratio each sample, e^-DECAYRATE each second
+#define DECAYINGSINE_DECAYRATE 4.0
+static double decaying_sine_step = 0;
 
-// Vars to control frequency distortion
+// Vars to control current waveform and the vibrato depth set as the distortion
+static enum SineMixerWaveform current_waveform = SINEMIXER_WAVE_SINE;
 static double frequency_distortion = 0;
-static double current_frequency = 0;
-static double desired_frequency = 0;
-static double frequency_change_rate = 0;
+
+// How long the playback thread took to pick up queued frequencies
+static long long pickup_total_us = 0;
+static long long pickup_max_us = 0;
+static long long pickup_count = 0;
 
 // Vars to control playback
-static bool is_playing = false;
-static double phase = 0;
 static int volume = 0;
 
 // Playback threading
@@ -48,11 +88,16 @@ static double triangleWave(double phase);
 static double sawtoothWave(double phase);
 static double stairWave(double phase);
 static double rectifiedSineWave(double phase);
-static double decayingSineWave(double phase);
+static double decayingSineWave(double phase, double *level);
+static double wave_sample(enum SineMixerWaveform waveform, double phase, double *decay_level, double noise);
+static void start_note(struct Voice *voice, double frequency);
+static void glide_voice(struct Voice *voice);
+static void render_voice(int voice, double freq, enum SineMixerWaveform waveform, int size);
 
 void sine_mixer_init(void)
 {
 	sine_mixer_set_volume(DEFAULT_VOLUME);
+	audio_effects_init(SAMPLE_RATE);
 
 	// Open the PCM output
 	int err = snd_pcm_open(&handle, "default", SND_PCM_STREAM_PLAYBACK, 0);
@@ -81,6 +126,16 @@ void sine_mixer_init(void)
 	snd_pcm_get_params(handle, &unusedBufferSize, &playback_buffer_size);
 	// ..allocate playback buffer:
 	playback_buffer = malloc(playback_buffer_size * sizeof(*playback_buffer));
+	mix_buffer = malloc(playback_buffer_size * sizeof(*mix_buffer));
+	envelope_buffer = malloc(playback_buffer_size * sizeof(*envelope_buffer));
+	noise_buffer = calloc(playback_buffer_size, sizeof(*noise_buffer));
+	modulation_init(SAMPLE_RATE, playback_buffer_size);
+
+	decaying_sine_step = exp(-DECAYINGSINE_DECAYRATE / SAMPLE_RATE);
+	for (int i = 0; i < SINEMIXER_MAX_VOICES; i++){
+		envelope_init(&voice_envelopes[i], ENVELOPE_ATTACK_MS, ENVELOPE_DECAY_MS, ENVELOPE_SUSTAIN,
+					  ENVELOPE_RELEASE_MS, SAMPLE_RATE);
+	}
 
 	// Launch playback thread:
 	pthread_create(&playback_thread, NULL, playbackThread, NULL);
@@ -88,43 +143,79 @@ void sine_mixer_init(void)
 
 void sine_mixer_queue_frequency(double frequency)
 {
-	if (frequency == desired_frequency){
-		return;
-	}
+	sine_mixer_queue_voice_frequency(0, frequency);
+}
+
+void sine_mixer_queue_voice_frequency(int voice_index, double frequency)
+{
+	assert(voice_index >= 0 && voice_index < SINEMIXER_MAX_VOICES);
+	struct Voice *voice = &voices[voice_index];
+
 	pthread_mutex_lock(&audio_mutex);
 	{
-		desired_frequency = frequency;
-		if (current_frequency == 0){
-			current_frequency = desired_frequency;
+		// A held note only changes pitch, without starting its attack again
+		if (!voice->is_playing){
+			start_note(voice, frequency);
+		}
+		else if (frequency != voice->desired_frequency){
+			voice->desired_frequency = frequency;
+			voice->frequency_queued_us = get_time_in_us();
 		}
-		is_playing = true;
-		decayingSine_timeVar = 0;
 	}
 	pthread_mutex_unlock(&audio_mutex);
 }
 
-double sine_mixer_get_frequency(void)
+void sine_mixer_note_on(int voice_index, double frequency)
 {
-	return desired_frequency;
+	assert(voice_index >= 0 && voice_index < SINEMIXER_MAX_VOICES);
+	pthread_mutex_lock(&audio_mutex);
+	{
+		start_note(&voices[voice_index], frequency);
+	}
+	pthread_mutex_unlock(&audio_mutex);
 }
 
-void sine_mixer_stop_playback(void)
+void sine_mixer_stop_voice(int voice_index)
+{
+	assert(voice_index >= 0 && voice_index < SINEMIXER_MAX_VOICES);
+	pthread_mutex_lock(&audio_mutex);
+	{
+		// The playback thread releases the note and silences the voice once it has faded out
+		voices[voice_index].is_playing = false;
+	}
+	pthread_mutex_unlock(&audio_mutex);
+}
+
+void sine_mixer_get_pickup_latency(long long *avg_us, long long *max_us)
 {
 	pthread_mutex_lock(&audio_mutex);
 	{
-		is_playing = false;
-		current_frequency = 0;
-		desired_frequency = 0;
+		*avg_us = pickup_count > 0 ? pickup_total_us / pickup_count : 0;
+		*max_us = pickup_max_us;
 	}
 	pthread_mutex_unlock(&audio_mutex);
 }
 
+double sine_mixer_get_frequency(void)
+{
+	return voices[0].is_playing ? voices[0].desired_frequency : 0;
+}
+
+void sine_mixer_stop_playback(void)
+{
+	for (int i = 0; i < SINEMIXER_MAX_VOICES; i++){
+		sine_mixer_stop_voice(i);
+	}
+}
+
 void sine_mixer_set_waveform(enum SineMixerWaveform waveform)
 {
 	pthread_mutex_lock(&audio_mutex);
 	{
 		current_waveform = waveform;
-		decayingSine_timeVar = 0;
+		for (int i = 0; i < SINEMIXER_MAX_VOICES; i++){
+			voices[i].restart_decay = true;
+		}
 	}
 	pthread_mutex_unlock(&audio_mutex);
 }
@@ -138,7 +229,13 @@ void sine_mixer_set_distortion(double distortion)
 {
 	pthread_mutex_lock(&audio_mutex);
 	{
-		frequency_distortion = distortion;
+		// Only a change is routed, so a route set elsewhere stays until the dial moves
+		if (distortion != frequency_distortion){
+			frequency_distortion = distortion;
+			double semitones = 12 * log2(1 + distortion);
+			modulation_set_route(MODULATION_SOURCE_LFO_1, MODULATION_DEST_PITCH,
+								 (int)lround(semitones / MODULATION_PITCH_RANGE_SEMITONES * MODULATION_AMOUNT_MAX));
+		}
 	}
 	pthread_mutex_unlock(&audio_mutex);
 }
@@ -176,6 +273,11 @@ void sine_mixer_set_volume(int newVolume)
 	snd_mixer_selem_id_set_index(sid, 0);
 	snd_mixer_selem_id_set_name(sid, selem_name);
 	snd_mixer_elem_t *elem = snd_mixer_find_selem(mixerHandle, sid);
+	if (elem == NULL){
+		// No such control on this sound card (e.g. a workstation), keep the cached volume
+		snd_mixer_close(mixerHandle);
+		return;
+	}
 
 	snd_mixer_selem_get_playback_volume_range(elem, &min, &max);
 	snd_mixer_selem_set_playback_volume_all(elem, volume * max / 100);
@@ -195,6 +297,10 @@ void sine_mixer_cleanup(void)
 	// Stop the PCM generation thread
 	stopping = true;
 	pthread_join(playback_thread, NULL);
+	modulation_print_stats();
+	audio_effects_print_stats();
+	modulation_cleanup();
+	audio_effects_cleanup();
 
 	// Shutdown the PCM output, allowing any pending sound to play out (drain)
 	snd_pcm_drain(handle);
@@ -205,6 +311,12 @@ void sine_mixer_cleanup(void)
 	// in addition to this by calling AudioMixer_freeWaveFileData() on that struct.)
 	free(playback_buffer);
 	playback_buffer = NULL;
+	free(mix_buffer);
+	mix_buffer = NULL;
+	free(envelope_buffer);
+	envelope_buffer = NULL;
+	free(noise_buffer);
+	noise_buffer = NULL;
 
 	fflush(stdout);
 }
@@ -242,85 +354,202 @@ static double rectifiedSineWave(double phase)
 	return fabs(sin(phase));
 }
 
-#define DECAYINGSINE_DECAYRATE 4.0
-static double decayingSineWave(double phase)
+static double decayingSineWave(double phase, double *level)
 {
-	decayingSine_timeVar += 0.00002;
-	return sin(phase) * exp(-DECAYINGSINE_DECAYRATE * decayingSine_timeVar);
+	double sample = sin(phase) * *level;
+	*level *= decaying_sine_step;
+	return sample;
 }
 
 // Fill the buff array with new PCM values to output.
-//    buff: buffer to fill with new PCM data from sound bites.
+//    buff: buffer to fill with new PCM data from the playing voices.
 //    size: the number of *values* to store into buff
 static void fillplayback_buffer(short *buff, int size)
 {
-	memset(buff, 0, size * sizeof(short));
-	double freq;
-	double distortion;
+	int playing_voices[SINEMIXER_MAX_VOICES];
+	double playing_frequencies[SINEMIXER_MAX_VOICES];
+	int num_playing = 0;
 	enum SineMixerWaveform waveform;
-	bool playing;
 	pthread_mutex_lock(&audio_mutex);
 	{
-		freq = current_frequency;
-		distortion = frequency_distortion;
 		waveform = current_waveform;
-		playing = is_playing;
+
+		for (int i = 0; i < SINEMIXER_MAX_VOICES; i++){
+			struct Voice *voice = &voices[i];
+			struct Envelope *envelope = &voice_envelopes[i];
+			if (voice->note_started){
+				envelope_note_on(envelope);
+				voice->note_started = false;
+			}
+			if (!voice->is_playing){
+				envelope_note_off(envelope);
+			}
+			else{
+				glide_voice(voice);
+			}
+
+			// The buffer about to be rendered is the first to glide towards a new frequency
+			if (voice->frequency_queued_us != 0){
+				long long pickup_us = get_time_in_us() - voice->frequency_queued_us;
+				pickup_total_us += pickup_us;
+				pickup_count++;
+				if (pickup_us > pickup_max_us){
+					pickup_max_us = pickup_us;
+				}
+				voice->frequency_queued_us = 0;
+			}
+			if (voice->restart_decay){
+				voice_decay_level[i] = 1;
+				voice->restart_decay = false;
+			}
+			if (envelope_is_active(envelope) && voice->current_frequency > 0){
+				playing_voices[num_playing] = i;
+				playing_frequencies[num_playing] = voice->current_frequency;
+				num_playing++;
+			}
+			else if (!voice->is_playing){
+				// Faded out, so the next note starts on its own pitch instead of gliding
+				voice->current_frequency = 0;
+				voice_rendered_frequency[i] = 0;
+			}
+		}
 	}
 	pthread_mutex_unlock(&audio_mutex);
-	distortion = freq * distortion;
-	freq += (2 * distortion) * (rand() / (double)RAND_MAX) - distortion;
 
-	if (!playing || freq <= 0){
-		return; // with an empty buffer
+	modulation_render(size);
+	memset(mix_buffer, 0, size * sizeof(*mix_buffer));
+	for (int i = 0; i < num_playing; i++){
+		render_voice(playing_voices[i], playing_frequencies[i], waveform, size);
 	}
 
-	double phase_increment = 2.0 * PI * freq / SAMPLE_RATE;
+	// Share the full scale between the playing voices so the sum cannot clip, and apply the gain.
+	// The share is ramped across the buffer, so a voice starting or ending does not step the level.
+	const double *gains = modulation_get_buffer(MODULATION_DEST_GAIN);
+	double target_scale = num_playing > 1 ? 1.0 / num_playing : 1.0;
+	double scale_step = (target_scale - voice_scale) / size;
+	for (int i = 0; i < size; i++){
+		voice_scale += scale_step;
+		mix_buffer[i] *= gains[i] * voice_scale;
+	}
+	voice_scale = target_scale;
+
+	// The effects run even when no voice is playing, so echoes and reverb ring out
+	audio_effects_process(mix_buffer, modulation_get_buffer(MODULATION_DEST_FILTER_CUTOFF), size);
 
 	for (int i = 0; i < size; i++){
-		double sample;
+		double sample = mix_buffer[i];
+		if (sample > 1.0){
+			sample = 1.0;
+		}
+		else if (sample < -1.0){
+			sample = -1.0;
+		}
+		buff[i] = (short)(sample * 32767);
+	}
+}
 
-		switch (waveform){
+// Starts a note on a voice, gliding to it if a note is held. Called with the lock held.
+static void start_note(struct Voice *voice, double frequency)
+{
+	voice->desired_frequency = frequency;
+	if (!voice->is_playing || voice->current_frequency == 0){
+		voice->current_frequency = frequency;
+	}
+	voice->is_playing = true;
+	voice->note_started = true;
+	voice->restart_decay = true;
+	voice->frequency_queued_us = get_time_in_us();
+}
 
-			case SINEMIXER_WAVE_SINE:
-				sample = sin(phase);
-				break;
+// Moves a voice's frequency towards the one queued
+static void glide_voice(struct Voice *voice)
+{
+	if (voice->current_frequency != voice->desired_frequency){
+		// dynamic change rate dependant on the distance between the old and new note.
+		double frequency_change_rate = fabs(voice->current_frequency - voice->desired_frequency) / 5;
+		// set playing frequency to desired if below threshold
+		// to avoid weird oscillation
+		if (frequency_change_rate <= 5){
+			voice->current_frequency = voice->desired_frequency;
+		}
+		else if (voice->current_frequency < voice->desired_frequency){
+			voice->current_frequency += frequency_change_rate;
+		}
+		else{
+			voice->current_frequency -= frequency_change_rate;
+		}
+	}
+}
+
+// Gets one sample of a waveform at the given phase, or the noise sample for the noise waveform
+static double wave_sample(enum SineMixerWaveform waveform, double phase, double *decay_level, double noise)
+{
+	switch (waveform){
 
-			case SINEMIXER_WAVE_SQUARE:
-				sample = squareWave(phase);
-				break;
+		case SINEMIXER_WAVE_SINE:
+			return sin(phase);
 
-			case SINEMIXER_WAVE_TRIANGLE:
-				sample = triangleWave(phase);
-				break;
+		case SINEMIXER_WAVE_SQUARE:
+			return squareWave(phase);
 
-			case SINEMIXER_WAVE_SAWTOOTH:
-				sample = sawtoothWave(phase);
-				break;
+		case SINEMIXER_WAVE_TRIANGLE:
+			return triangleWave(phase);
 
-			case SINEMIXER_WAVE_STAIRS:
-				sample = stairWave(phase);
-				break;
+		case SINEMIXER_WAVE_SAWTOOTH:
+			return sawtoothWave(phase);
 
-			case SINEMIXER_WAVE_RECTIFIED_SINE:
-				sample = rectifiedSineWave(phase);
-				break;
+		case SINEMIXER_WAVE_STAIRS:
+			return stairWave(phase);
 
-			case SINEMIXER_WAVE_DECAYING_SINE:
-				sample = decayingSineWave(phase);
-				break;
+		case SINEMIXER_WAVE_RECTIFIED_SINE:
+			return rectifiedSineWave(phase);
 
-			default:
-				sample = 0;
-				break;
-		}
+		case SINEMIXER_WAVE_DECAYING_SINE:
+			return decayingSineWave(phase, decay_level);
 
-		buff[i] = (short)(sample * 32767);
-		phase += phase_increment;
+		case SINEMIXER_WAVE_NOISE:
+			return noise;
 
+		default:
+			return 0;
+	}
+}
+
+// Adds a voice's waveform into the mix buffer, continuing from its phase. The level
+// follows the voice's envelope, the frequency ramps from the one the last buffer
+// ended on, and the pitch and the morph into the next waveform follow the modulation.
+static void render_voice(int voice, double freq, enum SineMixerWaveform waveform, int size)
+{
+	const double *pitch_ratios = modulation_get_buffer(MODULATION_DEST_PITCH);
+	const double *morphs = modulation_get_buffer(MODULATION_DEST_WAVEFORM_MORPH);
+	enum SineMixerWaveform next_waveform = (waveform + 1) % SINEMIXER_WAVE_COUNT;
+	envelope_render(&voice_envelopes[voice], envelope_buffer, size);
+
+	// Noise is drawn a block at a time from the playback thread's own generator
+	if (waveform == SINEMIXER_WAVE_NOISE || next_waveform == SINEMIXER_WAVE_NOISE){
+		noise_fill(noise_thread_generator(), noise_buffer, size);
+	}
+
+	double phase = voice_phase[voice];
+	double *decay_level = &voice_decay_level[voice];
+	double start_freq = voice_rendered_frequency[voice] > 0 ? voice_rendered_frequency[voice] : freq;
+	double phase_increment = 2.0 * PI * start_freq / SAMPLE_RATE;
+	double increment_step = 2.0 * PI * (freq - start_freq) / SAMPLE_RATE / size;
+
+	for (int i = 0; i < size; i++){
+		// Both waveforms are always computed, so the cost does not depend on the morph
+		double from = wave_sample(waveform, phase, decay_level, noise_buffer[i]);
+		double to = wave_sample(next_waveform, phase, decay_level, noise_buffer[i]);
+		mix_buffer[i] += (from + (to - from) * morphs[i]) * envelope_buffer[i];
+
+		phase_increment += increment_step;
+		phase += phase_increment * pitch_ratios[i];
 		if (phase >= 2.0 * PI){
 			phase -= 2.0 * PI;
 		}
 	}
+	voice_phase[voice] = phase;
+	voice_rendered_frequency[voice] = freq;
 }
 
 // Thread function that continuously plays audio
@@ -328,23 +557,6 @@ static void *playbackThread(void *_arg)
 {
 	(void)_arg;
 	while (!stopping){
-		// incrememt current freq to desired freq
-		if (current_frequency != desired_frequency){
-			// dynamic change rate dependant on the distance between the old and new note.
-			frequency_change_rate = fabs(current_frequency - desired_frequency) / 5;
-			// set playing frequency to desired if below threshold
-			// to avoid weird oscillation
-			if (frequency_change_rate <= 5){
-				current_frequency = desired_frequency;
-			}
-			else if (current_frequency < desired_frequency){
-				current_frequency += frequency_change_rate;
-			}
-			else{
-				current_frequency -= frequency_change_rate;
-			}
-		}
-
 		fillplayback_buffer(playback_buffer, playback_buffer_size);
 		snd_pcm_sframes_t frames = snd_pcm_writei(handle,
 												  playback_buffer, playback_buffer_size);
@@ -178,6 +178,32 @@ void DEV_SPI_Write_nByte(uint8_t *pData, uint32_t Len)
 #endif
 }
 
+/**
+ * Write several buffers as one SPI message, at most DEV_SPI_MAX_MESSAGE bytes
+**/
+void DEV_SPI_Writev(const struct iovec *pSegs, int Count)
+{
+#ifdef USE_DEV_LIB 
+    lgSpiWritev(SPI_Handle, pSegs, Count);
+#endif
+}
+
+/**
+ * Send a panel command and its parameters, with DC low for the command
+ * and high for the parameters. Leaves DC low when there are none.
+**/
+void DEV_SPI_WriteCommand(UBYTE Reg, const UBYTE *pParams, UDOUBLE Len)
+{
+#ifdef USE_DEV_LIB 
+    DEV_Digital_Write(LCD_DC, 0);
+    lgSpiWrite(SPI_Handle, (char*)&Reg, 1);
+    if (Len > 0) {
+        DEV_Digital_Write(LCD_DC, 1);
+        lgSpiWrite(SPI_Handle, (const char*)pParams, Len);
+    }
+#endif
+}
+
 void DEV_ModuleExit(void)
 {
 #ifdef USE_DEV_LIB 
@@ -30,6 +30,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
+#include <sys/uio.h>
 
 /**
  * Data types
@@ -57,6 +58,9 @@ Define the pin constants to match those in DEV_Config.c
 #define LCD_BL_0        DEV_Digital_Write(LCD_BL, 0)
 #define LCD_BL_1        DEV_Digital_Write(LCD_BL, 1)
 
+// Most one SPI message can carry, the spidev bufsiz default
+#define DEV_SPI_MAX_MESSAGE 4096
+
 // Backlight control
 #define LCD_SetBacklight(Value) DEV_SetBacklight(Value)
 
@@ -71,6 +75,8 @@ void DEV_Delay_ms(UDOUBLE xms);
 
 void DEV_SPI_WriteByte(UBYTE Value);
 void DEV_SPI_Write_nByte(uint8_t *pData, uint32_t Len);
+void DEV_SPI_Writev(const struct iovec *pSegs, int Count);
+void DEV_SPI_WriteCommand(UBYTE Reg, const UBYTE *pParams, UDOUBLE Len);
 void DEV_SetBacklight(UWORD Value);
 
 #endif
@@ -95,13 +95,13 @@ UBYTE GUI_ReadBmp(const char *path)
 				//ARGB4444 format cannot be recognized for the time being. It can only be used to identify RGB565 format information!!
 				if(bmpInfoHeader.bInfoSize==0x38)
 				{	
-					Paint_SetPixel(col, bmpInfoHeader.bHeight - row - 1, data);
+					Paint_SetPixel(col, bmpInfoHeader.bHeight - row - 1, PAINT_COLOR(data));
 				}
 				//Used to identify the XRGB1555 format
 				else if((bmpInfoHeader.bInfoSize==0x28)&&(bmpInfoHeader.bCompression==0x00))
 				{
 					data=((((long)((data>>5)&0x1f)*0X3F)/0X1F)<<5)+(data&0x1f)+((data&0xEC00)<<1);
-					Paint_SetPixel(col, bmpInfoHeader.bHeight - row - 1, data);
+					Paint_SetPixel(col, bmpInfoHeader.bHeight - row - 1, PAINT_COLOR(data));
 				}
 				col++;
 			}
@@ -115,7 +115,7 @@ UBYTE GUI_ReadBmp(const char *path)
 					break;
 				}
 				data = RGB((argb.rgbRed), (argb.rgbGreen), (argb.rgbBlue));
-				Paint_SetPixel(col, bmpInfoHeader.bHeight - row - 1, data);
+				Paint_SetPixel(col, bmpInfoHeader.bHeight - row - 1, PAINT_COLOR(data));
 				col++;
 			}	
 			//bBitCount<8 format
@@ -138,7 +138,7 @@ UBYTE GUI_ReadBmp(const char *path)
 					}
 					else {data=pixels;}
 					data=RGB((RGBPAD[data].rgbRed), (RGBPAD[data].rgbGreen), (RGBPAD[data].rgbBlue));					
-					Paint_SetPixel(col, bmpInfoHeader.bHeight - row - 1, data);
+					Paint_SetPixel(col, bmpInfoHeader.bHeight - row - 1, PAINT_COLOR(data));
 				}				
 			}	
 		}
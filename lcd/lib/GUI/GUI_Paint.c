@@ -43,6 +43,10 @@
 
 PAINT Paint;
 
+static UBYTE Paint_MemoryPoint(UWORD Xpoint, UWORD Ypoint, UWORD *X, UWORD *Y);
+static void Paint_FillRun(UWORD *Run, UDOUBLE Count, UWORD Color);
+static void Paint_FillWindow(int Xstart, int Ystart, int Xend, int Yend, UWORD Color);
+
 /******************************************************************************
 function: Create Image
 parameter:
@@ -131,7 +135,7 @@ function: Draw Pixels
 parameter:
     Xpoint : At point X
     Ypoint : At point Y
-    Color  : Painted colors
+    Color  : Painted colors, in panel byte order
 ******************************************************************************/
 void Paint_SetPixel(UWORD Xpoint, UWORD Ypoint, UWORD Color)
 {
@@ -141,62 +145,145 @@ void Paint_SetPixel(UWORD Xpoint, UWORD Ypoint, UWORD Color)
     }      
     UWORD X, Y;
 
+    if(!Paint_MemoryPoint(Xpoint, Ypoint, &X, &Y))
+        return;
+
+    if(X > Paint.WidthMemory || Y > Paint.HeightMemory){
+        DEBUG("Exceeding display boundaries\r\n");
+        return;
+    }
+    
+    
+    if(Paint.Depth == 1){
+        UDOUBLE Addr = X / 8 + Y * Paint.WidthByte;
+        UBYTE Rdata = Paint.Image[Addr];
+        if(Color == BLACK)
+            Paint.Image[Addr] = Rdata & ~(0x80 >> (X % 8));
+        else
+            Paint.Image[Addr] = Rdata | (0x80 >> (X % 8));
+    } else {
+        UDOUBLE Addr = X  + Y * Paint.WidthByte;
+        Paint.Image[Addr] = Color;
+    }
+}
+
+/******************************************************************************
+function: Find where a point of the picture is in the image cache
+parameter:
+    Xpoint : At point X
+    Ypoint : At point Y
+    X      : Column of the image cache
+    Y      : Row of the image cache
+return: 0 if the rotation or mirroring is not valid
+******************************************************************************/
+static UBYTE Paint_MemoryPoint(UWORD Xpoint, UWORD Ypoint, UWORD *X, UWORD *Y)
+{
     switch(Paint.Rotate) {
     case 0:
-        X = Xpoint;
-        Y = Ypoint;  
+        *X = Xpoint;
+        *Y = Ypoint;  
         break;
     case 90:
-        X = Paint.WidthMemory - Ypoint - 1;
-        Y = Xpoint;
+        *X = Paint.WidthMemory - Ypoint - 1;
+        *Y = Xpoint;
         break;
     case 180:
-        X = Paint.WidthMemory - Xpoint - 1;
-        Y = Paint.HeightMemory - Ypoint - 1;
+        *X = Paint.WidthMemory - Xpoint - 1;
+        *Y = Paint.HeightMemory - Ypoint - 1;
         break;
     case 270:
-        X = Ypoint;
-        Y = Paint.HeightMemory - Xpoint - 1;
+        *X = Ypoint;
+        *Y = Paint.HeightMemory - Xpoint - 1;
         break;
     default:
-        return;
+        return 0;
     }
     
     switch(Paint.Mirror) {
     case MIRROR_NONE:
         break;
     case MIRROR_HORIZONTAL:
-        X = Paint.WidthMemory - X - 1;
+        *X = Paint.WidthMemory - *X - 1;
         break;
     case MIRROR_VERTICAL:
-        Y = Paint.HeightMemory - Y - 1;
+        *Y = Paint.HeightMemory - *Y - 1;
         break;
     case MIRROR_ORIGIN:
-        X = Paint.WidthMemory - X - 1;
-        Y = Paint.HeightMemory - Y - 1;
+        *X = Paint.WidthMemory - *X - 1;
+        *Y = Paint.HeightMemory - *Y - 1;
         break;
     default:
-        return;
+        return 0;
     }
+    return 1;
+}
 
-    if(X > Paint.WidthMemory || Y > Paint.HeightMemory){
-        DEBUG("Exceeding display boundaries\r\n");
-        return;
+/******************************************************************************
+function: Fill a run of pixels of the image cache
+parameter:
+    Run   : First pixel of the run
+    Count : Number of pixels
+    Color : Painted colors, in panel byte order
+******************************************************************************/
+static void Paint_FillRun(UWORD *Run, UDOUBLE Count, UWORD Color)
+{
+    // One pixel at a time up to an 8 byte boundary, then four to a store
+    while(Count > 0 && ((uintptr_t)Run & 7) != 0) {
+        *Run++ = Color;
+        Count--;
     }
-    
-    
-    if(Paint.Depth == 1){
-        UDOUBLE Addr = X / 8 + Y * Paint.WidthByte;
-        UBYTE Rdata = Paint.Image[Addr];
-        if(Color == BLACK)
-            Paint.Image[Addr] = Rdata & ~(0x80 >> (X % 8));
-        else
-            Paint.Image[Addr] = Rdata | (0x80 >> (X % 8));
-    } else {
-        Color = ((Color<<8)&0xff00)|(Color>>8);
-        UDOUBLE Addr = X  + Y * Paint.WidthByte;
-        Paint.Image[Addr] = Color;
+    uint64_t Pattern = Color * 0x0001000100010001ULL;
+    for(; Count >= 4; Count -= 4, Run += 4) {
+        memcpy(Run, &Pattern, sizeof(Pattern));
+    }
+    while(Count > 0) {
+        *Run++ = Color;
+        Count--;
+    }
+}
+
+/******************************************************************************
+function: Fill a window of the picture, clipped to the picture
+parameter:
+    Xstart : x starting point
+    Ystart : Y starting point
+    Xend   : x end point, not filled
+    Yend   : y end point, not filled
+    Color  : Painted colors, in panel byte order
+******************************************************************************/
+static void Paint_FillWindow(int Xstart, int Ystart, int Xend, int Yend, UWORD Color)
+{
+    if(Xstart < 0)
+        Xstart = 0;
+    if(Ystart < 0)
+        Ystart = 0;
+    if(Xend > Paint.Width)
+        Xend = Paint.Width;
+    if(Yend > Paint.Height)
+        Yend = Paint.Height;
+    if(Xstart >= Xend || Ystart >= Yend)
+        return;
+
+    if(Paint.Depth == 1) {
+        for(int Y = Ystart; Y < Yend; Y++) {
+            for(int X = Xstart; X < Xend; X++)
+                Paint_SetPixel(X, Y, Color);
+        }
+        return;
     }
+
+    // The window stays a rectangle in the image cache whatever the rotation,
+    // so it is filled a row of the cache at a time
+    UWORD X0, Y0, X1, Y1;
+    if(!Paint_MemoryPoint(Xstart, Ystart, &X0, &Y0) ||
+       !Paint_MemoryPoint(Xend - 1, Yend - 1, &X1, &Y1))
+        return;
+    UWORD Left = X0 < X1 ? X0 : X1;
+    UWORD Top = Y0 < Y1 ? Y0 : Y1;
+    UWORD Right = X0 < X1 ? X1 : X0;
+    UWORD Bottom = Y0 < Y1 ? Y1 : Y0;
+    for(UWORD Y = Top; Y <= Bottom; Y++)
+        Paint_FillRun(Paint.Image + Left + (UDOUBLE)Y * Paint.WidthByte, Right - Left + 1, Color);
 }
 
 /******************************************************************************
@@ -206,12 +293,7 @@ parameter:
 ******************************************************************************/
 void Paint_Clear(UWORD Color)
 {
-    for (UWORD Y = 0; Y < Paint.HeightByte; Y++) {
-        for (UWORD X = 0; X < Paint.WidthByte; X++ ) {//8 pixel =  1 byte
-            UDOUBLE Addr = X + Y*Paint.WidthByte;
-            Paint.Image[Addr] = Color;
-        }
-    }
+    Paint_FillRun(Paint.Image, (UDOUBLE)Paint.WidthByte * Paint.HeightByte, Color);
 }
 
 /******************************************************************************
@@ -225,12 +307,7 @@ parameter:
 ******************************************************************************/
 void Paint_ClearWindow(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD Color)
 {
-    UWORD X, Y;
-    for (Y = Ystart; Y < Yend; Y++) {
-        for (X = Xstart; X < Xend; X++) {//8 pixel =  1 byte
-            Paint_SetPixel(X, Y, Color);
-        }
-    }
+    Paint_FillWindow(Xstart, Ystart, Xend, Yend, Color);
 }
 
 /******************************************************************************
@@ -351,9 +428,13 @@ void Paint_DrawRectangle(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend,
     }
 
     if (Draw_Fill) {
-        UWORD Ypoint;
-        for(Ypoint = Ystart; Ypoint < Yend; Ypoint++) {
-            Paint_DrawLine(Xstart, Ypoint, Xend, Ypoint, Color , Line_width, LINE_STYLE_SOLID);
+        // The same pixels as a line from Xstart to Xend on each row from Ystart
+        // up to Yend, whose points cover Line_width before to Line_width - 2 after
+        if (Ystart < Yend) {
+            UWORD Xmin = Xstart < Xend ? Xstart : Xend;
+            UWORD Xmax = Xstart < Xend ? Xend : Xstart;
+            Paint_FillWindow(Xmin - Line_width, Ystart - Line_width,
+                             Xmax + Line_width - 1, Yend + Line_width - 2, Color);
         }
     } else {
         Paint_DrawLine(Xstart, Ystart, Xend, Ystart, Color, Line_width, LINE_STYLE_SOLID);
@@ -731,7 +812,7 @@ void Paint_DrawImage(const unsigned char *image, UWORD xStart, UWORD yStart, UWO
 		for(j = 0; j < H_Image; j++){
 			for(i = 0; i < W_Image; i++){
 				if(xStart+i < Paint.WidthMemory  &&  yStart+j < Paint.HeightMemory)//Exceeded part does not display
-					Paint_SetPixel(xStart + i, yStart + j, (*(image + j*W_Image*2 + i*2+1))<<8 | (*(image + j*W_Image*2 + i*2)));
+					Paint_SetPixel(xStart + i, yStart + j, PAINT_COLOR((*(image + j*W_Image*2 + i*2+1))<<8 | (*(image + j*W_Image*2 + i*2))));
 				//Using arrays is a property of sequential storage, accessing the original array by algorithm
 				//j*W_Image*2 			   Y offset
 				//i*2              	   X offset
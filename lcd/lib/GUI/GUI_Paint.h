@@ -68,21 +68,27 @@ extern PAINT Paint;
 
 /**
  * image color
+ * The image holds RGB565 pixels in the byte order the panel takes them,
+ * high byte first, so it can be sent as it is. Colors given to the paint
+ * functions are in that order too; PAINT_COLOR swaps an RGB565 value into
+ * it, at compile time for constants.
 **/
-#define WHITE          0xFFFF
-#define BLACK          0x0000
-#define BLUE           0x001F
-#define BRED           0XF81F
-#define GRED 		   0XFFE0
-#define GBLUE		   0X07FF
-#define RED            0xF800
-#define MAGENTA        0xF81F
-#define GREEN          0x07E0
-#define CYAN           0x7FFF
-#define YELLOW         0xFFE0
-#define BROWN 		   0XBC40
-#define BRRED 		   0XFC07
-#define GRAY  		   0X8430
+#define PAINT_COLOR(Rgb565)  ((UWORD)((((Rgb565) << 8) & 0xFF00) | (((Rgb565) >> 8) & 0x00FF)))
+
+#define WHITE          PAINT_COLOR(0xFFFF)
+#define BLACK          PAINT_COLOR(0x0000)
+#define BLUE           PAINT_COLOR(0x001F)
+#define BRED           PAINT_COLOR(0XF81F)
+#define GRED 		   PAINT_COLOR(0XFFE0)
+#define GBLUE		   PAINT_COLOR(0X07FF)
+#define RED            PAINT_COLOR(0xF800)
+#define MAGENTA        PAINT_COLOR(0xF81F)
+#define GREEN          PAINT_COLOR(0x07E0)
+#define CYAN           PAINT_COLOR(0x7FFF)
+#define YELLOW         PAINT_COLOR(0xFFE0)
+#define BROWN 		   PAINT_COLOR(0XBC40)
+#define BRRED 		   PAINT_COLOR(0XFC07)
+#define GRAY  		   PAINT_COLOR(0X8430)
 
 #define IMAGE_BACKGROUND    WHITE
 #define FONT_FOREGROUND     BLACK
@@ -23,26 +23,29 @@ LCD_1IN54_ATTRIBUTES LCD_1IN54;
 /******************************************************************************
 function :	Hardware reset
 parameter:
+info     :  The panel needs a reset pulse of 10us and then 120ms before
+            it takes Sleep Out, so these are already generous
 ******************************************************************************/
 static void LCD_1IN54_Reset(void)
 {
     LCD_1IN54_RST_1;
-    DEV_Delay_ms(100);
+    DEV_Delay_ms(10);
     LCD_1IN54_RST_0;
-    DEV_Delay_ms(100);
+    DEV_Delay_ms(10);
     LCD_1IN54_RST_1;
-    DEV_Delay_ms(100);
+    DEV_Delay_ms(120);
 }
 
 /******************************************************************************
 function :	send command
 parameter:
-     Reg : Command register
+     Reg    : Command register
+     Params : Parameters of the command
+     Len    : Number of parameters
 ******************************************************************************/
-static void LCD_1IN54_SendCommand(UBYTE Reg)
+static void LCD_1IN54_SendCommand(UBYTE Reg, const UBYTE *Params, UDOUBLE Len)
 {
-    LCD_1IN54_DC_0;
-    DEV_SPI_WriteByte(Reg);
+    DEV_SPI_WriteCommand(Reg, Params, Len);
 }
 
 /******************************************************************************
@@ -50,100 +53,92 @@ function :	send data
 parameter:
     Data : Write data
 ******************************************************************************/
-static void LCD_1IN54_SendData_8Bit(UBYTE Data)
+static void LCD_1IN54_SendData_16Bit(UWORD Data)
 {
+    UBYTE Bytes[2] = {(Data >> 8) & 0xFF, Data & 0xFF};
+
     LCD_1IN54_DC_1;
-    DEV_SPI_WriteByte(Data);
+    DEV_SPI_Write_nByte(Bytes, 2);
 }
 
 /******************************************************************************
-function :	send data
+function :	Send rows of an image, gathering as many as fit into each message
 parameter:
-    Data : Write data
+    Row    : First pixel of the first row
+    Width  : Pixels in each row
+    Stride : Pixels from one row to the next, 0 to send the same row again
+    Rows   : Number of rows
 ******************************************************************************/
-static void LCD_1IN54_SendData_16Bit(UWORD Data)
+static void LCD_1IN54_SendRows(UWORD *Row, UWORD Width, UWORD Stride, UWORD Rows)
 {
+    struct iovec Segs[LCD_1IN54_HEIGHT];
+    UDOUBLE RowsPerMessage, Count, Segments, j, k;
+
+    if (Width == 0 || Rows == 0) {
+        return;
+    }
+    RowsPerMessage = DEV_SPI_MAX_MESSAGE / (Width * 2);
+    if (RowsPerMessage < 1) {
+        RowsPerMessage = 1;
+    }
+    if (RowsPerMessage > LCD_1IN54_HEIGHT) {
+        RowsPerMessage = LCD_1IN54_HEIGHT;
+    }
+
     LCD_1IN54_DC_1;
-    DEV_SPI_WriteByte((Data >> 8) & 0xFF);
-    DEV_SPI_WriteByte(Data & 0xFF);
+    for (j = 0; j < Rows; j += Count) {
+        Count = Rows - j < RowsPerMessage ? Rows - j : RowsPerMessage;
+
+        // Rows next to each other in memory go as a single segment
+        if (Stride == Width) {
+            Segs[0].iov_base = Row + j * Stride;
+            Segs[0].iov_len = Count * Width * 2;
+            Segments = 1;
+        } else {
+            for (k = 0; k < Count; k++) {
+                Segs[k].iov_base = Row + (j + k) * Stride;
+                Segs[k].iov_len = Width * 2;
+            }
+            Segments = Count;
+        }
+        DEV_SPI_Writev(Segs, Segments);
+    }
 }
 
+// Initialization registers, each as the command, its number of parameters and then the parameters
+static const UBYTE LCD_1IN54_InitSequence[] = {
+    0x3A, 1, 0x05,
+    0xB2, 5, 0x0C, 0x0C, 0x00, 0x33, 0x33,
+    0xB7, 1, 0x35,                          //Gate Control
+    0xBB, 1, 0x19,                          //VCOM Setting
+    0xC0, 1, 0x2C,                          //LCM Control
+    0xC2, 1, 0x01,                          //VDV and VRH Command Enable
+    0xC3, 1, 0x12,                          //VRH Set
+    0xC4, 1, 0x20,                          //VDV Set
+    0xC6, 1, 0x0F,                          //Frame Rate Control in Normal Mode
+    0xD0, 2, 0xA4, 0xA1,                    // Power Control 1
+    0xE0, 14, 0xD0, 0x04, 0x0D, 0x11, 0x13, 0x2B, 0x3F,
+              0x54, 0x4C, 0x18, 0x0D, 0x0B, 0x1F, 0x23, //Positive Voltage Gamma Control
+    0xE1, 14, 0xD0, 0x04, 0x0C, 0x11, 0x13, 0x2C, 0x3F,
+              0x44, 0x51, 0x2F, 0x1F, 0x1F, 0x20, 0x23, //Negative Voltage Gamma Control
+    0x21, 0,                                //Display Inversion On
+    0x11, 0,                                //Sleep Out
+    0x29, 0,                                //Display On
+};
+
 /******************************************************************************
 function :	Initialize the lcd register
 parameter:
 ******************************************************************************/
 static void LCD_1IN54_InitReg(void)
 {
-    LCD_1IN54_SendCommand(0x3A);
-    LCD_1IN54_SendData_8Bit(0x05);
-
-    LCD_1IN54_SendCommand(0xB2);
-    LCD_1IN54_SendData_8Bit(0x0C);
-    LCD_1IN54_SendData_8Bit(0x0C);
-    LCD_1IN54_SendData_8Bit(0x00);
-    LCD_1IN54_SendData_8Bit(0x33);
-    LCD_1IN54_SendData_8Bit(0x33);
-
-    LCD_1IN54_SendCommand(0xB7);  //Gate Control
-    LCD_1IN54_SendData_8Bit(0x35);
-
-    LCD_1IN54_SendCommand(0xBB);  //VCOM Setting
-    LCD_1IN54_SendData_8Bit(0x19);
-
-    LCD_1IN54_SendCommand(0xC0); //LCM Control     
-    LCD_1IN54_SendData_8Bit(0x2C);
-
-    LCD_1IN54_SendCommand(0xC2);  //VDV and VRH Command Enable
-    LCD_1IN54_SendData_8Bit(0x01);
-    LCD_1IN54_SendCommand(0xC3);  //VRH Set
-    LCD_1IN54_SendData_8Bit(0x12);
-    LCD_1IN54_SendCommand(0xC4);  //VDV Set
-    LCD_1IN54_SendData_8Bit(0x20);
+    UDOUBLE i = 0;
 
-    LCD_1IN54_SendCommand(0xC6);  //Frame Rate Control in Normal Mode
-    LCD_1IN54_SendData_8Bit(0x0F);
-    
-    LCD_1IN54_SendCommand(0xD0);  // Power Control 1
-    LCD_1IN54_SendData_8Bit(0xA4);
-    LCD_1IN54_SendData_8Bit(0xA1);
-
-    LCD_1IN54_SendCommand(0xE0);  //Positive Voltage Gamma Control
-    LCD_1IN54_SendData_8Bit(0xD0);
-    LCD_1IN54_SendData_8Bit(0x04);
-    LCD_1IN54_SendData_8Bit(0x0D);
-    LCD_1IN54_SendData_8Bit(0x11);
-    LCD_1IN54_SendData_8Bit(0x13);
-    LCD_1IN54_SendData_8Bit(0x2B);
-    LCD_1IN54_SendData_8Bit(0x3F);
-    LCD_1IN54_SendData_8Bit(0x54);
-    LCD_1IN54_SendData_8Bit(0x4C);
-    LCD_1IN54_SendData_8Bit(0x18);
-    LCD_1IN54_SendData_8Bit(0x0D);
-    LCD_1IN54_SendData_8Bit(0x0B);
-    LCD_1IN54_SendData_8Bit(0x1F);
-    LCD_1IN54_SendData_8Bit(0x23);
-
-    LCD_1IN54_SendCommand(0xE1);  //Negative Voltage Gamma Control
-    LCD_1IN54_SendData_8Bit(0xD0);
-    LCD_1IN54_SendData_8Bit(0x04);
-    LCD_1IN54_SendData_8Bit(0x0C);
-    LCD_1IN54_SendData_8Bit(0x11);
-    LCD_1IN54_SendData_8Bit(0x13);
-    LCD_1IN54_SendData_8Bit(0x2C);
-    LCD_1IN54_SendData_8Bit(0x3F);
-    LCD_1IN54_SendData_8Bit(0x44);
-    LCD_1IN54_SendData_8Bit(0x51);
-    LCD_1IN54_SendData_8Bit(0x2F);
-    LCD_1IN54_SendData_8Bit(0x1F);
-    LCD_1IN54_SendData_8Bit(0x1F);
-    LCD_1IN54_SendData_8Bit(0x20);
-    LCD_1IN54_SendData_8Bit(0x23);
-
-    LCD_1IN54_SendCommand(0x21);  //Display Inversion On
-
-    LCD_1IN54_SendCommand(0x11);  //Sleep Out
-
-    LCD_1IN54_SendCommand(0x29);  //Display On
+    while (i < sizeof(LCD_1IN54_InitSequence)) {
+        UBYTE Len = LCD_1IN54_InitSequence[i + 1];
+        LCD_1IN54_SendCommand(LCD_1IN54_InitSequence[i], &LCD_1IN54_InitSequence[i + 2], Len);
+        i += 2 + Len;
+    }
 }
 
 /********************************************************************************
@@ -169,8 +164,7 @@ static void LCD_1IN54_SetAttributes(UBYTE Scan_dir)
     }
 
     // Set the read / write scan direction of the frame memory
-    LCD_1IN54_SendCommand(0x36); //MX, MY, RGB mode
-    LCD_1IN54_SendData_8Bit(MemoryAccessReg);	//0x08 set RGB
+    LCD_1IN54_SendCommand(0x36, &MemoryAccessReg, 1); //MX, MY, RGB mode, 0x08 set RGB
 }
 
 /********************************************************************************
@@ -203,42 +197,33 @@ parameter:
 void LCD_1IN54_SetWindows(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend)
 {
     //set the X coordinates
-    LCD_1IN54_SendCommand(0x2A);
-    LCD_1IN54_SendData_8Bit((Xstart >> 8) & 0xFF);
-    LCD_1IN54_SendData_8Bit(Xstart & 0xFF);
-    LCD_1IN54_SendData_8Bit(((Xend  - 1) >> 8) & 0xFF);
-    LCD_1IN54_SendData_8Bit((Xend  - 1) & 0xFF);
+    UBYTE Columns[4] = {(Xstart >> 8) & 0xFF, Xstart & 0xFF, ((Xend  - 1) >> 8) & 0xFF, (Xend  - 1) & 0xFF};
+    LCD_1IN54_SendCommand(0x2A, Columns, 4);
 
     //set the Y coordinates
-    LCD_1IN54_SendCommand(0x2B);
-    LCD_1IN54_SendData_8Bit((Ystart >> 8) & 0xFF);
-    LCD_1IN54_SendData_8Bit(Ystart & 0xFF);
-    LCD_1IN54_SendData_8Bit(((Yend  - 1) >> 8) & 0xFF);
-    LCD_1IN54_SendData_8Bit((Yend  - 1) & 0xFF);
+    UBYTE Rows[4] = {(Ystart >> 8) & 0xFF, Ystart & 0xFF, ((Yend  - 1) >> 8) & 0xFF, (Yend  - 1) & 0xFF};
+    LCD_1IN54_SendCommand(0x2B, Rows, 4);
 
-    LCD_1IN54_SendCommand(0X2C);
+    LCD_1IN54_SendCommand(0X2C, NULL, 0);
 }
 
 /******************************************************************************
 function :	Clear screen
 parameter:
+    Color : in panel byte order, as the colors of GUI_Paint.h
 ******************************************************************************/
 void LCD_1IN54_Clear(UWORD Color)
 {
     UWORD j;
-    UWORD Image[LCD_1IN54_WIDTH*LCD_1IN54_HEIGHT];
-    
-    Color = ((Color<<8)&0xff00)|(Color>>8);
+    UWORD Row[LCD_1IN54_WIDTH];
    
-    for (j = 0; j < LCD_1IN54_HEIGHT*LCD_1IN54_WIDTH; j++) {
-        Image[j] = Color;
+    for (j = 0; j < LCD_1IN54_WIDTH; j++) {
+        Row[j] = Color;
     }
     
+    // Every row is the same, so each message repeats the one row
     LCD_1IN54_SetWindows(0, 0, LCD_1IN54_WIDTH, LCD_1IN54_HEIGHT);
-    LCD_1IN54_DC_1;
-    for(j = 0; j < LCD_1IN54_HEIGHT; j++){
-        DEV_SPI_Write_nByte((uint8_t *)&Image[j*LCD_1IN54_WIDTH], LCD_1IN54_WIDTH*2);
-    }
+    LCD_1IN54_SendRows(Row, LCD_1IN54_WIDTH, 0, LCD_1IN54_HEIGHT);
 }
 
 /******************************************************************************
@@ -247,25 +232,16 @@ parameter:
 ******************************************************************************/
 void LCD_1IN54_Display(UWORD *Image)
 {
-    UWORD j;
     LCD_1IN54_SetWindows(0, 0, LCD_1IN54_WIDTH, LCD_1IN54_HEIGHT);
-    LCD_1IN54_DC_1;
-    for (j = 0; j < LCD_1IN54_HEIGHT; j++) {
-        DEV_SPI_Write_nByte((uint8_t *)&Image[j*LCD_1IN54_WIDTH], LCD_1IN54_WIDTH*2);
-    }
+    LCD_1IN54_SendRows(Image, LCD_1IN54_WIDTH, LCD_1IN54_WIDTH, LCD_1IN54_HEIGHT);
 }
 
 void LCD_1IN54_DisplayWindows(UWORD Xstart, UWORD Ystart, UWORD Xend, UWORD Yend, UWORD *Image)
 {
-    // display
-    UDOUBLE Addr = 0;
-
-    UWORD j;
+    // display, the rows are a stride apart in the image
     LCD_1IN54_SetWindows(Xstart, Ystart, Xend , Yend);
-    LCD_1IN54_DC_1;
-    for (j = Ystart; j < Yend - 1; j++) {
-        Addr = Xstart + j * LCD_1IN54_WIDTH ;
-        DEV_SPI_Write_nByte((uint8_t *)&Image[Addr], (Xend-Xstart)*2);
+    if (Yend > Ystart + 1) {
+        LCD_1IN54_SendRows(&Image[Xstart + Ystart * LCD_1IN54_WIDTH], Xend - Xstart, LCD_1IN54_WIDTH, Yend - 1 - Ystart);
     }
 }
 
@@ -36,6 +36,15 @@ For more information, please refer to <http://unlicense.org/>
 #define CMD_MAX_PARAM 512
 #define CMD_MAX_EXTENSION (1<<16)
 
+/*
+A batch message's extension holds whole command messages, each
+padded so the next header and its 64 bit arguments stay aligned.
+The reply's extension holds the replies framed the same way.
+*/
+#define CMD_BATCH_ALIGN 8
+#define CMD_BATCH_PAD(size) \
+   (((size) + CMD_BATCH_ALIGN - 1) & ~(CMD_BATCH_ALIGN - 1))
+
 #define CMD_UNKNOWN_CMD   -1
 #define CMD_BAD_PARAMETER -2
 #define CMD_EXT_TOO_SMALL -3
@@ -34,6 +34,10 @@ For more information, please refer to <http://unlicense.org/>
 
 static pthread_key_t slgGlobalKey;
 
+/* every handle lookup asks for the context, so keep it to hand */
+
+static __thread lgCtx_p xCtx = NULL;
+
 static pthread_once_t xInited = PTHREAD_ONCE_INIT;
 
 static void xInit(void)
@@ -46,6 +50,8 @@ lgCtx_p lgCtxGet(void)
 {
    lgCtx_p ctx;
 
+   if (xCtx != NULL) return xCtx;
+
    pthread_once(&xInited, xInit);
 
    LG_DBG(LG_DEBUG_ALLOC, "thread=%llu", (long long int)pthread_self());
@@ -65,8 +71,21 @@ lgCtx_p lgCtxGet(void)
       }
    }
 
+   xCtx = ctx;
+
    LG_DBG(LG_DEBUG_ALLOC, "ctx=%p", ctx);
 
    return ctx;
 }
 
+void lgCtxSet(lgCtx_p ctx)
+{
+   /* lets a pooled thread act for whichever client it is serving */
+
+   pthread_once(&xInited, xInit);
+
+   pthread_setspecific(slgGlobalKey, ctx);
+
+   xCtx = ctx;
+}
+
@@ -56,6 +56,7 @@ typedef struct lgCtx_s
 } lgCtx_t, *lgCtx_p;
 
 lgCtx_p lgCtxGet(void);
+void lgCtxSet(lgCtx_p ctx);
 
 #endif
 
@@ -25,6 +25,8 @@ OTHER DEALINGS IN THE SOFTWARE.
 For more information, please refer to <http://unlicense.org/>
 */
 
+#define _GNU_SOURCE /* needed for PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP */
+
 #include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
@@ -62,15 +64,27 @@ typedef struct
    int share;              // if object can be used by non-owners
 } lgHdlHdr_t, *lgHdlHdr_p;
 
+/*
+A slot's mutex is held while its object is in use.  It is recursive
+so lgHdlFree() can take it whether or not the caller already holds it,
+and a header is only destroyed once no other thread is using it.
+
+The mutexes are initialised statically, so lookups need no
+pthread_once.
+*/
+
 typedef struct
 {
-   lgHdlHdr_p header;
+   lgHdlHdr_p header;     // published with a release store
    pthread_mutex_t mutex; // access control
 } lgHdl_t;
 
 static pthread_mutex_t slgHdlMutex = PTHREAD_MUTEX_INITIALIZER;
 
-lgHdl_t lgHdl[LG_HDL_SLOTS];
+lgHdl_t lgHdl[LG_HDL_SLOTS]=
+{
+   [0 ... LG_HDL_SLOTS-1] = {NULL, PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP}
+};
 
 static slgHdlTypeUsage_t slgHdlTypeUsage[]=
 {
@@ -82,16 +96,13 @@ static slgHdlTypeUsage_t slgHdlTypeUsage[]=
    {724133862, -1, -1}, {894093461, -1, -1}, {967000257, -1, -1},
 };
 
-static pthread_once_t xInited = PTHREAD_ONCE_INIT;
-
-static void xInit(void)
+static void xHdlDestroy(lgHdlHdr_p h)
 {
-   int i;
-   for (i=0; i<LG_HDL_SLOTS; i++)
-   {
-      lgHdl[i].header = NULL;
-      pthread_mutex_init(&lgHdl[i].mutex, NULL);
-   }
+   if (h->destructor != NULL) (h->destructor)(h->obj);
+
+   if (h->obj != NULL) free(h->obj);
+
+   free(h);
 }
 
 
@@ -110,7 +121,8 @@ static int xHdlGet(void)
    {
       if (lgHdl[i].header == LG_HDL_FREE)
       {
-         lgHdl[i].header = (void *)LG_HDL_RSVD;
+         __atomic_store_n(&lgHdl[i].header, (void *)LG_HDL_RSVD,
+            __ATOMIC_RELAXED);
 
          handle = i;
 
@@ -131,8 +143,6 @@ int lgHdlAlloc(
    lgHdlHdr_p h;
    lgCtx_p Ctx;
 
-   pthread_once(&xInited, xInit);
-
    Ctx = lgCtxGet();
 
    if (Ctx == NULL) return LG_NO_MEMORY;
@@ -145,7 +155,7 @@ int lgHdlAlloc(
 
    if (*objPtr == NULL)
    {
-      lgHdl[handle].header = (void *)LG_HDL_FREE;
+      __atomic_store_n(&lgHdl[handle].header, LG_HDL_FREE, __ATOMIC_RELEASE);
       ALLOC_ERROR(LG_NO_MEMORY, "");
    }
 
@@ -155,10 +165,21 @@ int lgHdlAlloc(
    {
       free(*objPtr);
       *objPtr = NULL;
-      lgHdl[handle].header = (void *)LG_HDL_FREE;
+      __atomic_store_n(&lgHdl[handle].header, LG_HDL_FREE, __ATOMIC_RELEASE);
       ALLOC_ERROR(LG_NO_MEMORY, "");
    }
 
+   h->magic = slgHdlTypeUsage[type].magic;
+   h->destructor = destructor;
+   h->obj = *objPtr;
+   h->type = type;
+
+   h->share = Ctx->autoSetShare;
+   h->owner = Ctx->owner;
+   strncpy(h->user, Ctx->user, LG_USER_LEN);
+
+   pthread_mutex_lock(&slgHdlMutex);
+
    last = slgHdlTypeUsage[type].last;
 
    if (last >= 0)
@@ -177,40 +198,31 @@ int lgHdlAlloc(
       slgHdlTypeUsage[type].last = handle;
    }
 
-   h->magic = slgHdlTypeUsage[type].magic;
-   h->destructor = destructor;
-   h->obj = *objPtr;
-   h->type = type;
+   // lookups read the header without the table mutex
 
-   h->share = Ctx->autoSetShare;
-   h->owner = Ctx->owner;
-   strncpy(h->user, Ctx->user, LG_USER_LEN);
+   __atomic_store_n(&lgHdl[handle].header, h, __ATOMIC_RELEASE);
 
-   lgHdl[handle].header = h;
+   pthread_mutex_unlock(&slgHdlMutex);
 
    return handle;
 }
 
 int lgHdlLock(int handle)
 {
-   pthread_once(&xInited, xInit);
-
    if ((handle < 0) || (handle >= LG_HDL_SLOTS))
       PARAM_ERROR(LG_BAD_HANDLE, "bad handle (%d)", handle);
 
-   pthread_mutex_lock(&lgHdl[handle].mutex);   
+   pthread_mutex_lock(&lgHdl[handle].mutex);
 
    return LG_OKAY;
 }
 
 int lgHdlUnlock(int handle)
 {
-   pthread_once(&xInited, xInit);
-
    if ((handle < 0) || (handle >= LG_HDL_SLOTS))
       PARAM_ERROR(LG_BAD_HANDLE, "bad handle (%d)", handle);
 
-   pthread_mutex_unlock(&lgHdl[handle].mutex);   
+   pthread_mutex_unlock(&lgHdl[handle].mutex);
 
    return LG_OKAY;
 }
@@ -219,12 +231,10 @@ int lgHdlGetObj(int handle, int type, void **objPtr)
 {
    lgHdlHdr_p h;
 
-   pthread_once(&xInited, xInit);
-
    if ((handle < 0) || (handle >= LG_HDL_SLOTS))
       PARAM_ERROR(LG_BAD_HANDLE, "bad handle (%d)", handle);
 
-   h = lgHdl[handle].header;
+   h = __atomic_load_n(&lgHdl[handle].header, __ATOMIC_ACQUIRE);
  
    if ((h == (void *)LG_HDL_FREE) || (h == (void *)LG_HDL_RSVD))
       PARAM_ERROR(LG_BAD_HANDLE, "bad handle (%d)", handle);
@@ -242,26 +252,26 @@ int lgHdlGetLockedObj(int handle, int type, void **objPtr)
    lgHdlHdr_p h;
    lgCtx_p Ctx;
 
-   pthread_once(&xInited, xInit);
-
    Ctx = lgCtxGet();
 
    if ((handle < 0) || (handle >= LG_HDL_SLOTS))
       PARAM_ERROR(LG_BAD_HANDLE, "bad handle (%d)", handle);
 
-   pthread_mutex_lock(&lgHdl[handle].mutex);   
+   pthread_mutex_lock(&lgHdl[handle].mutex);
 
-   h = lgHdl[handle].header;
+   // the header can not be destroyed while the slot mutex is held
+
+   h = __atomic_load_n(&lgHdl[handle].header, __ATOMIC_ACQUIRE);
  
    if ((h == (void *)LG_HDL_FREE) || (h == (void *)LG_HDL_RSVD))
    {
-      pthread_mutex_unlock(&lgHdl[handle].mutex);   
+      pthread_mutex_unlock(&lgHdl[handle].mutex);
       PARAM_ERROR(LG_BAD_HANDLE, "bad handle (%d)", handle);
    }
 
    if ((h->type != type) || (h->magic != slgHdlTypeUsage[type].magic))
    {
-      pthread_mutex_unlock(&lgHdl[handle].mutex);   
+      pthread_mutex_unlock(&lgHdl[handle].mutex);
       PARAM_ERROR(LG_BAD_HANDLE, "bad handle (%d)", handle);
    }
 
@@ -270,7 +280,7 @@ int lgHdlGetLockedObj(int handle, int type, void **objPtr)
         (h->share != Ctx->autoUseShare)  ||
         (strcmp(h->user, Ctx->user) != 0)))
    {
-      pthread_mutex_unlock(&lgHdl[handle].mutex);   
+      pthread_mutex_unlock(&lgHdl[handle].mutex);
       PARAM_ERROR(LG_NO_PERMISSIONS,
          "not owned or shared by user (%d)", handle);
    }
@@ -284,21 +294,19 @@ int lgHdlGetLockedObjTrusted(int handle, int type, void **objPtr)
 {
    lgHdlHdr_p h;
 
-   pthread_once(&xInited, xInit);
-
-   pthread_mutex_lock(&lgHdl[handle].mutex);   
+   pthread_mutex_lock(&lgHdl[handle].mutex);
 
-   h = lgHdl[handle].header;
+   h = __atomic_load_n(&lgHdl[handle].header, __ATOMIC_ACQUIRE);
  
    if ((h == (void *)LG_HDL_FREE) || (h == (void *)LG_HDL_RSVD))
    {
-      pthread_mutex_unlock(&lgHdl[handle].mutex);   
+      pthread_mutex_unlock(&lgHdl[handle].mutex);
       PARAM_ERROR(LG_BAD_HANDLE, "bad handle (%d)", handle);
    }
 
    if ((h->type != type) || (h->magic != slgHdlTypeUsage[type].magic))
    {
-      pthread_mutex_unlock(&lgHdl[handle].mutex);   
+      pthread_mutex_unlock(&lgHdl[handle].mutex);
       PARAM_ERROR(LG_BAD_HANDLE, "bad handle (%d)", handle);
    }
 
@@ -312,32 +320,30 @@ int lgHdlSetShare(int handle, int share)
    lgHdlHdr_p h;
    lgCtx_p Ctx;
 
-   pthread_once(&xInited, xInit);
-
    Ctx = lgCtxGet();
 
    if ((handle < 0) || (handle >= LG_HDL_SLOTS))
       PARAM_ERROR(LG_BAD_HANDLE, "bad handle (%d)", handle);
 
-   pthread_mutex_lock(&lgHdl[handle].mutex);   
+   pthread_mutex_lock(&lgHdl[handle].mutex);
 
-   h = lgHdl[handle].header;
+   h = __atomic_load_n(&lgHdl[handle].header, __ATOMIC_ACQUIRE);
  
    if ((h == (void *)LG_HDL_FREE) || (h == (void *)LG_HDL_RSVD))
    {
-      pthread_mutex_unlock(&lgHdl[handle].mutex);   
+      pthread_mutex_unlock(&lgHdl[handle].mutex);
       PARAM_ERROR(LG_BAD_HANDLE, "bad handle (%d)", handle);
    }
 
    if (h->owner != Ctx->owner)
    {
-      pthread_mutex_unlock(&lgHdl[handle].mutex);   
+      pthread_mutex_unlock(&lgHdl[handle].mutex);
       PARAM_ERROR(LG_NO_PERMISSIONS, "not owned (%d)", handle);
    }
 
    h->share = share;
 
-   pthread_mutex_unlock(&lgHdl[handle].mutex);   
+   pthread_mutex_unlock(&lgHdl[handle].mutex);
    
    return LG_OKAY;
 }
@@ -347,8 +353,6 @@ int lgHdlGetHandlesForType(int type, int *handles, int size)
    int hdl;
    int count=0;
    
-   pthread_once(&xInited, xInit);
-
    pthread_mutex_lock(&slgHdlMutex);
    
    hdl = slgHdlTypeUsage[type].first;
@@ -369,12 +373,20 @@ int lgHdlFree(int handle, int type)
 {
    int status;
    void **dummy;
-   lgHdlHdr_p h;
-
-   pthread_once(&xInited, xInit);
+   lgHdlHdr_p h = NULL;
 
    LG_DBG(LG_DEBUG_TRACE, "handle=%d type=%d", handle, type);
 
+   if ((handle < 0) || (handle >= LG_HDL_SLOTS))
+      PARAM_ERROR(LG_BAD_HANDLE, "bad handle (%d)", handle);
+
+   /*
+   Wait for any other thread using the handle.  The caller may
+   already hold the slot mutex, which is why it is recursive.
+   */
+
+   pthread_mutex_lock(&lgHdl[handle].mutex);
+
    pthread_mutex_lock(&slgHdlMutex);
    
    status = lgHdlGetObj(handle, type, (void **)&dummy);
@@ -403,16 +415,14 @@ int lgHdlFree(int handle, int type)
       {
          slgHdlTypeUsage[type].last = h->previous;
       }
-         
-      lgHdl[handle].header = NULL;
-
-      if (h->destructor != NULL) (h->destructor)(h->obj);
 
-      if (h->obj != NULL) free(h->obj);
-      
-      free(h);
+      __atomic_store_n(&lgHdl[handle].header, NULL, __ATOMIC_RELEASE);
    }
    pthread_mutex_unlock(&slgHdlMutex);
+
+   if (h != NULL) xHdlDestroy(h);
+
+   pthread_mutex_unlock(&lgHdl[handle].mutex);
    
    return status;
 }
@@ -423,11 +433,9 @@ void lgHdlPurgeByOwner(int owner)
    int i;
    lgHdlHdr_p h;
 
-   pthread_once(&xInited, xInit);
-
    for (i=0; i<LG_HDL_SLOTS; i++)
    {
-      h = lgHdl[i].header;
+      h = __atomic_load_n(&lgHdl[i].header, __ATOMIC_ACQUIRE);
 
       if ((h != (void *)LG_HDL_FREE) && (h != (void *)LG_HDL_RSVD))
       {
@@ -31,7 +31,10 @@ For more information, please refer to <http://unlicense.org/>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <pthread.h>
 #include <limits.h>
 
@@ -55,6 +58,11 @@ static void xCreatePipe(const char *name, int perm)
 }
 
 
+static size_t xRingBytes(uint32_t slots)
+{
+   return sizeof(lgNotifyRing_t) + (slots * sizeof(lgGpioReport_t));
+}
+
 static void _notifyClose(lgNotify_t *h)
 {
    char fifo[128];
@@ -63,6 +71,8 @@ static void _notifyClose(lgNotify_t *h)
       h->fd, h->pipe_number, h);
 
    if (h->fd >= 0) close(h->fd);
+
+   if (h->ring) munmap(h->ring, xRingBytes(h->ring->mask + 1));
    
    if (h->pipe_number)
    {
@@ -193,6 +203,140 @@ int lgNotifyOpenInBand(int fd)
 }
 
 
+/* ----------------------------------------------------------------------- */
+
+int lgNotifyOpenRing(int slots)
+{
+   uint32_t size;
+   int fd;
+   lgNotify_t *h;
+   lgNotifyRing_p ring;
+   int handle;
+
+   LG_DBG(LG_DEBUG_TRACE, "slots=%d", slots);
+
+   if ((slots < 1) || (slots > LG_MAX_RING_SLOTS))
+      PARAM_ERROR(LG_BAD_RING_SLOTS, "bad slots (%d)", slots);
+
+   /* round up to a power of 2 so a slot is found with a mask */
+
+   for (size=1; size<slots; size<<=1);
+
+   ring = mmap(NULL, xRingBytes(size), PROT_READ|PROT_WRITE,
+      MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+
+   if (ring == MAP_FAILED)
+      PARAM_ERROR(LG_NOT_ENOUGH_MEMORY, "mmap %d slots failed (%m)", size);
+
+   fd = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+
+   if (fd < 0)
+   {
+      munmap(ring, xRingBytes(size));
+      PARAM_ERROR(LG_NOT_ENOUGH_MEMORY, "eventfd failed (%m)");
+   }
+
+   ring->mask = size - 1;
+   ring->fd = fd;
+
+   handle = lgHdlAlloc(
+      LG_HDL_TYPE_NOTIFY, sizeof(lgNotify_t), (void**)&h, _notifyClose);
+
+   if (handle < 0)
+   {
+      close(fd);
+      munmap(ring, xRingBytes(size));
+      return LG_NO_MEMORY;
+   }
+
+   h->fd = fd;
+   h->pipe_number = 0;
+   h->max_emits = size;
+   h->ring = ring;
+   h->state = LG_NOTIFY_RUNNING;
+
+   return handle;
+}
+
+lgNotifyRing_p lgNotifyGetRing(int handle)
+{
+   lgNotify_t *h;
+   lgNotifyRing_p ring = NULL;
+
+   LG_DBG(LG_DEBUG_TRACE, "handle=%d", handle);
+
+   if (lgHdlGetLockedObj(handle, LG_HDL_TYPE_NOTIFY, (void **)&h) == LG_OKAY)
+   {
+      ring = h->ring;
+
+      lgHdlUnlock(handle);
+   }
+
+   return ring;
+}
+
+int lgNotifyRingPeek(lgNotifyRing_p ring, lgGpioReport_t **reports)
+{
+   uint32_t head, tail, avail, toEnd;
+
+   head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+   tail = ring->tail;
+
+   avail = head - tail;
+   toEnd = (ring->mask + 1) - (tail & ring->mask);
+
+   *reports = &ring->reports[tail & ring->mask];
+
+   return (avail < toEnd) ? avail : toEnd;
+}
+
+void lgNotifyRingRelease(lgNotifyRing_p ring, int count)
+{
+   /* the slots must be read before the alert thread may reuse them */
+
+   __atomic_store_n(&ring->tail, ring->tail + count, __ATOMIC_RELEASE);
+}
+
+int lgNotifyRingWait(lgNotifyRing_p ring, int timeout_ms)
+{
+   struct pollfd pfd;
+   uint64_t doorbell;
+   lgGpioReport_t *reports;
+   int avail;
+
+   avail = lgNotifyRingPeek(ring, &reports);
+
+   if (avail) return avail;
+
+   /*
+   Ask to be woken, then look again.  The alert thread publishes
+   head before checking waiting, so either it sees waiting set or
+   this sees the new head.
+   */
+
+   __atomic_store_n(&ring->waiting, 1, __ATOMIC_SEQ_CST);
+
+   avail = lgNotifyRingPeek(ring, &reports);
+
+   if (!avail)
+   {
+      pfd.fd = ring->fd;
+      pfd.events = POLLIN;
+
+      if (poll(&pfd, 1, timeout_ms) > 0)
+      {
+         if (read(ring->fd, &doorbell, sizeof(doorbell)) < 0)
+            LG_DBG(LG_DEBUG_INTERNAL, "doorbell read failed (%m)");
+      }
+
+      avail = lgNotifyRingPeek(ring, &reports);
+   }
+
+   __atomic_store_n(&ring->waiting, 0, __ATOMIC_RELAXED);
+
+   return avail;
+}
+
 /* ----------------------------------------------------------------------- */
 
 int lgNotifyResume(int handle)
@@ -51,6 +51,15 @@ int pthAlertRunning = LG_THREAD_NONE;
 
 lgGpioAlert_t aBuf[LG_MAX_ALERTS];
 
+static const uint64_t doorbell = 1;
+
+/* merge scratch, the sorted runs of aBuf and a heap of their heads */
+
+static lgGpioAlert_t mBuf[LG_MAX_ALERTS];
+static int runPos[LG_MAX_ALERTS];
+static int runEnd[LG_MAX_ALERTS];
+static int runHeap[LG_MAX_ALERTS];
+
 static void xWaitForSignal(pthread_cond_t *cond, pthread_mutex_t *mutex)
 {
    pthread_mutex_lock(mutex);
@@ -70,7 +79,136 @@ int tscomp(const void *p1, const void *p2)
    const lgGpioAlert_t *e1 = p1;
    const lgGpioAlert_t *e2 = p2;
 
-   return e1->report.timestamp - e2->report.timestamp;
+   /* timestamps are 64 bit, their difference does not fit an int */
+
+   return (e1->report.timestamp > e2->report.timestamp) -
+          (e1->report.timestamp < e2->report.timestamp);
+}
+
+static int xRunBefore(int r1, int r2)
+{
+   uint64_t t1 = aBuf[runPos[r1]].report.timestamp;
+   uint64_t t2 = aBuf[runPos[r2]].report.timestamp;
+
+   /* earlier runs win ties so a GPIO's events keep their order */
+
+   return (t1 < t2) || ((t1 == t2) && (r1 < r2));
+}
+
+static void xSiftDown(int slot, int heapSize)
+{
+   int child;
+   int run = runHeap[slot];
+
+   while ((child = (2 * slot) + 1) < heapSize)
+   {
+      if ((child + 1 < heapSize) &&
+          xRunBefore(runHeap[child + 1], runHeap[child])) child++;
+
+      if (!xRunBefore(runHeap[child], run)) break;
+
+      runHeap[slot] = runHeap[child];
+      slot = child;
+   }
+
+   runHeap[slot] = run;
+}
+
+void xMergeRuns(int count)
+{
+   /*
+   aBuf holds the alerts left over from the last pass followed by
+   those each GPIO added in this one.  Each of these is already in
+   time order as the kernel reports a line's events in order, so
+   rather than sorting everything the runs are merged, taking the
+   earliest head from a heap of the run heads each time.
+   */
+
+   int i, run, runs, heapSize;
+
+   runs = 0;
+   runPos[0] = 0;
+
+   for (i=1; i<count; i++)
+   {
+      if (aBuf[i].report.timestamp < aBuf[i-1].report.timestamp)
+      {
+         runEnd[runs++] = i;
+         runPos[runs] = i;
+      }
+   }
+
+   runEnd[runs++] = count;
+
+   if (runs < 2) return; /* already in order */
+
+   for (i=0; i<runs; i++) runHeap[i] = i;
+
+   heapSize = runs;
+
+   for (i=(heapSize/2)-1; i>=0; i--) xSiftDown(i, heapSize);
+
+   for (i=0; i<count; i++)
+   {
+      run = runHeap[0];
+
+      mBuf[i] = aBuf[runPos[run]++];
+
+      if (runPos[run] == runEnd[run]) runHeap[0] = runHeap[--heapSize];
+
+      if (heapSize) xSiftDown(0, heapSize);
+   }
+
+   memcpy(aBuf, mBuf, sizeof(aBuf[0])*count);
+}
+
+static void xEmitRing(lgNotifyRing_p ring, int handle, int count)
+{
+   uint32_t head, tail;
+   int d;
+
+   /* only this thread moves head, so it is read without ordering */
+
+   head = ring->head;
+   tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+   for (d=0; d<count; d++)
+   {
+      if (handle == aBuf[d].nfyHandle)
+      {
+         if ((head - tail) > ring->mask)
+         {
+            /* full, see if the consumer has freed any slots */
+
+            tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+            if ((head - tail) > ring->mask)
+            {
+               ring->dropped++;
+               continue;
+            }
+         }
+
+         ring->reports[head & ring->mask] = aBuf[d].report;
+         head++;
+      }
+   }
+
+   if (head == ring->head) return;
+
+   /*
+   Publish the reports, then ring the doorbell only if the consumer
+   is waiting on it.  Pairs with the store and load in
+   lgNotifyRingWait.
+   */
+
+   __atomic_store_n(&ring->head, head, __ATOMIC_SEQ_CST);
+
+   if (__atomic_load_n(&ring->waiting, __ATOMIC_SEQ_CST))
+   {
+      if (write(ring->fd, &doorbell, sizeof(doorbell)) < 0)
+         LG_DBG(LG_DEBUG_ALWAYS, "doorbell fd=%d errno=%d", ring->fd, errno);
+   }
 }
 
 uint64_t xMonotonicTimestamp(void)
@@ -119,6 +257,10 @@ void emitNotifications(int count)
       {
          lgHdlFree(handles[i], LG_HDL_TYPE_NOTIFY);
       }
+      else if ((h->state == LG_NOTIFY_RUNNING) && h->ring)
+      {
+         xEmitRing(h->ring, handles[i], count);
+      }
       else if (h->state >= LG_NOTIFY_RUNNING)
       {
          emit = 0;
@@ -578,10 +720,10 @@ void *lgPthAlert(void)
                LG_DBG(LG_DEBUG_ALWAYS, "nowGT=%"PRIu64" count=%d",
                   nowGT/100000, count);
                */
-               // printbuf(count, "pre qsort");
-               qsort(aBuf, count, sizeof(aBuf[0]), tscomp);
-               //lgcheck(count, "check post qsort");
-               // printbuf(count, "post qsort");
+               // printbuf(count, "pre merge");
+               xMergeRuns(count);
+               //lgcheck(count, "check post merge");
+               // printbuf(count, "post merge");
             }
 
             /* emit any due alerts */
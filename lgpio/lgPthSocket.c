@@ -27,9 +27,12 @@ For more information, please refer to <http://unlicense.org/>
 
 #include <inttypes.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <errno.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
 #include <netinet/tcp.h>
 #include <arpa/inet.h>
 
@@ -40,6 +43,139 @@ For more information, please refer to <http://unlicense.org/>
 #include "lgDbg.h"
 #include "lgHdl.h"
 
+#define LG_MAX_SOCKET_EVENTS 64
+
+static int xExecBatch(lgCmd_p cmdP, lgCmd_p execP, lgCmd_p replyP)
+{
+   /*
+   Execute each command of a batch in turn and gather the replies.
+   Returns the size of the reply message.
+   */
+
+   char *ext = (char *)&cmdP[1];
+   char *out = (char *)&replyP[1];
+   uint32_t pos = 0;
+   uint32_t outPos = 0;
+   uint32_t subSize, dataSize;
+   int executed = 0;
+
+   while ((pos + sizeof(lgCmd_t)) <= cmdP->size)
+   {
+      subSize = ((lgCmd_p)(ext + pos))->size;
+
+      /* compare against the space left, subSize is from the client and
+         adding it could wrap where size_t is 32 bits */
+
+      if (subSize > (cmdP->size - pos - sizeof(lgCmd_t)))
+      {
+         LG_DBG(LG_DEBUG_ALWAYS, "batch command %d overruns message",
+            executed);
+         break;
+      }
+
+      /* each command needs the whole buffer for its reply */
+
+      memcpy(execP, ext + pos, sizeof(lgCmd_t) + subSize);
+
+      pos += sizeof(lgCmd_t) + CMD_BATCH_PAD(subSize);
+
+      if ((execP->cmd == LG_CMD_BATCH) || (execP->cmd == LG_CMD_NOIB))
+      {
+         execP->status = LG_UNKNOWN_COMMAND;
+         execP->size = 0;
+      }
+      else execP->status = lgExecCmd(execP, CMD_MAX_EXTENSION);
+
+      dataSize = execP->size;
+
+      if ((outPos + sizeof(lgCmd_t) + CMD_BATCH_PAD(dataSize)) >
+          (CMD_MAX_EXTENSION - sizeof(lgCmd_t)))
+      {
+         /* the command ran but there is no room for its data */
+
+         execP->status = LG_MSG_TOOBIG;
+         execP->size = 0;
+         dataSize = 0;
+
+         if ((outPos + sizeof(lgCmd_t)) >
+             (CMD_MAX_EXTENSION - sizeof(lgCmd_t))) break;
+      }
+
+      memcpy(out + outPos, execP, sizeof(lgCmd_t) + dataSize);
+
+      outPos += sizeof(lgCmd_t) + CMD_BATCH_PAD(dataSize);
+
+      executed++;
+   }
+
+   *replyP = *cmdP;
+   replyP->status = executed;
+   replyP->size = outPos;
+
+   return sizeof(lgCmd_t) + outPos;
+}
+
+static int xSocketExec(
+   int sock, lgCmd_p cmdP, int bufSize, lgCmd_p *execPP, lgCmd_p *replyPP)
+{
+   /*
+   Execute a received message and send its reply.
+   Returns -1 if the connection should be dropped.
+   */
+
+   int opt;
+   int replyLen;
+   uint32_t *arg=(uint32_t*)&cmdP[1];
+
+   LG_DBG(LG_DEBUG_INTERNAL, "magic=%d size=%d cmd=%d Q=%d I=%d H=%d",
+      cmdP->magic, cmdP->size, cmdP->cmd,
+      cmdP->doubles, cmdP->longs, cmdP->shorts);
+
+   if (cmdP->cmd == LG_CMD_BATCH)
+   {
+      /* buffers only needed by clients which batch */
+
+      if (*execPP == NULL) *execPP = malloc(CMD_MAX_EXTENSION + 1);
+      if (*replyPP == NULL) *replyPP = malloc(CMD_MAX_EXTENSION);
+
+      if ((*execPP == NULL) || (*replyPP == NULL))
+      {
+         LG_DBG(LG_DEBUG_ALWAYS, "no memory for batch, sock=%d", sock);
+         return -1;
+      }
+
+      replyLen = xExecBatch(cmdP, *execPP, *replyPP);
+
+      if (write(sock, *replyPP, replyLen)) ; /* ignore errors */
+
+      return 0;
+   }
+
+   if (cmdP->cmd == LG_CMD_NOIB)
+   {
+     /* Enable the Nagle algorithm. */
+      opt = 0;
+      setsockopt(
+         sock, IPPROTO_TCP, TCP_NODELAY, (char*)&opt, sizeof(int));
+
+      /* set sock as the argument */
+      arg[0] = sock;
+   }
+
+   cmdP->status = lgExecCmd(cmdP, bufSize);
+
+   LG_DBG(LG_DEBUG_INTERNAL, "status=%d size=%d cmd=%d Q=%d I=%d H=%d",
+      cmdP->status, cmdP->size, cmdP->cmd,
+      cmdP->doubles, cmdP->longs, cmdP->shorts);
+
+   if (write(sock, cmdP, sizeof(lgCmd_t)+cmdP->size)) ; /* ignore errors */
+
+   LG_DBG(LG_DEBUG_INTERNAL, "ret=%s",
+      lgDbgStr2Hex(sizeof(lgCmd_t)+cmdP->size, (char *)cmdP));
+
+   return 0;
+}
+
 static void *xSocketThreadHandler(void *fdC)
 {
    int sock = *(int*)fdC;
@@ -47,7 +183,8 @@ static void *xSocketThreadHandler(void *fdC)
    lgCtx_p Ctx;
    lgCmd_t cmdBuf[CMD_MAX_EXTENSION/sizeof(lgCmd_t)];
    lgCmd_p cmdP=cmdBuf;
-   uint32_t *arg=(uint32_t*)&cmdP[1];
+   lgCmd_p execP=NULL;
+   lgCmd_p replyP=NULL;
 
    free(fdC);
 
@@ -65,10 +202,6 @@ static void *xSocketThreadHandler(void *fdC)
       if (recv(sock, cmdP, sizeof(lgCmd_t), MSG_WAITALL) !=
          sizeof(lgCmd_t)) break;
 
-      LG_DBG(LG_DEBUG_INTERNAL, "magic=%d size=%d cmd=%d Q=%d I=%d H=%d",
-         cmdP->magic, cmdP->size, cmdP->cmd,
-         cmdP->doubles, cmdP->longs, cmdP->shorts);
-
       if (cmdP->size)
       {
          if (cmdP->size < (sizeof(cmdBuf)-sizeof(lgCmd_t)))
@@ -97,33 +230,17 @@ static void *xSocketThreadHandler(void *fdC)
          }
       }
 
-      if (cmdP->cmd == LG_CMD_NOIB)
-      {
-        /* Enable the Nagle algorithm. */
-         opt = 0;
-         setsockopt(
-            sock, IPPROTO_TCP, TCP_NODELAY, (char*)&opt, sizeof(int));
-
-         /* set sock as the argument */
-         arg[0] = sock;
-      }
-
-      cmdP->status = lgExecCmd(cmdBuf, sizeof(cmdBuf));
-
-      LG_DBG(LG_DEBUG_INTERNAL, "status=%d size=%d cmd=%d Q=%d I=%d H=%d",
-         cmdP->status, cmdP->size, cmdP->cmd,
-         cmdP->doubles, cmdP->longs, cmdP->shorts);
-
-      if (write(sock, cmdBuf, sizeof(lgCmd_t)+cmdP->size)) ; /* ignore errors */
-
-      LG_DBG(LG_DEBUG_INTERNAL, "ret=%s",
-         lgDbgStr2Hex(sizeof(lgCmd_t)+cmdP->size, (char *)&cmdBuf));
+      if (xSocketExec(sock, cmdP, sizeof(cmdBuf), &execP, &replyP) < 0)
+         break;
    }
 
    //lgNotifyCloseOrphans(-1, sock);
 
    lgHdlPurgeByOwner(Ctx->owner);
 
+   free(execP);
+   free(replyP);
+
    close(sock);
 
    LG_DBG(LG_DEBUG_INTERNAL, "Socket %d closed", sock);
@@ -154,6 +271,307 @@ static int xAddrAllowed(struct sockaddr *saddr)
    return 0;
 }
 
+/* EVENT LOOP SERVER
+
+   One thread waits on every connection with epoll and reads whatever
+   has arrived without blocking.  Only once a whole message is in does
+   the connection go on the work queue for a worker thread to execute.
+   Connections are armed one shot, so while a worker has one the loop
+   does not see it, and the worker rearms it once the reply is sent.
+   Connections are only ever closed by the loop.
+*/
+
+typedef struct lgClient_s
+{
+   struct lgClient_s *next; /* on the work queue */
+   int sock;
+   uint32_t got;            /* bytes of the message received */
+   lgCtx_p Ctx;
+   lgCmd_p execP;
+   lgCmd_p replyP;
+   lgCmd_t cmdBuf[CMD_MAX_EXTENSION/sizeof(lgCmd_t)];
+} lgClient_t, *lgClient_p;
+
+static int xEpFd = -1;
+
+static pthread_mutex_t xQueueMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t xQueueCond = PTHREAD_COND_INITIALIZER;
+static lgClient_p xQueueHead = NULL;
+static lgClient_p xQueueTail = NULL;
+
+static int xClientArm(lgClient_p c, int op)
+{
+   struct epoll_event ev;
+
+   ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+   ev.data.ptr = c;
+
+   return epoll_ctl(xEpFd, op, c->sock, &ev);
+}
+
+static int xClientRead(lgClient_p c)
+{
+   /*
+   Read what has arrived of the current message.
+   Returns 1 if it is complete, 0 if more is to come, and
+   -1 if the connection has closed or is in error.
+   */
+
+   lgCmd_p cmdP = c->cmdBuf;
+   uint32_t need;
+   ssize_t n;
+
+   while (1)
+   {
+      if (c->got < sizeof(lgCmd_t)) need = sizeof(lgCmd_t);
+      else
+      {
+         if (cmdP->size >= (sizeof(c->cmdBuf)-sizeof(lgCmd_t)))
+         {
+            /* Serious error.  No point continuing. */
+
+            LG_DBG(LG_DEBUG_ALWAYS,
+               "message too large %"PRId32"(%zd), sock=%d",
+               cmdP->size, sizeof(c->cmdBuf)-sizeof(lgCmd_t), c->sock);
+
+            return -1;
+         }
+
+         need = sizeof(lgCmd_t) + cmdP->size;
+      }
+
+      if (c->got == need) return 1;
+
+      n = recv(c->sock, (char *)c->cmdBuf + c->got, need - c->got,
+         MSG_DONTWAIT);
+
+      if (n > 0) c->got += n;
+      else if (n == 0) return -1;
+      else if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) return 0;
+      else if (errno != EINTR) return -1;
+   }
+}
+
+static void xClientClose(lgClient_p c)
+{
+   epoll_ctl(xEpFd, EPOLL_CTL_DEL, c->sock, NULL);
+
+   lgHdlPurgeByOwner(c->Ctx->owner);
+
+   close(c->sock);
+
+   LG_DBG(LG_DEBUG_INTERNAL, "Socket %d closed", c->sock);
+
+   LG_DBG(LG_DEBUG_INTERNAL, "free context memory %d", c->Ctx->owner);
+
+   free(c->Ctx);
+   free(c->execP);
+   free(c->replyP);
+   free(c);
+}
+
+static void xClientAccept(void)
+{
+   int fdC, opt;
+   struct sockaddr_storage client;
+   socklen_t c;
+   lgClient_p cl;
+
+   while (1)
+   {
+      c = sizeof(client);
+
+      fdC = accept(gFdSock, (struct sockaddr *)&client, &c);
+
+      if (fdC < 0)
+      {
+         if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) return;
+
+         if ((errno == EINTR) || (errno == ECONNABORTED)) continue;
+
+         /* out of descriptors, leave the rest queued for now */
+
+         LG_DBG(LG_DEBUG_ALWAYS, "accept failed (%m)");
+         return;
+      }
+
+      lgNotifyCloseOrphans(-1, fdC);
+
+      if (!xAddrAllowed((struct sockaddr *)&client))
+      {
+         LG_DBG(LG_DEBUG_ALWAYS, "Connection rejected, closing");
+         close(fdC);
+         continue;
+      }
+
+      LG_DBG(LG_DEBUG_INTERNAL, "Connection accepted on socket %d", fdC);
+
+      /* Enable tcp_keepalive and disable the Nagle algorithm. */
+      opt = 1;
+
+      if (setsockopt(fdC, SOL_SOCKET, SO_KEEPALIVE, &opt, sizeof(opt)) < 0)
+      {
+         LG_DBG(LG_DEBUG_ALWAYS, "setsockopt() fail, closing socket %d", fdC);
+         close(fdC);
+         continue;
+      }
+
+      setsockopt(fdC, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+      cl = malloc(sizeof(lgClient_t));
+
+      if (cl != NULL)
+      {
+         cl->Ctx = calloc(1, sizeof(lgCtx_t));
+
+         if (cl->Ctx == NULL)
+         {
+            free(cl);
+            cl = NULL;
+         }
+      }
+
+      if (cl == NULL)
+      {
+         LG_DBG(LG_DEBUG_ALWAYS, "no memory, closing");
+         close(fdC);
+         continue;
+      }
+
+      cl->next = NULL;
+      cl->sock = fdC;
+      cl->got = 0;
+      cl->execP = NULL;
+      cl->replyP = NULL;
+
+      if (xClientArm(cl, EPOLL_CTL_ADD) < 0)
+      {
+         LG_DBG(LG_DEBUG_ALWAYS, "epoll_ctl failed (%m), closing");
+         close(fdC);
+         free(cl->Ctx);
+         free(cl);
+      }
+   }
+}
+
+static void *xSocketWorker(void *x)
+{
+   lgClient_p c;
+
+   while (1)
+   {
+      pthread_mutex_lock(&xQueueMutex);
+
+      while (xQueueHead == NULL)
+         pthread_cond_wait(&xQueueCond, &xQueueMutex);
+
+      c = xQueueHead;
+      xQueueHead = c->next;
+      if (xQueueHead == NULL) xQueueTail = NULL;
+
+      pthread_mutex_unlock(&xQueueMutex);
+
+      /* commands act for the owner of the connection */
+
+      lgCtxSet(c->Ctx);
+
+      if (xSocketExec(c->sock, c->cmdBuf, sizeof(c->cmdBuf),
+         &c->execP, &c->replyP) < 0)
+      {
+         /* the loop sees the hang up and closes */
+
+         shutdown(c->sock, SHUT_RDWR);
+      }
+
+      lgCtxSet(NULL);
+
+      c->got = 0;
+
+      /* a message which arrived meanwhile fires at once */
+
+      xClientArm(c, EPOLL_CTL_MOD);
+   }
+
+   return 0;
+}
+
+static void *xEpollServer(pthread_attr_t *attr)
+{
+   int i, n;
+   pthread_t thr;
+   lgClient_p c;
+   struct epoll_event ev, events[LG_MAX_SOCKET_EVENTS];
+
+   xEpFd = epoll_create1(EPOLL_CLOEXEC);
+
+   if (xEpFd < 0)
+      PARAM_ERROR((void*)LG_INIT_FAILED, "epoll_create1 failed (%m)");
+
+   fcntl(gFdSock, F_SETFL, fcntl(gFdSock, F_GETFL) | O_NONBLOCK);
+
+   ev.events = EPOLLIN;
+   ev.data.ptr = NULL;
+
+   if (epoll_ctl(xEpFd, EPOLL_CTL_ADD, gFdSock, &ev) < 0)
+      PARAM_ERROR((void*)LG_INIT_FAILED, "epoll_ctl failed (%m)");
+
+   for (i=0; i<gSockWorkers; i++)
+   {
+      if (pthread_create(&thr, attr, xSocketWorker, NULL))
+         PARAM_ERROR((void*)LG_INIT_FAILED,
+            "socket worker pthread_create failed (%m)");
+   }
+
+   LG_DBG(LG_DEBUG_STARTUP, "event loop with %d workers", gSockWorkers);
+
+   while (1)
+   {
+      n = epoll_wait(xEpFd, events, LG_MAX_SOCKET_EVENTS, -1);
+
+      if (n < 0)
+      {
+         if (errno == EINTR) continue;
+
+         PARAM_ERROR((void*)LG_INIT_FAILED, "epoll_wait failed (%m)");
+      }
+
+      for (i=0; i<n; i++)
+      {
+         c = events[i].data.ptr;
+
+         if (c == NULL)
+         {
+            xClientAccept();
+            continue;
+         }
+
+         switch (xClientRead(c))
+         {
+            case 1:
+               pthread_mutex_lock(&xQueueMutex);
+
+               c->next = NULL;
+               if (xQueueTail) xQueueTail->next = c; else xQueueHead = c;
+               xQueueTail = c;
+
+               pthread_cond_signal(&xQueueCond);
+
+               pthread_mutex_unlock(&xQueueMutex);
+               break;
+
+            case 0:
+               xClientArm(c, EPOLL_CTL_MOD);
+               break;
+
+            default:
+               xClientClose(c);
+         }
+      }
+   }
+
+   return 0;
+}
+
 /* ----------------------------------------------------------------------- */
 
 void *pthSocketThread(void *x)
@@ -179,6 +597,8 @@ void *pthSocketThread(void *x)
 
    listen(gFdSock, 100);
 
+   if (gSockWorkers) return xEpollServer(&attr);
+
    c = sizeof(client);
 
    while (fdC >= 0)
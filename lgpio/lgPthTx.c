@@ -26,6 +26,8 @@ For more information, please refer to <http://unlicense.org/>
 */
 
 #include <stdlib.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
 
 #include "lgDbg.h"
 #include "lgHdl.h"
@@ -37,150 +39,258 @@ static pthread_t pthTx;
 static pthread_mutex_t lgTxMutex = PTHREAD_MUTEX_INITIALIZER;
 static volatile lgTxRec_p txRec = NULL;
 static int pthTxRunning = LG_THREAD_NONE;
-static struct timespec pthTxReq;
-static int pthTxDelayMicros = 0;
 
-void *lgPthTx(void)
+/*
+The records are also kept in a min-heap on their next edge so the
+thread only looks at the records which are due, and sleeps on a
+timerfd armed for the earliest deadline.  A new record with an earlier
+deadline rearms the timer, which wakes the thread early.
+*/
+
+static int pthTxTimerFd = -1;
+static lgTxRec_p *txHeap = NULL;
+static int txHeapCount = 0;
+static int txHeapSize = 0;
+
+static uint64_t xTxNow(void)
 {
-   lgTxRec_p p, t;
-   int i;
+   struct timespec ts;
 
-   clock_gettime(CLOCK_MONOTONIC, &pthTxReq); // get current time
+   clock_gettime(CLOCK_MONOTONIC, &ts);
 
-   while (1)
+   return (ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+static void xTxHeapSet(int pos, lgTxRec_p p)
+{
+   txHeap[pos] = p;
+   p->heap_pos = pos;
+}
+
+static void xTxHeapUp(int pos)
+{
+   int parent;
+   lgTxRec_p p = txHeap[pos];
+
+   while (pos)
    {
-      lgPthTxLock();
+      parent = (pos - 1) / 2;
+
+      if (txHeap[parent]->deadline <= p->deadline) break;
+
+      xTxHeapSet(pos, txHeap[parent]);
+      pos = parent;
+   }
+
+   xTxHeapSet(pos, p);
+}
+
+static void xTxHeapDown(int pos)
+{
+   int child;
+   lgTxRec_p p = txHeap[pos];
+
+   while ((child = (2 * pos) + 1) < txHeapCount)
+   {
+      if (((child + 1) < txHeapCount) &&
+          (txHeap[child + 1]->deadline < txHeap[child]->deadline)) child++;
+
+      if (p->deadline <= txHeap[child]->deadline) break;
+
+      xTxHeapSet(pos, txHeap[child]);
+      pos = child;
+   }
+
+   xTxHeapSet(pos, p);
+}
+
+static int xTxHeapAdd(lgTxRec_p p)
+{
+   lgTxRec_p *heap;
+   int size;
 
-      // update times
+   if (txHeapCount >= txHeapSize)
+   {
+      size = txHeapSize ? (txHeapSize * 2) : 16;
+
+      heap = realloc(txHeap, size * sizeof(lgTxRec_p));
+
+      if (heap == NULL) return LG_NO_MEMORY;
+
+      txHeap = heap;
+      txHeapSize = size;
+   }
+
+   xTxHeapSet(txHeapCount++, p);
+   xTxHeapUp(p->heap_pos);
+
+   return LG_OKAY;
+}
 
-      for (p=txRec; p!=NULL; p=p->next)
-         p->next_micros -= pthTxDelayMicros;
+static void xTxHeapPop(void)
+{
+   if (--txHeapCount)
+   {
+      xTxHeapSet(0, txHeap[txHeapCount]);
+      xTxHeapDown(0);
+   }
+}
 
-      // output changed edges and calculate next delay
+static void xTxArm(void)
+{
+   struct itimerspec its = {{0, 0}, {0, 0}};
+
+   if (pthTxTimerFd < 0) return;
+
+   if (txHeapCount)
+   {
+      /* 0 would disarm, and a past deadline fires at once anyway */
 
-      pthTxDelayMicros = 20000; // run at least fifty times a second
+      its.it_value.tv_sec = txHeap[0]->deadline / 1000000000ULL;
+      its.it_value.tv_nsec = txHeap[0]->deadline % 1000000000ULL;
 
-      p = txRec;
-      
-      while (p != NULL)
+      if ((its.it_value.tv_sec == 0) && (its.it_value.tv_nsec == 0))
+         its.it_value.tv_nsec = 1;
+   }
+
+   timerfd_settime(pthTxTimerFd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+static void xTxEdge(lgTxRec_p p)
+{
+   int i;
+
+   if (p->type == LG_TX_PWM)
+   {
+      if (p->next_level || (p->micros_on[0] == 0))
       {
-         if (p->active)
+          /* start of cycle */
+
+         if ((p->cycles[0] <= 0) && (p->entries > 1))
          {
-            if (p->next_micros <= 0)
+            for (i=0; i<p->entries; i++)
             {
-               if (p->type == LG_TX_PWM)
-               {
-                  if (p->next_level || (p->micros_on[0] == 0))
-                  {
-                      /* start of cycle */
-
-                     if ((p->cycles[0] <= 0) && (p->entries > 1))
-                     {
-                        for (i=0; i<p->entries; i++)
-                        {
-                           p->micros_on[i] = p->micros_on[i+1];
-                           p->micros_off[i] = p->micros_off[i+1];
-                           p->cycles[i] = p->cycles[i+1];
-                        }
-                        --p->entries;
-                     }
-                  
-                     if (p->cycles[0] == 0) /* 0 is a result of countdown */
-                     {
-                        xWrite(p->chip, p->gpio, 0);
-                        p->active = 0;
-                     }
-                     else if (p->micros_on[0])
-                     {
-                        xWrite(p->chip, p->gpio, 1);
-                        p->next_micros += p->micros_on[0];
-                        if (p->micros_off[0]) p->next_level = 0;
-                     }
-                     else
-                     {
-                        xWrite(p->chip, p->gpio, 0);
-                        p->next_micros += p->micros_off[0];
-                        p->next_level = 1;
-                     }
-
-                     if (--p->cycles[0] < 0) p->cycles[0] = -1;
-                  }
-                  else /* middle of cycle */
-                  {
-                     xWrite(p->chip, p->gpio, 0);
-                     p->next_micros += p->micros_off[0];
-                     p->next_level = 1;
-                  }
-               }
-               else if (p->type == LG_TX_WAVE)
-               {
-                  if (p->pulse_pos >= p->num_pulses[0])
-                  {
-                     if (p->entries > 1)
-                     {
-                        for (i=0; i<p->entries; i++)
-                        {
-                           p->pulses[i] = p->pulses[i+1];
-                           p->num_pulses[i] = p->num_pulses[i+1];
-                        }
-                        --p->entries;
-                        p->pulse_pos = 0;
-                     }
-                  }
-
-                  if (p->pulse_pos < p->num_pulses[0])
-                  {
-                     xGroupWrite(p->chip, p->gpio,
-                        p->pulses[0][p->pulse_pos].bits,
-                        p->pulses[0][p->pulse_pos].mask);
-                     p->next_micros += p->pulses[0][p->pulse_pos].delay;
-                     (p->pulse_pos)++;
-                  }
-                  else p->active = 0;
-               }
+               p->micros_on[i] = p->micros_on[i+1];
+               p->micros_off[i] = p->micros_off[i+1];
+               p->cycles[i] = p->cycles[i+1];
             }
+            --p->entries;
+         }
 
-            if (p->next_micros < pthTxDelayMicros)
-               pthTxDelayMicros = p->next_micros;
+         if (p->cycles[0] == 0) /* 0 is a result of countdown */
+         {
+            xWrite(p->chip, p->gpio, 0);
+            p->active = 0;
+         }
+         else if (p->micros_on[0])
+         {
+            xWrite(p->chip, p->gpio, 1);
+            p->deadline += p->micros_on[0] * 1000ULL;
+            if (p->micros_off[0]) p->next_level = 0;
          }
          else
          {
-            /* delete inactive record */
-            
-            if (p->prev) p->prev->next = p->next;
-            else txRec = p->next;
-
-            if (p->next) p->next->prev = p->prev;
+            xWrite(p->chip, p->gpio, 0);
+            p->deadline += p->micros_off[0] * 1000ULL;
+            p->next_level = 1;
+         }
 
-            if (p->type == LG_TX_WAVE)
+         if (--p->cycles[0] < 0) p->cycles[0] = -1;
+      }
+      else /* middle of cycle */
+      {
+         xWrite(p->chip, p->gpio, 0);
+         p->deadline += p->micros_off[0] * 1000ULL;
+         p->next_level = 1;
+      }
+   }
+   else if (p->type == LG_TX_WAVE)
+   {
+      if (p->pulse_pos >= p->num_pulses[0])
+      {
+         if (p->entries > 1)
+         {
+            for (i=0; i<p->entries; i++)
             {
-               /* free the malloc'd pulses */
-               for (i=0; i<p->entries; i++)
-               {
-                  free(p->pulses[i]);
-                  p->pulses[i] = NULL;
-               }
+               p->pulses[i] = p->pulses[i+1];
+               p->num_pulses[i] = p->num_pulses[i+1];
             }
-
-            t = p; p = p->prev; free(t);
+            --p->entries;
+            p->pulse_pos = 0;
          }
+      }
 
-         if (p) p = p->next;
+      if (p->pulse_pos < p->num_pulses[0])
+      {
+         xGroupWrite(p->chip, p->gpio,
+            p->pulses[0][p->pulse_pos].bits,
+            p->pulses[0][p->pulse_pos].mask);
+         p->deadline += p->pulses[0][p->pulse_pos].delay * 1000ULL;
+         (p->pulse_pos)++;
       }
+      else p->active = 0;
+   }
+}
+
+static void xTxDelete(lgTxRec_p p)
+{
+   int i;
+
+   if (p->prev) p->prev->next = p->next;
+   else txRec = p->next;
+
+   if (p->next) p->next->prev = p->prev;
+
+   if (p->type == LG_TX_WAVE)
+   {
+      /* free the malloc'd pulses */
+      for (i=0; i<p->entries; i++)
+      {
+         free(p->pulses[i]);
+         p->pulses[i] = NULL;
+      }
+   }
+
+   free(p);
+}
+
+void *lgPthTx(void)
+{
+   lgTxRec_p p;
+   uint64_t now, expired;
+
+   while (1)
+   {
+      lgPthTxLock();
+
+      // output the edges which are due, each costs a heap update
+
+      now = xTxNow();
 
-      pthTxReq.tv_nsec += (pthTxDelayMicros * 1000);
-      if (pthTxReq.tv_nsec >= 1000000000)
+      while (txHeapCount && (txHeap[0]->deadline <= now))
       {
-         pthTxReq.tv_sec += 1;
-         pthTxReq.tv_nsec -= 1000000000;
+         p = txHeap[0];
+
+         if (p->active) xTxEdge(p);
+
+         if (p->active) xTxHeapDown(0);
+         else
+         {
+            /* delete inactive record */
+
+            xTxHeapPop();
+            xTxDelete(p);
+         }
       }
 
+      xTxArm();
+
       lgPthTxUnlock();
 
-      // sleep until next edge
+      // sleep until next edge, or until a new record rearms the timer
 
-      while (clock_nanosleep(
-         CLOCK_MONOTONIC, TIMER_ABSTIME, &pthTxReq, NULL));
+      if (read(pthTxTimerFd, &expired, sizeof(expired)) < 0)
+         LG_DBG(LG_DEBUG_INTERNAL, "timer read failed (%m)");
    }
 
    pthTxRunning = LG_THREAD_NONE;
@@ -191,6 +301,17 @@ void lgPthTxStart(void)
 {
    if (!pthTxRunning)
    {
+      if (pthTxTimerFd < 0)
+      {
+         pthTxTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+
+         if (pthTxTimerFd < 0)
+         {
+            LG_DBG(LG_DEBUG_ALWAYS, "timerfd_create failed (%m)");
+            return;
+         }
+      }
+
       if (pthread_create(&pthTx, NULL, (void*)lgPthTx, NULL) == 0)
       {
          pthread_detach(pthTx);
@@ -213,11 +334,12 @@ void lgPthTxStop(lgChipObj_p chip)
 {
    lgTxRec_p pwm;
 
-   /* stop any PWM on chip */
+   /* stop any PWM on chip, stopped records may outlive their chip */
    
    for (pwm=txRec; pwm!=NULL; pwm=pwm->next)
    {
-      if (chip->handle == pwm->chip->handle) pwm->active =0;
+      if (pwm->active && (chip->handle == pwm->chip->handle))
+         pwm->active =0;
    }
 }
 
@@ -243,6 +365,7 @@ lgTxRec_p lgGpioCreateTxRec(
    int cycles)
 {
    lgTxRec_p p;
+   uint64_t now;
    int usec, ct, cyc, frac, left;
 
    p = malloc(sizeof(lgTxRec_t));
@@ -262,17 +385,30 @@ lgTxRec_p lgGpioCreateTxRec(
 
       lgPthTxLock();
 
-      usec = pthTxReq.tv_nsec / 1000;
+      /* start on a cycle boundary counted from the second */
+
+      now = xTxNow();
+      usec = (now % 1000000000ULL) / 1000;
       ct = micros_on + micros_off;
       cyc = usec / ct;
       frac = usec - (ct *cyc);
-      left = ct - frac + pthTxDelayMicros + micros_offset;
-      p->next_micros = left;
-      
-      p->prev = NULL;
-      p->next = txRec;
-      if (txRec) txRec->prev = p;
-      txRec = p;
+      left = ct - frac + micros_offset;
+      p->deadline = (now - (now % 1000)) + (left * 1000ULL);
+
+      if (xTxHeapAdd(p) == LG_OKAY)
+      {
+         p->prev = NULL;
+         p->next = txRec;
+         if (txRec) txRec->prev = p;
+         txRec = p;
+
+         if (p->heap_pos == 0) xTxArm();
+      }
+      else
+      {
+         free(p);
+         p = NULL;
+      }
 
       lgPthTxUnlock();
    }
@@ -304,12 +440,23 @@ lgTxRec_p lgGroupCreateWaveRec(
 
       lgPthTxLock();
 
-      p->next_micros = pthTxDelayMicros;
-      
-      p->prev = NULL;
-      p->next = txRec;
-      if (txRec) txRec->prev = p;
-      txRec = p;
+      p->deadline = xTxNow();
+
+      if (xTxHeapAdd(p) == LG_OKAY)
+      {
+         p->prev = NULL;
+         p->next = txRec;
+         if (txRec) txRec->prev = p;
+         txRec = p;
+
+         if (p->heap_pos == 0) xTxArm();
+      }
+      else
+      {
+         free(pulses);
+         free(p);
+         p = NULL;
+      }
 
       lgPthTxUnlock();
    }
@@ -40,7 +40,8 @@ typedef struct lgTxRec_s
    int active;
    struct lgTxRec_s *prev;
    struct lgTxRec_s *next;
-   int next_micros;
+   uint64_t deadline; /* CLOCK_MONOTONIC nanoseconds of the next edge */
+   int heap_pos;      /* index in the scheduler's heap */
    lgChipObj_p chip;
    int gpio;
    int entries; /* number of entries in LG_TX_BUF arrays */
@@ -193,6 +193,52 @@ int lgSpiWrite(int handle, const char *txBuf, int count)
    return status;
 }
 
+int lgSpiWritev(int handle, const struct iovec *iov, int iovcnt)
+{
+   int i, status;
+   size_t count = 0;
+   lgSpiObj_p spi;
+   struct spi_ioc_transfer xfer[LG_MAX_SPI_SEGMENTS];
+
+   LG_DBG(LG_DEBUG_TRACE, "handle=%d iovcnt=%d", handle, iovcnt);
+
+   if ((iovcnt < 1) || (iovcnt > LG_MAX_SPI_SEGMENTS))
+      PARAM_ERROR(LG_BAD_SPI_COUNT, "bad iovcnt (%d)", iovcnt);
+
+   memset(xfer, 0, iovcnt * sizeof(xfer[0]));
+
+   for (i=0; i<iovcnt; i++)
+   {
+      count += iov[i].iov_len;
+
+      if ((count > LG_MAX_SPI_DEVICE_COUNT) || !iov[i].iov_len)
+         PARAM_ERROR(LG_BAD_SPI_COUNT, "bad count (%zu) for iov[%d]",
+            iov[i].iov_len, i);
+
+      /* one transfer per buffer, chip select held between them */
+
+      xfer[i].tx_buf        = (uintptr_t)iov[i].iov_base;
+      xfer[i].len           = iov[i].iov_len;
+      xfer[i].bits_per_word = 8;
+   }
+
+   status = lgHdlGetLockedObj(handle, LG_HDL_TYPE_SPI, (void **)&spi);
+
+   if (status == LG_OKAY)
+   {
+      for (i=0; i<iovcnt; i++) xfer[i].speed_hz = spi->speed;
+
+      if (ioctl(spi->fd, SPI_IOC_MESSAGE(iovcnt), xfer) >= 0)
+         status = count;
+      else
+         status = LG_SPI_XFER_FAILED;
+
+      lgHdlUnlock(handle);
+   }
+
+   return status;
+}
+
 int lgSpiXfer(int handle, const char *txBuf, char *rxBuf, int count)
 {
    int status;
@@ -31,6 +31,7 @@ For more information, please refer to <http://unlicense.org/>
 #include <stdint.h>
 #include <inttypes.h>
 #include <pthread.h>
+#include <sys/uio.h>
 #include <linux/gpio.h>
 
 #define LGPIO_VERSION 0x00020200
@@ -153,6 +154,12 @@ lgNotifyClose                Close a notification
 lgNotifyPause                Pause notifications
 lgNotifyResume               Start notifications
 
+lgNotifyOpenRing             Request a shared memory notification
+lgNotifyGetRing              Get the ring of a notification
+lgNotifyRingPeek             Get the reports waiting in a ring
+lgNotifyRingRelease          Free reports read from a ring
+lgNotifyRingWait             Wait for reports in a ring
+
 SERIAL
 
 lgSerialOpen                 Opens a serial device
@@ -173,6 +180,7 @@ lgSpiClose                   Closes a SPI device
 
 lgSpiRead                    Reads bytes from a SPI device
 lgSpiWrite                   Writes bytes to a SPI device
+lgSpiWritev                  Writes several buffers to a SPI device
 
 lgSpiXfer                    Transfers bytes with a SPI device
 
@@ -236,6 +244,8 @@ extern "C" {
 
 #define MAX_EMITS (PIPE_BUF / sizeof(lgGpioReport_t))
 
+#define LG_MAX_RING_SLOTS 65536
+
 #define STACK_SIZE (256*1024)
 
 #define LG_USER_LEN 16
@@ -336,6 +346,7 @@ extern "C" {
 */
 
 #define LG_MAX_SPI_DEVICE_COUNT (1<<16)
+#define LG_MAX_SPI_SEGMENTS 256
 
 /* I2C constants
 */
@@ -372,6 +383,7 @@ typedef struct
    int      fd;
    int      pipe_number;
    int      max_emits;
+   struct lgNotifyRing_s *ring; /* NULL unless a ring notification */
 } lgNotify_t;
 
 typedef void (*callbk_t) ();
@@ -391,6 +403,19 @@ typedef struct lgGpioAlert_s
    int nfyHandle;
 } lgGpioAlert_t, *lgGpioAlert_p;
 
+typedef struct lgNotifyRing_s
+{
+   uint32_t head;     /* next slot written, only moved by the alert thread */
+   uint32_t pad1[15]; /* keeps head and tail on separate cache lines */
+   uint32_t tail;     /* next slot read, only moved by the consumer */
+   uint32_t waiting;  /* set while the consumer waits on the doorbell */
+   uint32_t pad2[14];
+   uint32_t mask;     /* slots - 1, the number of slots is a power of 2 */
+   uint32_t dropped;  /* reports lost because the ring was full */
+   int      fd;       /* eventfd doorbell */
+   lgGpioReport_t reports[];
+} lgNotifyRing_t, *lgNotifyRing_p;
+
 typedef struct lgLineInfo_s
 {
    uint32_t offset;               /* GPIO number */
@@ -1527,6 +1552,119 @@ else
 D*/
 
 
+/*F*/
+int lgNotifyOpenRing(int slots);
+/*D
+This function requests a free notification which delivers its
+reports through a ring buffer in shared memory rather than a pipe.
+
+. .
+slots: the number of reports the ring holds, rounded up to a power of 2
+. .
+
+If OK returns a handle (>= 0).
+
+On failure returns a negative error code.
+
+The alert thread writes reports straight into the ring, and the
+consumer reads them where they are, so neither side makes a system
+call while reports are flowing.  An eventfd is only signalled when
+the consumer is waiting in [*lgNotifyRingWait*].  There must be
+one consumer per ring.
+
+Reports which arrive while the ring is full are dropped and counted
+in the ring's dropped field.
+
+Ring notifications are only available to the process which opened
+them.
+
+...
+h = lgNotifyOpenRing(1024);
+
+if (h >= 0)
+{
+   ring = lgNotifyGetRing(h);
+}
+...
+D*/
+
+
+/*F*/
+lgNotifyRing_p lgNotifyGetRing(int handle);
+/*D
+This function gets the ring of a notification opened with
+[*lgNotifyOpenRing*].
+
+. .
+handle: >= 0 (as returned by [*lgNotifyOpenRing*])
+. .
+
+If OK returns the ring.
+
+On failure returns NULL.
+
+The ring stays valid until the notification is closed.  Stop using
+it before calling [*lgNotifyClose*].
+D*/
+
+
+/*F*/
+int lgNotifyRingPeek(lgNotifyRing_p ring, lgGpioReport_t **reports);
+/*D
+This function gets the reports waiting in a ring without copying
+them.
+
+. .
+   ring: the ring (as returned by [*lgNotifyGetRing*])
+reports: set to the first waiting report
+. .
+
+Returns the number of reports which follow on from *reports.  When
+the waiting reports wrap around the end of the ring only those up to
+the end are counted, and the rest are returned by the next call.
+
+The reports stay in place until freed by [*lgNotifyRingRelease*].
+
+...
+n = lgNotifyRingPeek(ring, &reports);
+
+for (i=0; i<n; i++) handle_report(&reports[i]);
+
+lgNotifyRingRelease(ring, n);
+...
+D*/
+
+
+/*F*/
+void lgNotifyRingRelease(lgNotifyRing_p ring, int count);
+/*D
+This function frees reports read from a ring so the slots can be
+reused.
+
+. .
+ ring: the ring (as returned by [*lgNotifyGetRing*])
+count: the number of reports read, at most the number peeked
+. .
+D*/
+
+
+/*F*/
+int lgNotifyRingWait(lgNotifyRing_p ring, int timeout_ms);
+/*D
+This function waits until there are reports in a ring.
+
+. .
+      ring: the ring (as returned by [*lgNotifyGetRing*])
+timeout_ms: the most milliseconds to wait, -1 to wait forever
+. .
+
+Returns the number of reports available from [*lgNotifyRingPeek*],
+which is 0 if the wait timed out.
+
+Returns at once if reports are already waiting.
+D*/
+
+
 /*F*/
 int lgNotifyResume(int handle);
 /*D
@@ -2291,6 +2429,28 @@ If OK returns the count of bytes written.
 On failure returns a negative error code.
 D*/
 
+/*F*/
+int lgSpiWritev(int handle, const struct iovec *iov, int iovcnt);
+/*D
+This function writes the iovcnt buffers described by iov to the
+SPI device, in order, as a single message.  Chip select stays
+asserted from the first byte to the last, and the whole message
+costs one system call.
+
+. .
+handle: >= 0 (as returned by [*lgSpiOpen*])
+   iov: the buffers to write
+iovcnt: the number of buffers, 1-256
+. .
+
+The total written may not exceed the spidev bufsiz module
+parameter, 4096 bytes unless it has been changed.
+
+If OK returns the count of bytes written.
+
+On failure returns a negative error code.
+D*/
+
 /*F*/
 int lgSpiXfer(int handle, const char *txBuf, char *rxBuf, int count);
 /*D
@@ -2976,6 +3136,7 @@ PARAMS*/
 #define LG_BAD_PWM_DUTY        -103 // bad PWM dutycycle
 #define LG_GPIO_NOT_AN_OUTPUT  -104 // GPIO not set as an output
 #define LG_INVALID_GROUP_ALERT -105 // can not set a group to alert
+#define LG_BAD_RING_SLOTS      -106 // bad notification ring size
 
 /*DEF_E*/
 
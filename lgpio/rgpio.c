@@ -1575,6 +1575,140 @@ int spi_xfer(int sbc, int handle, const char *txBuf, char *rxBuf, int count)
    return bytes;
 }
 
+/* BATCHES */
+
+static int xSendBatch(int sbc, lgBatchCmd_p cmds, int count)
+{
+   /*
+   Send as many of the commands as fit in one message and collect
+   their replies.  Called with the command mutex held.  Returns the
+   number of commands sent.
+   */
+
+   lgCmd_p h, sub;
+   uint8_t *ext;
+   uint32_t pos, subSize, dataSize;
+   int n, got;
+   size_t len;
+
+   h = (lgCmd_p) gMsgBuf[sbc];
+   ext = (uint8_t *)&h[1];
+   pos = 0;
+
+   for (n=0; n<count; n++)
+   {
+      if ((cmds[n].args < 0) || (cmds[n].args > LG_BATCH_MAX_ARGS) ||
+          (cmds[n].txCount < 0) || (cmds[n].txCount && !cmds[n].txBuf))
+         return lgif_bad_batch;
+
+      subSize = (cmds[n].args * sizeof(uint32_t)) + cmds[n].txCount;
+
+      if ((pos + sizeof(lgCmd_t) + CMD_BATCH_PAD(subSize)) >=
+          (CMD_MAX_EXTENSION - sizeof(lgCmd_t)))
+      {
+         if (n) break;
+         return lgif_bad_batch; /* a single command too large */
+      }
+
+      sub = (lgCmd_p)(ext + pos);
+
+      sub->magic = LG_MAGIC;
+      sub->size = subSize;
+      sub->cmd = cmds[n].command;
+      sub->doubles = 0;
+      sub->longs = cmds[n].args;
+      sub->shorts = 0;
+
+      memcpy(&sub[1], cmds[n].arg, cmds[n].args * sizeof(uint32_t));
+
+      if (cmds[n].txCount)
+         memcpy((uint8_t *)&sub[1] + (cmds[n].args * sizeof(uint32_t)),
+            cmds[n].txBuf, cmds[n].txCount);
+
+      pos += sizeof(lgCmd_t) + CMD_BATCH_PAD(subSize);
+   }
+
+   h->magic = LG_MAGIC;
+   h->size = pos;
+   h->cmd = LG_CMD_BATCH;
+   h->doubles = 0;
+   h->longs = n;
+   h->shorts = 0;
+
+   len = sizeof(lgCmd_t) + pos;
+
+   if (send(gPigCommand[sbc], h, len, 0) != len) return lgif_bad_send;
+
+   if (recv(gPigCommand[sbc], h, sizeof(lgCmd_t), MSG_WAITALL) !=
+      sizeof(lgCmd_t)) return lgif_bad_recv;
+
+   if ((h->size > (CMD_MAX_EXTENSION - sizeof(lgCmd_t))) ||
+       (recv(gPigCommand[sbc], ext, h->size, MSG_WAITALL) != h->size))
+      return lgif_bad_recv;
+
+   got = h->status;
+
+   if ((got < 0) || (got > n)) return lgif_bad_batch;
+
+   pos = 0;
+
+   for (n=0; n<got; n++)
+   {
+      if ((pos + sizeof(lgCmd_t)) > h->size) return lgif_bad_batch;
+
+      sub = (lgCmd_p)(ext + pos);
+
+      dataSize = sub->size;
+
+      if ((pos + sizeof(lgCmd_t) + dataSize) > h->size) return lgif_bad_batch;
+
+      cmds[n].status = sub->status;
+
+      if (cmds[n].rxBuf && dataSize)
+         memcpy(cmds[n].rxBuf, &sub[1],
+            (dataSize < cmds[n].rxCount) ? dataSize : cmds[n].rxCount);
+
+      pos += sizeof(lgCmd_t) + CMD_BATCH_PAD(dataSize);
+   }
+
+   /* the daemon stops early if it finds the message malformed */
+
+   return got ? got : lgif_bad_batch;
+}
+
+int command_batch(int sbc, lgBatchCmd_p cmds, int count)
+{
+   int done, sent;
+
+   if ((sbc < 0) || (sbc >= MAX_SBC) || !gPiInUse[sbc])
+   {
+      return lgif_unconnected_sbc;
+   }
+
+   if (gAbort)
+   {
+      rgpiod_stop(sbc);
+      return lgif_unconnected_sbc;
+   }
+
+   _pml(sbc);
+
+   for (done=0; done<count; done+=sent)
+   {
+      sent = xSendBatch(sbc, cmds+done, count-done);
+
+      if (sent < 0)
+      {
+         _pmu(sbc);
+         return sent;
+      }
+   }
+
+   _pmu(sbc);
+
+   return done;
+}
+
 /* THREADS */
 
 pthread_t *thread_start(lgThreadFunc_t thread_func, void *userdata)
@@ -1771,6 +1905,8 @@ const char *lgu_error_text(int errnum)
             return "not connected to sbc";
          case lgif_too_many_pis:
             return "too many connected sbcs";
+         case lgif_bad_batch:
+            return "bad command batch";
 
          default:
             return "unknown error";
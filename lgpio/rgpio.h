@@ -209,6 +209,10 @@ spi_read                   Reads bytes from a SPI device
 spi_write                  Writes bytes to a SPI device
 spi_xfer                   Transfers bytes with a SPI device
 
+BATCHES
+
+command_batch              Executes several commands in one round trip
+
 THREADS
 
 thread_start               Start a new thread
@@ -253,6 +257,20 @@ typedef struct callback_s callback_t;
 
 typedef void *(lgThreadFunc_t) (void *);
 
+#define LG_BATCH_MAX_ARGS 8
+
+typedef struct lgBatchCmd_s
+{
+   int command;                     // socket command code, e.g. LG_CMD_GW
+   int args;                        // number of 32 bit arguments
+   uint32_t arg[LG_BATCH_MAX_ARGS]; // the arguments
+   const void *txBuf;               // bytes following the arguments, or NULL
+   int txCount;                     // number of bytes in txBuf
+   void *rxBuf;                     // where returned bytes go, or NULL
+   int rxCount;                     // size of rxBuf
+   int status;                      // set to the command's result
+} lgBatchCmd_t, *lgBatchCmd_p;
+
 /* --------------------------------------------------------- ESSENTIAL API
 */
 
@@ -2289,6 +2307,53 @@ On failure returns a negative error code.
 D*/
 
 
+/* ------------------------------------------------------------- BATCH API
+*/
+
+/*F*/
+int command_batch(int sbc, lgBatchCmd_p cmds, int count);
+/*D
+This function executes a list of commands, sending them to the
+daemon together and receiving all their results together rather
+than waiting a round trip for each.
+
+. .
+ sbc: >= 0 (as returned by [*rgpiod_start*]).
+cmds: the commands to execute, in order.
+count: the number of commands.
+. .
+
+If OK returns the number of commands executed, which is count.
+
+On failure returns a negative error code.
+
+Each command is given as its socket command code (see rgpiod.h)
+and its parameters, which must be 32 bit values optionally followed
+by bytes.  This covers the GPIO, I2C, SPI and serial read and write
+commands.  The status of each command is set to what the matching
+function returns.  Any bytes a command returns are copied to its
+rxBuf, up to rxCount bytes.
+
+The commands are executed in order and one failing does not stop
+the rest.  A command whose returned bytes do not fit in the reply
+message has its status set to LG_MSG_TOOBIG.  Lists too long for
+one message are sent in several.
+
+...
+lgBatchCmd_t cmds[3] =
+{
+   {LG_CMD_GW,   3, {h, DC, 0}},
+   {LG_CMD_SPIW, 1, {spi}, bytes, sizeof(bytes)},
+   {LG_CMD_GW,   3, {h, DC, 1}},
+};
+
+if (command_batch(sbc, cmds, 3) == 3)
+{
+   // cmds[1].status is the number of bytes written
+}
+...
+D*/
+
 /* ----------------------------------------------------------- THREADS API
 */
 
@@ -2957,6 +3022,7 @@ typedef enum
    lgif_callback_not_found = -2010,
    lgif_unconnected_sbc    = -2011,
    lgif_too_many_pis       = -2012,
+   lgif_bad_batch          = -2013,
 } lgifError_t;
 
 /*DEF_E*/
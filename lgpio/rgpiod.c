@@ -52,6 +52,7 @@ int      gPermits = 0;
 int      gNumSockNetAddr = 0;
 uint32_t gSockNetAddr[MAX_CONNECT_ADDRESSES];
 int      gFdSock = -1;
+int      gSockWorkers = 0;
 
 /* locals */
 
@@ -165,6 +166,9 @@ static void xUsage()
    fprintf(stderr, "\n" \
       "Usage: rgpiod [OPTION] ...\n" \
       "   -c dir,     set config dir (default launch dir)\n" \
+      "   -e value,   serve clients from one event loop and a pool of\n" \
+      "               value worker threads (1-64, default a thread\n" \
+      "               per connection)\n" \
       "   -l,         localhost socket only (default local+remote)\n" \
       "   -n IP addr, allow address, name or dotted (default allow all)\n" \
       "   -p value,   socket port (1024-32000, default 8889)\n" \
@@ -223,7 +227,7 @@ static void xInitOpts(int argc, char *argv[])
    int opt, err, i;
    uint32_t addr;
 
-   while ((opt = getopt(argc, argv, "c:ln:p:vw:x")) != -1)
+   while ((opt = getopt(argc, argv, "c:e:ln:p:vw:x")) != -1)
    {
       switch (opt)
       {
@@ -231,6 +235,13 @@ static void xInitOpts(int argc, char *argv[])
             lguSetConfigDir(optarg);
             break;
 
+         case 'e':
+            i = xGetNum(optarg, &err);
+            if ((i >= 1) && (i <= LG_MAX_SOCKET_WORKERS))
+               gSockWorkers = i;
+            else xFatal("invalid -e option (%d)", i);
+            break;
+
          case 'l':
             CfgIfFlags |= LG_LOCALHOST_SOCK_IF;
             break; 
@@ -68,6 +68,10 @@ int lgExecCmd(lgCmd_p h, int bufSize);
 
 #define MAX_CONNECT_ADDRESSES 256
 
+/* Socket worker threads, 0 for a thread per connection */
+
+#define LG_MAX_SOCKET_WORKERS 64
+
 /* File API
 */
 
@@ -97,6 +101,7 @@ extern int gPermits;
 extern int gNumSockNetAddr;
 extern uint32_t gSockNetAddr[MAX_CONNECT_ADDRESSES];
 extern int gFdSock;
+extern int gSockWorkers;
 
 #ifdef __cplusplus
 }
@@ -208,6 +213,7 @@ extern int gFdSock;
 
 #define LG_CMD_LGV   140 // print the lg library version
 #define LG_CMD_TICK  141 // print the number of nanonseconds since the Epoch
+#define LG_CMD_BATCH 142 // execute a batch of commands
 
 /*DEF_E*/
 
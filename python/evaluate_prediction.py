@@ -0,0 +1,124 @@
+import argparse
+import bisect
+import math
+
+# Filter settings, matching app/src/landmark_predictor.c
+ALPHA = 0.5
+BETA = 0.2
+MAX_AHEAD = 0.150
+RESET_GAP = 0.500
+
+CONTROL_RATE_HZ = 100
+LATENCIES_MS = [0, 25, 50, 75, 100, 150]
+
+
+def get_args():
+    parser = argparse.ArgumentParser(
+        description="Replays a session recorded with mediapipe_handtrack.py --record and "
+                    "reports how far the predicted hand is from where it really was")
+    parser.add_argument("recording", type=str)
+    parser.add_argument("--hand", type=int, default=0)
+    args = parser.parse_args()
+    return args
+
+
+def main():
+  args = get_args()
+  frames = load_recording(args.recording, args.hand)
+  frames.sort(key=lambda frame: frame[0])
+  if len(frames) < 2:
+    print("Recording needs at least two frames of the hand")
+    return
+
+  duration = frames[-1][0] - frames[0][0]
+  print(f"{len(frames)} frames over {duration:.1f} s ({len(frames) / duration:.1f} fps)")
+  print("Average distance of the heard landmarks from the hand, in pixels")
+  print("latency (ms)   held frame   predicted")
+
+  for latency_ms in LATENCIES_MS:
+    held, predicted = replay(frames, latency_ms / 1000)
+    print(f"{latency_ms:12d}   {held:10.2f}   {predicted:9.2f}")
+
+
+# Reads the frames of one hand, each line holding the time, hand ID and landmarks
+def load_recording(path, hand):
+  frames = []
+  with open(path) as recording:
+    for line in recording:
+      values = line.split()
+      if len(values) != 44 or int(values[1]) != hand:
+        continue
+      frames.append((float(values[0]), [int(v) for v in values[2:]]))
+  return frames
+
+
+# Replays the frames at the control rate, comparing the landmarks heard at each
+# step with the hand at that moment. The hand is taken to be where the frame
+# arriving one latency later shows it, so the predictor leads by the latency.
+def replay(frames, latency):
+  predictor = Predictor()
+  held_total = 0
+  predicted_total = 0
+  steps = 0
+
+  times = [frame[0] for frame in frames]
+  next_frame = 0
+  time = frames[0][0]
+  while time + latency <= frames[-1][0]:
+    while next_frame < len(frames) and frames[next_frame][0] <= time:
+      predictor.update(*frames[next_frame])
+      next_frame += 1
+
+    actual = interpolate(frames, times, time + latency)
+    held_total += distance(frames[next_frame - 1][1], actual)
+    predicted_total += distance(predictor.predict(time + latency), actual)
+    steps += 1
+    time += 1 / CONTROL_RATE_HZ
+
+  return held_total / steps, predicted_total / steps
+
+
+# Alpha-beta filter on each landmark coordinate
+class Predictor:
+    def __init__(self):
+        self.position = None
+        self.velocity = None
+        self.last_time = None
+
+    def update(self, time, values):
+        if self.position is None or not 0 < time - self.last_time <= RESET_GAP:
+            self.position = [float(v) for v in values]
+            self.velocity = [0.0] * len(values)
+        else:
+            dt = time - self.last_time
+            ahead = min(dt, MAX_AHEAD)
+            for i, value in enumerate(values):
+                predicted = self.position[i] + self.velocity[i] * ahead
+                residual = value - predicted
+                self.position[i] = predicted + ALPHA * residual
+                self.velocity[i] += BETA * residual / dt
+        self.last_time = time
+
+    def predict(self, time):
+        ahead = min(max(time - self.last_time, 0), MAX_AHEAD)
+        return [p + v * ahead for p, v in zip(self.position, self.velocity)]
+
+
+# Landmarks between the two frames around a time
+def interpolate(frames, times, time):
+  after = min(max(bisect.bisect_left(times, time), 1), len(frames) - 1)
+  (t0, v0), (t1, v1) = frames[after - 1], frames[after]
+  share = (time - t0) / (t1 - t0) if t1 > t0 else 0
+  return [a + (b - a) * share for a, b in zip(v0, v1)]
+
+
+# Average distance between matching landmarks
+def distance(values, actual):
+  total = 0
+  for i in range(0, len(values), 2):
+    total += math.hypot(values[i] - actual[i], values[i + 1] - actual[i + 1])
+  return total / (len(values) / 2)
+
+
+if __name__=="__main__":
+  main()
@@ -7,18 +7,23 @@ import numpy as np
 import cv2
 from udp_module import send_data
 
+# Hands the board tracks at once; each hand is sent with an ID, 0 for the
+# right hand and 1 for the left, with 2 added for a second performer
+MAX_HANDS = 4
+HAND_IDS = {"Right": 0, "Left": 1}
+
 
 def get_args():
     parser = argparse.ArgumentParser()
     parser.add_argument("--device", type=int, default=0)
+    parser.add_argument("--record", type=str, default=None)
+    parser.add_argument("--hands", type=int, default=2, choices=range(1, MAX_HANDS + 1))
     args = parser.parse_args()
     return args
 
 
 def main():
   # Get initialization arguments
-  gesture = "UNKNOWN"
-
   args = get_args()
   cap_device = args.device
   cap_width = 240
@@ -35,11 +40,14 @@ def main():
   cap.set(cv2.CAP_PROP_FPS,10) #limit fps, maybe better performance?
   time.sleep(1)
 
+  # Optionally record each frame sent, for evaluate_prediction.py
+  record_file = open(args.record, "w") if args.record else None
+
   # Load Model 
   mp_hands = mp.solutions.hands
   hands = mp_hands.Hands(
       static_image_mode=use_static_image_mode,
-      max_num_hands=1,
+      max_num_hands=args.hands,
       min_detection_confidence=min_detection_confidence,
      min_tracking_confidence=min_tracking_confidence,
   )
@@ -61,25 +69,40 @@ def main():
     results = hands.process(frame)
     frame.flags.writeable = True
 
-    previous_gesture = None
-
     if results.multi_hand_landmarks is not None:
-      for hand_landmarks, _ in zip(results.multi_hand_landmarks,
+      # Send the landmarks of every hand in one packet per frame, the board classifies the gestures
+      hand_strings = []
+      used_ids = set()
+      now = time.monotonic()
+      for hand_landmarks, handedness in zip(results.multi_hand_landmarks,
                                                 results.multi_handedness):
-    
-        # Gestures determined manually for now
-        gesture, bit_value = extract_gesture(hand_landmarks.landmark)
+        hand_id = hand_id_for(handedness.classification[0].label, used_ids)
+        if hand_id is None:
+          continue
         landmark_list = rescale_landmarks(240, 240, hand_landmarks)
-        flattened_list = landmark_list_to_string(landmark_list)
-        # If its a new gesture we send data via UDP module
-        if previous_gesture != gesture and gesture != "UNKNOWN":
-          combined = f"{bit_value} {flattened_list}"
-          send_data(combined)
-          previous_gesture = gesture
+        hand_string = f"{hand_id} {landmark_list_to_string(landmark_list)}"
+        hand_strings.append(hand_string)
+        if record_file:
+          record_file.write(f"{now:.4f} {hand_string}\n")
+
+      if hand_strings:
+        send_data(" ".join(hand_strings))
 
+  if record_file:
+    record_file.close()
   cap.release()
   cv2.destroyAllWindows()
 
+# Picks the ID of a hand from its handedness, moving to the next performer's IDs when taken
+def hand_id_for(label, used_ids):
+  hand_id = HAND_IDS.get(label, 0)
+  while hand_id in used_ids:
+    hand_id += len(HAND_IDS)
+  if hand_id >= MAX_HANDS:
+    return None
+  used_ids.add(hand_id)
+  return hand_id
+
 def landmark_list_to_string(landmark_list):
     if isinstance(landmark_list, list):
         flattened = [str(num) for pair in landmark_list for num in pair]
@@ -100,55 +123,6 @@ class Point:
         self.x = x
         self.y = y
 
-def extract_gesture(landmarks):
-
-  #helper function, cal
-  def distance(landmark1, landmark2):
-    return ((landmark1.x - landmark2.x) ** 2 + (landmark1.y - landmark2.y) ** 2) ** 0.5
-  
-  #extracting key joints we're going to use
-  thumb_tip = landmarks[4]
-  index_tip = landmarks[8]
-  middle_tip = landmarks[12]
-  ring_tip = landmarks[16]
-  pinky_tip = landmarks[20]
-
-
-  # Check for index and thumb touching
-  thumb_index = (
-    # Checks that index and thumb are touching
-    distance(thumb_tip, index_tip) < 0.15
-    # checks that other fingers are open
-  )
-  # Middle finger and thumb touching
-  thumb_middle = (
-    distance(thumb_tip, middle_tip) < 0.15
-  )
-  # Ring finger and thumb touching 
-  thumb_ring = (
-    distance(thumb_tip, ring_tip) < 0.15
-  )
-
-  # Pinky and thumb touching
-  thumb_pinky = (
-    distance(thumb_tip, pinky_tip) < 0.15
-  )
-
-  bit_index = 0b1000 if thumb_index else 0b0000
-  bit_middle = 0b0100 if thumb_middle else 0b0000
-  bit_ring = 0b0010 if thumb_ring else 0b0000
-  bit_pinky = 0b0001 if thumb_pinky else 0b0000
-
-  touching_fingers = bit_index | bit_middle | bit_pinky | bit_ring
-
-  #for testing overlapping conditions. If overlap found, adjust the thresholds
-  print("{0:b}".format(touching_fingers))
-  if(touching_fingers == 0):
-      return "OPEN_HAND", "0000"
-  else:
-      return "FINGER_THUMB", str(touching_fingers)
-
-
 if __name__=="__main__":
   main()
 
@@ -0,0 +1,244 @@
+/*
+ * This file tests the I2C transaction functions against a fake device.
+ * The test is linked with ioctl(), write() and read() wrapped, so every
+ * syscall the I2C module makes lands in the fake device instead of the
+ * kernel. That checks the I2C_RDWR messages a transaction builds and counts
+ * the syscalls it takes compared to the single register functions.
+ */
+
+#include "i2c.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEVICE_FILE_DESC 3      // Descriptor the fake device answers on
+#define DEVICE_ADDRESS 0x48     // Address of the fake device
+#define REG_CONFIGURATION 0x01  // Registers of the joystick ADC
+#define REG_DATA 0x00
+#define MAX_RECORDED_MSGS (I2C_TRANSACTION_MAX_OPS * 2)
+
+// Fake device state, served to every wrapped syscall
+static uint16_t registers[256];
+static uint8_t register_pointer = 0;
+static int syscall_count = 0;
+static int ioctl_count = 0;
+
+// Copy of the messages of the last I2C_RDWR ioctl
+static struct i2c_msg recorded_msgs[MAX_RECORDED_MSGS];
+static uint8_t recorded_bytes[MAX_RECORDED_MSGS][3];
+static int num_recorded_msgs = 0;
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+// Prototypes of the wrapped syscalls, called by the I2C module
+int __wrap_ioctl(int fd, unsigned long request, ...);
+ssize_t __wrap_write(int fd, const void *buff, size_t size);
+ssize_t __wrap_read(int fd, void *buff, size_t size);
+
+// Helper function prototypes
+static void apply_write(const uint8_t *buff, size_t size);
+static void load_register(uint8_t *buff);
+static void check_msg(int index, uint16_t flags, uint16_t len, const uint8_t *bytes);
+static void test_message_layout(void);
+static void test_matches_single_reads(void);
+static void test_reuse_and_empty(void);
+static void test_syscall_count(void);
+
+int main(void)
+{
+    test_message_layout();
+    test_matches_single_reads();
+    test_reuse_and_empty();
+    test_syscall_count();
+
+    if (failures != 0) {
+        printf("%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("All I2C transaction checks passed\n");
+    return EXIT_SUCCESS;
+}
+
+int __wrap_ioctl(int fd, unsigned long request, ...)
+{
+    va_list args;
+    va_start(args, request);
+    struct i2c_rdwr_ioctl_data *data = va_arg(args, struct i2c_rdwr_ioctl_data *);
+    va_end(args);
+
+    syscall_count++;
+    ioctl_count++;
+    if (fd != DEVICE_FILE_DESC || request != I2C_RDWR || data->nmsgs > MAX_RECORDED_MSGS) {
+        return -1;
+    }
+
+    // Record each message as sent, then play it against the device in order
+    num_recorded_msgs = data->nmsgs;
+    for (unsigned int i = 0; i < data->nmsgs; i++) {
+        struct i2c_msg *msg = &data->msgs[i];
+        if (msg->addr != DEVICE_ADDRESS || msg->len > sizeof(recorded_bytes[i])) {
+            return -1;
+        }
+        recorded_msgs[i] = *msg;
+        if (msg->flags & I2C_M_RD) {
+            load_register(msg->buf);
+        }
+        else {
+            apply_write(msg->buf, msg->len);
+        }
+        memcpy(recorded_bytes[i], msg->buf, msg->len);
+    }
+    return data->nmsgs;
+}
+
+ssize_t __wrap_write(int fd, const void *buff, size_t size)
+{
+    syscall_count++;
+    if (fd != DEVICE_FILE_DESC) {
+        return -1;
+    }
+    apply_write(buff, size);
+    return size;
+}
+
+ssize_t __wrap_read(int fd, void *buff, size_t size)
+{
+    syscall_count++;
+    if (fd != DEVICE_FILE_DESC || size != sizeof(uint16_t)) {
+        return -1;
+    }
+    load_register(buff);
+    return size;
+}
+
+// Function to set the register pointer, and the register too if a value follows
+static void apply_write(const uint8_t *buff, size_t size)
+{
+    register_pointer = buff[0];
+    if (size == 3) {
+        registers[register_pointer] = buff[1] | (buff[2] << 8);
+    }
+}
+
+// Function to return the pointed to register, low byte first
+static void load_register(uint8_t *buff)
+{
+    buff[0] = registers[register_pointer] & 0xFF;
+    buff[1] = registers[register_pointer] >> 8;
+}
+
+// Function to check one recorded message of the last transaction
+static void check_msg(int index, uint16_t flags, uint16_t len, const uint8_t *bytes)
+{
+    CHECK(recorded_msgs[index].addr == DEVICE_ADDRESS);
+    CHECK(recorded_msgs[index].flags == flags);
+    CHECK(recorded_msgs[index].len == len);
+    CHECK(memcmp(recorded_bytes[index], bytes, len) == 0);
+}
+
+// Function to test reads become a register write and a repeated-start read
+static void test_message_layout(void)
+{
+    registers[REG_DATA] = 0x1234;
+    registers[REG_CONFIGURATION] = 0;
+    ioctl_count = 0;
+
+    I2CTransaction transaction;
+    uint16_t data = 0;
+    uint16_t configuration = 0;
+    i2c_transaction_begin(&transaction, DEVICE_FILE_DESC, DEVICE_ADDRESS);
+    i2c_transaction_read_reg16(&transaction, REG_DATA, &data);
+    i2c_transaction_write_reg16(&transaction, REG_CONFIGURATION, 0x83C2);
+    i2c_transaction_read_reg16(&transaction, REG_CONFIGURATION, &configuration);
+    i2c_transaction_execute(&transaction);
+
+    CHECK(ioctl_count == 1);
+    CHECK(num_recorded_msgs == 5);
+    check_msg(0, 0, 1, (const uint8_t[]){REG_DATA});
+    check_msg(1, I2C_M_RD, 2, (const uint8_t[]){0x34, 0x12});
+    check_msg(2, 0, 3, (const uint8_t[]){REG_CONFIGURATION, 0xC2, 0x83});
+    check_msg(3, 0, 1, (const uint8_t[]){REG_CONFIGURATION});
+    check_msg(4, I2C_M_RD, 2, (const uint8_t[]){0xC2, 0x83});
+
+    // Values keep the byte order read_i2c_reg16() returns
+    uint16_t expected_data;
+    uint16_t expected_configuration;
+    memcpy(&expected_data, (const uint8_t[]){0x34, 0x12}, sizeof(expected_data));
+    memcpy(&expected_configuration, (const uint8_t[]){0xC2, 0x83}, sizeof(expected_configuration));
+    CHECK(data == expected_data);
+    CHECK(configuration == expected_configuration);
+}
+
+// Function to test a transaction reads the same values as the single register functions
+static void test_matches_single_reads(void)
+{
+    for (int reg = 0; reg < 4; reg++) {
+        registers[reg] = (uint16_t)(0xA5C3 + reg * 0x1111);
+    }
+
+    I2CTransaction transaction;
+    uint16_t values[4];
+    i2c_transaction_begin(&transaction, DEVICE_FILE_DESC, DEVICE_ADDRESS);
+    for (int reg = 0; reg < 4; reg++) {
+        i2c_transaction_read_reg16(&transaction, reg, &values[reg]);
+    }
+    i2c_transaction_execute(&transaction);
+
+    for (int reg = 0; reg < 4; reg++) {
+        CHECK(values[reg] == read_i2c_reg16(DEVICE_FILE_DESC, reg));
+    }
+}
+
+// Function to test an executed transaction starts empty, and an empty one sends nothing
+static void test_reuse_and_empty(void)
+{
+    registers[REG_DATA] = 0x0102;
+    ioctl_count = 0;
+
+    I2CTransaction transaction;
+    uint16_t first = 0;
+    uint16_t second = 0;
+    i2c_transaction_begin(&transaction, DEVICE_FILE_DESC, DEVICE_ADDRESS);
+    i2c_transaction_execute(&transaction);
+    CHECK(ioctl_count == 0);
+
+    i2c_transaction_read_reg16(&transaction, REG_DATA, &first);
+    i2c_transaction_execute(&transaction);
+    i2c_transaction_read_reg16(&transaction, REG_DATA, &second);
+    i2c_transaction_execute(&transaction);
+    CHECK(ioctl_count == 2);
+    CHECK(num_recorded_msgs == 2);
+    CHECK(first == second);
+}
+
+// Function to count the syscalls of reading an axis and switching the ADC to the next one
+static void test_syscall_count(void)
+{
+    syscall_count = 0;
+    write_i2c_reg16(DEVICE_FILE_DESC, REG_CONFIGURATION, 0x83C2);
+    read_i2c_reg16(DEVICE_FILE_DESC, REG_DATA);
+    int single_syscalls = syscall_count;
+
+    syscall_count = 0;
+    I2CTransaction transaction;
+    uint16_t data;
+    i2c_transaction_begin(&transaction, DEVICE_FILE_DESC, DEVICE_ADDRESS);
+    i2c_transaction_read_reg16(&transaction, REG_DATA, &data);
+    i2c_transaction_write_reg16(&transaction, REG_CONFIGURATION, 0x83C2);
+    i2c_transaction_execute(&transaction);
+    int transaction_syscalls = syscall_count;
+
+    printf("Syscalls per joystick axis: %d with single register access, %d with a transaction\n",
+           single_syscalls, transaction_syscalls);
+    CHECK(single_syscalls == 3);
+    CHECK(transaction_syscalls == 1);
+}
@@ -0,0 +1,180 @@
+/*
+ * This file tests the landmark ring. It checks the latest frame and the
+ * in-order reader on their own thread, including a reader that falls behind
+ * and skips ahead, then has a reader follow a writer thread and checks it
+ * sees every frame in order exactly once, or counts it as dropped, and never
+ * a torn one. Each test uses a hand of its own, so their rings start empty.
+ */
+
+#include "landmark_ring.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CONCURRENT_FRAMES 1000000 // Frames the writer thread publishes
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+static atomic_bool is_writer_done;
+
+// Helper function prototypes
+static void publish_numbered(int hand, int number);
+static bool is_numbered(const struct LandmarkFrame *frame, int number);
+static void test_latest(void);
+static void test_reader_in_order(void);
+static void test_reader_skips_ahead(void);
+static void *writer_thread(void *arg);
+static void test_reader_against_writer(void);
+
+int main(void)
+{
+    test_latest();
+    test_reader_in_order();
+    test_reader_skips_ahead();
+    test_reader_against_writer();
+
+    if (failures != 0) {
+        printf("%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("All landmark ring checks passed\n");
+    return EXIT_SUCCESS;
+}
+
+// Function to publish a frame with every value set to a number
+static void publish_numbered(int hand, int number)
+{
+    int values[LANDMARK_RING_NUM_VALUES];
+    for (int i = 0; i < LANDMARK_RING_NUM_VALUES; i++) {
+        values[i] = number;
+    }
+    landmark_ring_publish(hand, values, LANDMARK_RING_NUM_VALUES);
+}
+
+// Function to check every value of a frame is the number it was published with
+static bool is_numbered(const struct LandmarkFrame *frame, int number)
+{
+    for (int i = 0; i < LANDMARK_RING_NUM_VALUES; i++) {
+        if (frame->values[i] != number) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Function to test the latest frame is the last one published
+static void test_latest(void)
+{
+    struct LandmarkFrame frame;
+    CHECK(!landmark_ring_read_latest(0, &frame));
+
+    publish_numbered(0, 10);
+    publish_numbered(0, 11);
+    CHECK(landmark_ring_read_latest(0, &frame));
+    CHECK(frame.hand == 0);
+    CHECK(frame.sequence == 2);
+    CHECK(is_numbered(&frame, 11));
+}
+
+// Function to test a reader sees each frame once, in order, from when it started
+static void test_reader_in_order(void)
+{
+    struct LandmarkReader reader;
+    struct LandmarkFrame frame;
+
+    publish_numbered(1, 100);
+    landmark_reader_init(&reader, 1);
+    CHECK(!landmark_reader_next(&reader, &frame));
+
+    for (int number = 1; number <= 3; number++) {
+        publish_numbered(1, number);
+    }
+    for (int number = 1; number <= 3; number++) {
+        CHECK(landmark_reader_next(&reader, &frame));
+        CHECK(frame.sequence == (unsigned long long)number + 1);
+        CHECK(is_numbered(&frame, number));
+    }
+    CHECK(!landmark_reader_next(&reader, &frame));
+    CHECK(reader.dropped_frames == 0);
+}
+
+// Function to test a reader lapped by the writer skips to the oldest frame kept
+static void test_reader_skips_ahead(void)
+{
+    struct LandmarkReader reader;
+    struct LandmarkFrame frame;
+    const int num_overwritten = 5;
+
+    landmark_reader_init(&reader, 2);
+    for (int number = 1; number <= LANDMARK_RING_SIZE + num_overwritten; number++) {
+        publish_numbered(2, number);
+    }
+
+    for (int number = num_overwritten + 1; number <= LANDMARK_RING_SIZE + num_overwritten; number++) {
+        CHECK(landmark_reader_next(&reader, &frame));
+        CHECK(frame.sequence == (unsigned long long)number);
+        CHECK(is_numbered(&frame, number));
+    }
+    CHECK(!landmark_reader_next(&reader, &frame));
+    CHECK(reader.dropped_frames == num_overwritten);
+}
+
+// Function to publish frames numbered by their sequence as fast as possible
+static void *writer_thread(void *arg)
+{
+    (void)arg;
+    for (int number = 1; number <= CONCURRENT_FRAMES; number++) {
+        publish_numbered(3, number);
+    }
+    atomic_store(&is_writer_done, true);
+    return NULL;
+}
+
+// Function to test a reader following a writer accounts for every frame exactly once
+static void test_reader_against_writer(void)
+{
+    struct LandmarkReader reader;
+    struct LandmarkFrame frame;
+    pthread_t thread;
+    long long reads = 0;
+    long long torn_reads = 0;
+    long long out_of_order_reads = 0;
+    unsigned long long last_sequence = 0;
+
+    landmark_reader_init(&reader, 3);
+    pthread_create(&thread, NULL, writer_thread, NULL);
+    while (true) {
+        bool is_done = atomic_load(&is_writer_done);
+        if (landmark_reader_next(&reader, &frame)) {
+            reads++;
+            if (!is_numbered(&frame, (int)frame.sequence)) {
+                torn_reads++;
+            }
+            if (frame.sequence <= last_sequence) {
+                out_of_order_reads++;
+            }
+            last_sequence = frame.sequence;
+        }
+        else if (is_done) {
+            break;
+        }
+    }
+    pthread_join(thread, NULL);
+
+    CHECK(torn_reads == 0);
+    CHECK(out_of_order_reads == 0);
+    CHECK(last_sequence == CONCURRENT_FRAMES);
+    CHECK(reads + reader.dropped_frames == CONCURRENT_FRAMES);
+    printf("Reader against writer: %lld of %d frames read, %lld dropped\n",
+           reads, CONCURRENT_FRAMES, reader.dropped_frames);
+}
@@ -0,0 +1,272 @@
+/*
+ * This file tests the rotary encoder decoder by feeding it edge streams
+ * through a fake HAL backend. The test stands in for the backend and the
+ * event loop, so each edge queued on a line is handed to the decoder the
+ * way the event loop would, with the timestamp the kernel would give it.
+ */
+
+#include "rotary_encoder.h"
+#include "hal_backend.h"
+#include "event_loop.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Lines of the encoder channels, as wired in rotary_encoder.c
+#define LINE_NUMBER_A 7
+#define LINE_NUMBER_B 8
+#define LINE_A 0
+#define LINE_B 1
+#define FIRST_EVENT_FD 100
+
+#define MS_TO_NS(ms) ((long long)(ms) * 1000000LL)
+
+// Fake lines, each returning the edge queued on it
+static int line_numbers[2] = {LINE_NUMBER_A, LINE_NUMBER_B};
+static struct GPIOEvent queued_events[2];
+
+// Handlers the decoder registered with the event loop, by line
+static EventHandler handlers[2];
+static void *handler_contexts[2];
+
+// Channel levels the edge stream is at, and the time of its last edge
+static bool level_a = true;
+static bool level_b = true;
+static long long now_ns = 0;
+
+static int failures = 0;
+
+#define CHECK_VALUE(encoder, expected) \
+    do { \
+        int value = rotary_encoder_get_value(encoder); \
+        if (value != (expected)) { \
+            printf("%s:%d: value is %d, expected %d\n", __FILE__, __LINE__, value, (expected)); \
+            failures++; \
+        } \
+    } while (0)
+
+// Helper function prototypes
+static void fake_gpio_initialize(void);
+static struct GPIOLine *fake_gpio_open_for_events(enum eGPIOChips chip, int pin_number);
+static int fake_gpio_get_event_fd(struct GPIOLine *line);
+static int fake_gpio_read_event(struct GPIOLine *line, struct GPIOEvent *event);
+static void fake_gpio_close(struct GPIOLine *line);
+static int line_index(struct GPIOLine *line);
+static void send_edge(int line, long long interval_ns);
+static void turn_detent(bool is_clockwise, long long edge_interval_ns);
+static void bounce(int line, int times);
+static void test_single_detents(void);
+static void test_bounces(void);
+static void test_high_edge_rate(void);
+static void test_acceleration(void);
+
+// Backend with only the GPIO operations, the only ones the decoder uses
+static const HalBackend fake_backend = {
+    .name = "fake",
+    .gpio_initialize = fake_gpio_initialize,
+    .gpio_open_for_events = fake_gpio_open_for_events,
+    .gpio_get_event_fd = fake_gpio_get_event_fd,
+    .gpio_read_event = fake_gpio_read_event,
+    .gpio_close = fake_gpio_close,
+};
+
+static RotaryEncoder encoder = {0};
+
+int main(void)
+{
+    rotary_encoder_init(&encoder);
+
+    test_single_detents();
+    test_bounces();
+    test_high_edge_rate();
+    test_acceleration();
+
+    rotary_encoder_cleanup(&encoder);
+
+    if (failures != 0) {
+        printf("%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("All rotary encoder checks passed\n");
+    return EXIT_SUCCESS;
+}
+
+const HalBackend *hal_backend_get(void)
+{
+    return &fake_backend;
+}
+
+void event_loop_add_fd(int fd, EventHandler handler, void *context)
+{
+    handlers[fd - FIRST_EVENT_FD] = handler;
+    handler_contexts[fd - FIRST_EVENT_FD] = context;
+}
+
+void event_loop_remove_fd(int fd)
+{
+    handlers[fd - FIRST_EVENT_FD] = NULL;
+}
+
+static void fake_gpio_initialize(void)
+{
+}
+
+static struct GPIOLine *fake_gpio_open_for_events(enum eGPIOChips chip, int pin_number)
+{
+    (void)chip;
+    return (struct GPIOLine *)&line_numbers[pin_number == LINE_NUMBER_A ? LINE_A : LINE_B];
+}
+
+static int fake_gpio_get_event_fd(struct GPIOLine *line)
+{
+    return FIRST_EVENT_FD + line_index(line);
+}
+
+static int fake_gpio_read_event(struct GPIOLine *line, struct GPIOEvent *event)
+{
+    *event = queued_events[line_index(line)];
+    return 0;
+}
+
+static void fake_gpio_close(struct GPIOLine *line)
+{
+    (void)line;
+}
+
+// Function to find which fake line a handle refers to
+static int line_index(struct GPIOLine *line)
+{
+    return (int *)line == &line_numbers[LINE_A] ? LINE_A : LINE_B;
+}
+
+// Function to toggle a channel and hand the edge to the decoder
+static void send_edge(int line, long long interval_ns)
+{
+    bool *level = line == LINE_A ? &level_a : &level_b;
+    *level = !*level;
+    now_ns += interval_ns;
+
+    queued_events[line].line_number = line_numbers[line];
+    queued_events[line].is_rising = *level;
+    queued_events[line].timestamp_ns = now_ns;
+    handlers[line](handler_contexts[line]);
+}
+
+// Function to turn one detent, with channel A leading when turning clockwise
+static void turn_detent(bool is_clockwise, long long edge_interval_ns)
+{
+    int leading = is_clockwise ? LINE_A : LINE_B;
+    int trailing = is_clockwise ? LINE_B : LINE_A;
+    send_edge(leading, edge_interval_ns);
+    send_edge(trailing, edge_interval_ns);
+    send_edge(leading, edge_interval_ns);
+    send_edge(trailing, edge_interval_ns);
+}
+
+// Function to chatter a channel, ending at the level it started at
+static void bounce(int line, int times)
+{
+    for (int i = 0; i < times * 2; i++) {
+        send_edge(line, 50000);
+    }
+}
+
+// Function to test detents in each direction move the value by one
+static void test_single_detents(void)
+{
+    rotary_encoder_set_acceleration(false);
+    rotary_encoder_set_value(0);
+
+    turn_detent(true, MS_TO_NS(50));
+    CHECK_VALUE(&encoder, 1);
+    turn_detent(true, MS_TO_NS(50));
+    CHECK_VALUE(&encoder, 2);
+    turn_detent(false, MS_TO_NS(50));
+    CHECK_VALUE(&encoder, 1);
+    turn_detent(false, MS_TO_NS(50));
+    turn_detent(false, MS_TO_NS(50));
+    CHECK_VALUE(&encoder, -1);
+}
+
+// Function to test contact bounce and half turns count as nothing
+static void test_bounces(void)
+{
+    rotary_encoder_set_acceleration(false);
+    rotary_encoder_set_value(0);
+
+    // Chatter at rest
+    bounce(LINE_A, 3);
+    bounce(LINE_B, 3);
+    CHECK_VALUE(&encoder, 0);
+
+    // Chatter on each edge of a clockwise detent
+    send_edge(LINE_A, MS_TO_NS(5));
+    bounce(LINE_A, 2);
+    send_edge(LINE_B, MS_TO_NS(5));
+    bounce(LINE_B, 2);
+    send_edge(LINE_A, MS_TO_NS(5));
+    bounce(LINE_A, 2);
+    send_edge(LINE_B, MS_TO_NS(5));
+    bounce(LINE_B, 2);
+    CHECK_VALUE(&encoder, 1);
+
+    // Half a counter-clockwise turn, then back to rest
+    send_edge(LINE_B, MS_TO_NS(5));
+    send_edge(LINE_A, MS_TO_NS(5));
+    send_edge(LINE_A, MS_TO_NS(5));
+    send_edge(LINE_B, MS_TO_NS(5));
+    CHECK_VALUE(&encoder, 1);
+
+    // Chatter while both channels are low, midway through a counter-clockwise detent
+    send_edge(LINE_B, MS_TO_NS(5));
+    send_edge(LINE_A, MS_TO_NS(5));
+    bounce(LINE_A, 2);
+    bounce(LINE_B, 2);
+    send_edge(LINE_B, MS_TO_NS(5));
+    send_edge(LINE_A, MS_TO_NS(5));
+    CHECK_VALUE(&encoder, 0);
+}
+
+// Function to test every detent counts with edges far closer than a hand can turn
+static void test_high_edge_rate(void)
+{
+    rotary_encoder_set_acceleration(false);
+    rotary_encoder_set_value(0);
+
+    for (int i = 0; i < 100000; i++) {
+        turn_detent(true, 1000);
+    }
+    CHECK_VALUE(&encoder, 100000);
+    for (int i = 0; i < 40000; i++) {
+        turn_detent(false, 1000);
+        bounce(i % 2 == 0 ? LINE_A : LINE_B, 1);
+    }
+    CHECK_VALUE(&encoder, 60000);
+}
+
+// Function to test fast detents move the value by 2 or 4 once acceleration is on
+static void test_acceleration(void)
+{
+    rotary_encoder_set_value(0);
+    rotary_encoder_set_acceleration(true);
+
+    // Each detent is four edges, so comes a quarter of these intervals per edge
+    turn_detent(true, MS_TO_NS(200) / 4);
+    CHECK_VALUE(&encoder, 1);
+    turn_detent(true, MS_TO_NS(50) / 4);
+    CHECK_VALUE(&encoder, 3);
+    turn_detent(true, MS_TO_NS(20) / 4);
+    CHECK_VALUE(&encoder, 7);
+
+    // Exactly 30 ms and 80 ms apart fall into the slower band
+    turn_detent(false, MS_TO_NS(30) / 4);
+    CHECK_VALUE(&encoder, 5);
+    turn_detent(false, MS_TO_NS(80) / 4);
+    CHECK_VALUE(&encoder, 4);
+    turn_detent(false, MS_TO_NS(29) / 4);
+    CHECK_VALUE(&encoder, 0);
+
+    // Without acceleration fast detents count one each
+    rotary_encoder_set_acceleration(false);
+    turn_detent(true, MS_TO_NS(1));
+    CHECK_VALUE(&encoder, 1);
+}